@@ -0,0 +1,294 @@
+//  Partie implantation du module allocator.
+
+#define _GNU_SOURCE
+
+#include "allocator.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+//  Allocateur libc ------------------------------------------------------------
+
+static void *al__libc_alloc(void *context, size_t size) {
+  (void) context;
+  return malloc(size);
+}
+
+static void *al__libc_resize(void *context, void *ptr, size_t oldsize,
+    size_t newsize) {
+  (void) context;
+  (void) oldsize;
+  return realloc(ptr, newsize);
+}
+
+static void al__libc_release(void *context, void *ptr, size_t size) {
+  (void) context;
+  (void) size;
+  free(ptr);
+}
+
+static const allocator al__libc = {
+  .alloc = al__libc_alloc,
+  .resize = al__libc_resize,
+  .release = al__libc_release,
+  .context = NULL,
+};
+
+const allocator *allocator_libc(void) {
+  return &al__libc;
+}
+
+//  Allocateur à pages énormes -------------------------------------------------
+
+//  AL__HUGEPAGE_SIZE : taille d'une page énorme. Les zones d'au moins cette
+//    taille sont projetées, et leur taille arrondie à un multiple de celle-ci.
+#define AL__HUGEPAGE_SIZE ((size_t) 2 << 20)
+
+#define AL__IS_MAPPED(size) ((size) >= AL__HUGEPAGE_SIZE)
+
+//  al__mapped_size : renvoie la taille de la projection d'une zone de taille
+//    size, ou 0 si elle n'est pas représentable.
+static size_t al__mapped_size(size_t size) {
+  if (size > SIZE_MAX - (AL__HUGEPAGE_SIZE - 1)) {
+    return 0;
+  }
+  return (size + AL__HUGEPAGE_SIZE - 1) & ~(AL__HUGEPAGE_SIZE - 1);
+}
+
+//  al__advise : demande l'usage de pages énormes pour la projection d'adresse
+//    ptr et de taille size. Un refus du système est sans conséquence.
+static void al__advise(void *ptr, size_t size) {
+#if defined MADV_HUGEPAGE
+  madvise(ptr, size, MADV_HUGEPAGE);
+#else
+  (void) ptr;
+  (void) size;
+#endif
+}
+
+static void *al__hugepage_alloc(void *context, size_t size) {
+  (void) context;
+  if (!AL__IS_MAPPED(size)) {
+    return malloc(size);
+  }
+  size_t m = al__mapped_size(size);
+  if (m == 0) {
+    return NULL;
+  }
+  void *p = mmap(NULL, m, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+      -1, 0);
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+  al__advise(p, m);
+  return p;
+}
+
+static void al__hugepage_release(void *context, void *ptr, size_t size) {
+  (void) context;
+  if (ptr == NULL) {
+    return;
+  }
+  if (!AL__IS_MAPPED(size)) {
+    free(ptr);
+    return;
+  }
+  munmap(ptr, al__mapped_size(size));
+}
+
+static void *al__hugepage_resize(void *context, void *ptr, size_t oldsize,
+    size_t newsize) {
+  if (ptr == NULL) {
+    return al__hugepage_alloc(context, newsize);
+  }
+  if (!AL__IS_MAPPED(oldsize) && !AL__IS_MAPPED(newsize)) {
+    return realloc(ptr, newsize);
+  }
+  if (AL__IS_MAPPED(oldsize) && AL__IS_MAPPED(newsize)) {
+    size_t m_ = al__mapped_size(oldsize);
+    size_t m = al__mapped_size(newsize);
+    if (m == 0) {
+      return NULL;
+    }
+    if (m == m_) {
+      return ptr;
+    }
+#if defined MREMAP_MAYMOVE
+    void *p = mremap(ptr, m_, m, MREMAP_MAYMOVE);
+    if (p == MAP_FAILED) {
+      return NULL;
+    }
+    al__advise(p, m);
+    return p;
+#endif
+  }
+  void *p = al__hugepage_alloc(context, newsize);
+  if (p == NULL) {
+    return NULL;
+  }
+  memcpy(p, ptr, oldsize < newsize ? oldsize : newsize);
+  al__hugepage_release(context, ptr, oldsize);
+  return p;
+}
+
+static const allocator al__hugepage = {
+  .alloc = al__hugepage_alloc,
+  .resize = al__hugepage_resize,
+  .release = al__hugepage_release,
+  .context = NULL,
+};
+
+const allocator *allocator_hugepage(void) {
+  return &al__hugepage;
+}
+
+//  Allocateur comptable -------------------------------------------------------
+
+//  struct al__account : contexte d'un allocateur comptable. Le composant self
+//    est l'allocateur renvoyé à l'utilisateurice ; son contexte est l'adresse
+//    de la structure elle-même. Le composant limit est la limite donnée à la
+//    création, soft la limite en vigueur. Les compteurs sont atomiques pour
+//    que l'allocateur puisse être partagé entre plusieurs fils d'exécution.
+typedef struct al__account al__account;
+
+struct al__account {
+  allocator self;
+  const allocator *backend;
+  size_t limit;
+  atomic_size_t soft;
+  atomic_size_t current;
+  atomic_size_t peak;
+  atomic_size_t nrefused;
+};
+
+//  al__account_reserve : tente d'ajouter size au nombre d'octets alloués
+//    comptés par ac. Renvoie une valeur non nulle si la limite serait
+//    dépassée, et le compte reste inchangé. Renvoie sinon zéro.
+static int al__account_reserve(al__account *ac, size_t size) {
+  size_t soft = atomic_load(&ac->soft);
+  size_t cur = atomic_load(&ac->current);
+  size_t n;
+  do {
+    if (cur > SIZE_MAX - size || (soft != 0 && cur + size > soft)) {
+      atomic_fetch_add(&ac->nrefused, 1);
+      return -1;
+    }
+    n = cur + size;
+  } while (!atomic_compare_exchange_weak(&ac->current, &cur, n));
+  size_t peak = atomic_load(&ac->peak);
+  while (n > peak && !atomic_compare_exchange_weak(&ac->peak, &peak, n)) {
+  }
+  return 0;
+}
+
+//  al__account_unreserve : retire size au nombre d'octets alloués comptés par
+//    ac.
+static void al__account_unreserve(al__account *ac, size_t size) {
+  atomic_fetch_sub(&ac->current, size);
+}
+
+static void *al__account_alloc(void *context, size_t size) {
+  al__account *ac = context;
+  if (al__account_reserve(ac, size) != 0) {
+    return NULL;
+  }
+  void *p = allocator_alloc(ac->backend, size);
+  if (p == NULL) {
+    al__account_unreserve(ac, size);
+  }
+  return p;
+}
+
+static void *al__account_resize(void *context, void *ptr, size_t oldsize,
+    size_t newsize) {
+  al__account *ac = context;
+  if (newsize > oldsize && al__account_reserve(ac, newsize - oldsize) != 0) {
+    return NULL;
+  }
+  void *p = allocator_resize(ac->backend, ptr, oldsize, newsize);
+  if (p == NULL) {
+    if (newsize > oldsize) {
+      al__account_unreserve(ac, newsize - oldsize);
+    }
+    return NULL;
+  }
+  if (newsize < oldsize) {
+    al__account_unreserve(ac, oldsize - newsize);
+  }
+  return p;
+}
+
+static void al__account_release(void *context, void *ptr, size_t size) {
+  al__account *ac = context;
+  if (ptr == NULL) {
+    return;
+  }
+  allocator_release(ac->backend, ptr, size);
+  al__account_unreserve(ac, size);
+}
+
+allocator *allocator_accounting_empty(const allocator *backend,
+    size_t limit) {
+  al__account *ac = malloc(sizeof *ac);
+  if (ac == NULL) {
+    return NULL;
+  }
+  ac->self = (allocator) {
+    .alloc = al__account_alloc,
+    .resize = al__account_resize,
+    .release = al__account_release,
+    .context = ac,
+  };
+  ac->backend = backend;
+  ac->limit = limit;
+  atomic_init(&ac->soft, limit);
+  atomic_init(&ac->current, 0);
+  atomic_init(&ac->peak, 0);
+  atomic_init(&ac->nrefused, 0);
+  return &ac->self;
+}
+
+void allocator_accounting_set_soft_limit(allocator *al, size_t soft) {
+  al__account *ac = al->context;
+  if (soft == 0 || (ac->limit != 0 && soft > ac->limit)) {
+    soft = ac->limit;
+  }
+  atomic_store(&ac->soft, soft);
+}
+
+void allocator_accounting_dispose(allocator **alptr) {
+  if (*alptr == NULL) {
+    return;
+  }
+  free((*alptr)->context);
+  *alptr = NULL;
+}
+
+void allocator_accounting_stats(const allocator *al,
+    struct allocator_stats *stptr) {
+  al__account *ac = al->context;
+  *stptr = (struct allocator_stats) {
+    .current = atomic_load(&ac->current),
+    .peak = atomic_load(&ac->peak),
+    .limit = ac->limit,
+    .soft = atomic_load(&ac->soft),
+    .nrefused = atomic_load(&ac->nrefused),
+  };
+}
+
+//  Fonctions d'usage ----------------------------------------------------------
+
+void *allocator_alloc(const allocator *al, size_t size) {
+  return al->alloc(al->context, size);
+}
+
+void *allocator_resize(const allocator *al, void *ptr, size_t oldsize,
+    size_t newsize) {
+  return al->resize(al->context, ptr, oldsize, newsize);
+}
+
+void allocator_release(const allocator *al, void *ptr, size_t size) {
+  al->release(al->context, ptr, size);
+}
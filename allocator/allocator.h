@@ -0,0 +1,95 @@
+//  Partie interface du module allocator (allocateur).
+//
+//  Un allocateur regroupe les fonctions auxquelles les modules hashtable,
+//    holdall et wordcounter délèguent la gestion de leur mémoire. Il permet de
+//    choisir, à la création d'un contrôleur, où et comment sa mémoire est
+//    allouée.
+
+#ifndef ALLOCATOR__H
+#define ALLOCATOR__H
+
+//  Fonctionnement général :
+//  - la taille d'une zone est toujours fournie lors de sa réallocation et de
+//      sa libération ; elle doit être égale à celle demandée lors de son
+//      allocation ou de sa dernière réallocation ;
+//  - les fonctions d'allocation et de réallocation renvoient NULL en cas de
+//      dépassement de capacité. La réallocation laisse alors la zone
+//      inchangée ;
+//  - le comportement est indéterminé si une zone est libérée ou réallouée par
+//      un autre allocateur que celui qui l'a allouée.
+
+#include <stdlib.h>
+
+//  struct allocator, allocator : allocateur. Les composants alloc, resize et
+//    release pointent respectivement vers les fonctions d'allocation, de
+//    réallocation et de libération ; context est le premier paramètre de
+//    chacun de leurs appels. resize(context, NULL, 0, size) équivaut à
+//    alloc(context, size).
+typedef struct allocator allocator;
+
+struct allocator {
+  void *(*alloc)(void *context, size_t size);
+  void *(*resize)(void *context, void *ptr, size_t oldsize, size_t newsize);
+  void (*release)(void *context, void *ptr, size_t size);
+  void *context;
+};
+
+//  allocator_libc : renvoie l'allocateur par défaut, qui délègue à malloc,
+//    realloc et free.
+extern const allocator *allocator_libc(void);
+
+//  allocator_hugepage : renvoie un allocateur qui place les zones d'au moins
+//    2 Mio dans des projections anonymes (mmap) pour lesquelles l'usage de
+//    pages énormes transparentes est demandé (madvise, MADV_HUGEPAGE). Les
+//    zones plus petites sont confiées à allocator_libc. Si le système ne gère
+//    pas les pages énormes, les projections restent en pages ordinaires.
+extern const allocator *allocator_hugepage(void);
+
+//  allocator_accounting_empty : tente d'allouer les ressources nécessaires
+//    pour gérer un nouvel allocateur comptable, qui confie les allocations à
+//    l'allocateur pointé par backend, lequel doit rester valide jusqu'à la
+//    révocation de l'allocateur comptable, et tient le compte des octets
+//    alloués. Si limit ne vaut pas 0, toute allocation ou réallocation qui
+//    porterait ce nombre au-delà de limit est refusée comme s'il s'agissait
+//    d'un dépassement de capacité. L'allocateur comptable peut être utilisé
+//    par plusieurs fils d'exécution simultanément. Renvoie NULL en cas de
+//    dépassement de capacité, un pointeur vers l'allocateur sinon.
+extern allocator *allocator_accounting_empty(const allocator *backend,
+    size_t limit);
+
+//  allocator_accounting_set_soft_limit : fixe à soft la limite de l'allocateur
+//    comptable pointé par al, qui ne peut toutefois dépasser celle donnée à sa
+//    création. soft égal à 0 rétablit cette dernière. Abaisser la limite
+//    permet de garder une réserve que l'utilisateurice libère en la relevant.
+extern void allocator_accounting_set_soft_limit(allocator *al, size_t soft);
+
+//  allocator_accounting_dispose : sans effet si *alptr vaut NULL. Libère sinon
+//    les ressources allouées à la gestion de l'allocateur comptable associé à
+//    *alptr puis affecte NULL à *alptr. Les zones qu'il a allouées doivent
+//    avoir été libérées au préalable.
+extern void allocator_accounting_dispose(allocator **alptr);
+
+//  struct allocator_stats : bilan d'un allocateur comptable.
+struct allocator_stats {
+  size_t current;   //  nombre d'octets actuellement alloués
+  size_t peak;      //  maximum atteint par current
+  size_t limit;     //  limite donnée à la création, 0 si aucune
+  size_t soft;      //  limite en vigueur, 0 si aucune
+  size_t nrefused;  //  nombre d'allocations refusées en raison de la limite
+};
+
+//  allocator_accounting_stats : affecte à *stptr le bilan de l'allocateur
+//    comptable pointé par al. Le comportement est indéterminé si al n'a pas
+//    été renvoyé par allocator_accounting_empty.
+extern void allocator_accounting_stats(const allocator *al,
+    struct allocator_stats *stptr);
+
+//  allocator_alloc, allocator_resize, allocator_release : alloue, réalloue,
+//    libère une zone de taille size, newsize, size à l'aide de l'allocateur
+//    pointé par al.
+extern void *allocator_alloc(const allocator *al, size_t size);
+extern void *allocator_resize(const allocator *al, void *ptr, size_t oldsize,
+    size_t newsize);
+extern void allocator_release(const allocator *al, void *ptr, size_t size);
+
+#endif
@@ -0,0 +1,125 @@
+//  Partie implantation du module atomicfile.
+
+#define _GNU_SOURCE
+
+#include "atomicfile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//  ATOMICFILE__SUFFIX_LEN : nombre de caractères aléatoires du suffixe ajouté
+//    au chemin définitif pour former le nom temporaire.
+#define ATOMICFILE__SUFFIX_LEN 6
+
+//  ATOMICFILE__ATTEMPTS : nombre maximal de noms temporaires essayés.
+#define ATOMICFILE__ATTEMPTS 100
+
+//  ATOMICFILE__CHARS : caractères des suffixes.
+#define ATOMICFILE__CHARS                                                      \
+  "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+
+//  struct atomicfile : le fichier temporaire de chemin tmp, de flux stream,
+//    remplacera celui de chemin path.
+struct atomicfile {
+  char *path;
+  char *tmp;
+  FILE *stream;
+};
+
+//  atomicfile__mix : renvoie une valeur de 64 bits pseudo-aléatoire qui
+//    dépend de x.
+static uint64_t atomicfile__mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+//  atomicfile__suffix : remplace les ATOMICFILE__SUFFIX_LEN caractères pointés
+//    par s par des caractères de ATOMICFILE__CHARS tirés d'une valeur qui
+//    dépend du processus, de l'instant et d'un compteur d'appels, si bien que
+//    deux appels simultanés ne produisent pas le même suffixe.
+static void atomicfile__suffix(char *s) {
+  static atomic_uint_fast64_t calls;
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  uint64_t x = atomicfile__mix((uint64_t) getpid() << 32
+      ^ (uint64_t) ts.tv_sec ^ (uint64_t) ts.tv_nsec << 20
+      ^ atomicfile__mix(atomic_fetch_add(&calls, 1)));
+  for (size_t k = 0; k < ATOMICFILE__SUFFIX_LEN; ++k) {
+    s[k] = ATOMICFILE__CHARS[x % (sizeof ATOMICFILE__CHARS - 1)];
+    x /= sizeof ATOMICFILE__CHARS - 1;
+  }
+}
+
+atomicfile *atomicfile_open(const char *path, int *err) {
+  *err = 1;
+  size_t plen = strlen(path);
+  atomicfile *af = malloc(sizeof *af);
+  if (af == NULL) {
+    return NULL;
+  }
+  af->path = malloc(plen + 1);
+  af->tmp = malloc(plen + 1 + ATOMICFILE__SUFFIX_LEN + 1);
+  if (af->path == NULL || af->tmp == NULL) {
+    goto error;
+  }
+  memcpy(af->path, path, plen + 1);
+  memcpy(af->tmp, path, plen);
+  af->tmp[plen] = '.';
+  af->tmp[plen + 1 + ATOMICFILE__SUFFIX_LEN] = '\0';
+  *err = 2;
+  // Avec O_EXCL, le nom ne peut désigner un fichier existant ; les droits
+  //    0666 sont restreints par le système selon le masque du processus
+  int fd = -1;
+  for (int k = 0; fd < 0 && k < ATOMICFILE__ATTEMPTS; ++k) {
+    atomicfile__suffix(af->tmp + plen + 1);
+    fd = open(af->tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd < 0 && errno != EEXIST) {
+      goto error;
+    }
+  }
+  if (fd < 0) {
+    goto error;
+  }
+  af->stream = fdopen(fd, "wb");
+  if (af->stream == NULL) {
+    close(fd);
+    unlink(af->tmp);
+    goto error;
+  }
+  return af;
+error:
+  free(af->tmp);
+  free(af->path);
+  free(af);
+  return NULL;
+}
+
+FILE *atomicfile_stream(atomicfile *af) {
+  return af->stream;
+}
+
+int atomicfile_close(atomicfile **afptr, bool keep) {
+  if (*afptr == NULL) {
+    return 0;
+  }
+  atomicfile *af = *afptr;
+  int r = 0;
+  if (fclose(af->stream) != 0 || !keep
+      || rename(af->tmp, af->path) != 0) {
+    unlink(af->tmp);
+    r = keep ? 2 : 0;
+  }
+  free(af->tmp);
+  free(af->path);
+  free(af);
+  *afptr = NULL;
+  return r;
+}
@@ -0,0 +1,40 @@
+//  Partie interface du module atomicfile (remplacement atomique de fichier).
+//
+//  Le module atomicfile permet d'écrire un fichier sous un nom temporaire, dans
+//    le même répertoire, puis de le renommer en son nom définitif, si bien
+//    qu'un fichier existant de même chemin n'est remplacé que si l'écriture
+//    a abouti. Le fichier temporaire est créé avec les droits d'un fichier
+//    créé par fopen, le masque de création de fichiers du processus étant
+//    appliqué par le système sans être modifié.
+
+#ifndef ATOMICFILE__H
+#define ATOMICFILE__H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+//  struct atomicfile, atomicfile : type et nom de type d'un contrôleur
+//    regroupant les informations nécessaires pour gérer l'écriture d'un
+//    fichier sous un nom temporaire.
+typedef struct atomicfile atomicfile;
+
+//  atomicfile_open : tente de créer, à côté du fichier de chemin path, un
+//    nouveau fichier de nom temporaire, ouvert en écriture binaire. Renvoie
+//    NULL en cas d'échec, en affectant à *err 1 en cas de dépassement de
+//    capacité, 2 si le fichier n'a pas pu être créé. Renvoie sinon un
+//    pointeur vers le contrôleur associé.
+extern atomicfile *atomicfile_open(const char *path, int *err);
+
+//  atomicfile_stream : renvoie le flux d'écriture du fichier temporaire
+//    associé à af.
+extern FILE *atomicfile_stream(atomicfile *af);
+
+//  atomicfile_close : sans effet si *afptr vaut NULL. Ferme sinon le flux du
+//    fichier temporaire associé à *afptr puis, si keep vaut true et que la
+//    fermeture a réussi, le renomme en son nom définitif ; sinon, ou si le
+//    renommage échoue, le supprime. Libère ensuite les ressources allouées à
+//    la gestion de *afptr puis affecte NULL à *afptr. Renvoie 2 si keep vaut
+//    true et que le fichier n'a pas été renommé, 0 sinon.
+extern int atomicfile_close(atomicfile **afptr, bool keep);
+
+#endif
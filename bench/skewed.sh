@@ -0,0 +1,83 @@
+#!/bin/sh
+#  skewed.sh : mesure la répartition de la charge de xwc sur un grand nombre de
+#    fichiers de tailles très inégales : quelques gros fichiers, placés en tête
+#    de la liste, suivis de nombreux petits fichiers. Pour chaque moteur de
+#    comptage parallèle et chaque nombre de fils, affiche le temps écoulé, le
+#    temps processeur et le taux d'occupation des fils, égal au temps processeur
+#    divisé par le produit du temps écoulé et du nombre de fils.
+#
+#  Usage : bench/skewed.sh [XWC [SMALL [BIG [JOBS...]]]]
+#    XWC   : exécutable à mesurer, xwc/xwc par défaut
+#    SMALL : nombre de petits fichiers, 20000 par défaut
+#    BIG   : nombre de gros fichiers, 4 par défaut
+#    JOBS  : nombres de fils à essayer, 1 2 4 8 par défaut
+
+set -e
+
+xwc=${1:-xwc/xwc}
+small=${2:-20000}
+big=${3:-4}
+shift $(($# < 3 ? $# : 3))
+jobs=${*:-1 2 4 8}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+#  Génération des fichiers : le vocabulaire suit approximativement une loi de
+#    Zipf ; un gros fichier contient 2000 fois plus de mots qu'un petit.
+gen() {
+  awk -v n="$1" -v seed="$2" 'BEGIN {
+    srand(seed)
+    for (i = 0; i < n; ++i) {
+      printf "w%d%s", int(1 / (rand() + 1e-5)), (i % 12 == 11) ? "\n" : " "
+    }
+    printf "\n"
+  }'
+}
+i=0
+while [ $i -lt "$big" ]; do
+  gen 400000 $i > "$dir/big$i"
+  i=$((i + 1))
+done
+mkdir "$dir/small"
+awk -v n="$small" -v d="$dir/small" 'BEGIN {
+  srand(1)
+  for (f = 0; f < n; ++f) {
+    file = sprintf("%s/s%06d", d, f)
+    for (i = 0; i < 200; ++i) {
+      printf "w%d ", int(1 / (rand() + 1e-5)) > file
+    }
+    close(file)
+  }
+}'
+case $xwc in
+  /*) ;;
+  *) xwc=$(pwd)/$xwc ;;
+esac
+cd "$dir"
+
+#  children_ticks : affiche le temps processeur, en tops d'horloge, consommé
+#    par les processus fils terminés du shell (Linux seulement).
+children_ticks() {
+  cut -d ' ' -f 16-17 /proc/$$/stat | awk '{ print $1 + $2 }'
+}
+
+printf '%-10s %4s %9s %9s %9s\n' engine jobs real cpu busy
+hz=$(getconf CLK_TCK)
+for engine in merge shuffle; do
+  opt=""
+  [ "$engine" = shuffle ] && opt="--$engine"
+  for j in $jobs; do
+    t0=$(date +%s.%N)
+    c0=$(children_ticks)
+    "$xwc" -n -j "$j" $opt big* small/s* > /dev/null
+    c1=$(children_ticks)
+    t1=$(date +%s.%N)
+    echo "$engine $j $t0 $t1 $c0 $c1" | awk -v hz="$hz" '{
+      real = $4 - $3
+      cpu = ($6 - $5) / hz
+      busy = real > 0 ? 100 * cpu / (real * $2) : 0
+      printf "%-10s %4d %9.2f %9.2f %8.0f%%\n", $1, $2, real, cpu, busy
+    }'
+  done
+done
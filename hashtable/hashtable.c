@@ -3,7 +3,7 @@
 //    par chainage séparé.
 
 #include <stdint.h>
-#include "hashtable.h"
+#include "hashtable_ext.h"
 
 //  Le nombre de compartiments du tableau de hachage est une puissance de 2. Il
 //    vaut initialement « 2 ^ HT__LBNSLOTS_MIN ». Dès que le taux de remplissage
@@ -51,7 +51,8 @@
 //    hasharray est l'adresse du champ null ; 2) la fonction de recherche locale
 //    hashtable__search est toujours définie car la valeur du champ null est
 //    NULL et la valeur de lbnslots est nulle si le tableau de hachage n'a pas
-//    été alloué.
+//    été alloué. Le composant al mémorise l'allocateur auquel sont confiées
+//    toutes les allocations.
 
 //  L'ajout d'une nouvelle entrée a lieu en queue de liste. L'ordre induit est
 //    respecté lors de tout agrandissement du tableau de hachage.
@@ -71,6 +72,7 @@ struct hashtable {
   cell *null;
   size_t lbnslots;
   size_t nfreeentries;
+  const allocator *al;
 };
 
 #define HT__MAKE_BLANK(ht)                                                     \
@@ -87,12 +89,13 @@ struct hashtable {
 #define HASHVAL(__hashfun, __lbnslots, __keyref)                               \
   (__hashfun(__keyref) % POW2(__lbnslots))
 
-//  hashtable__search : recherche dans la table de hachage associé à ht une clé
-//    égale à keyref au sens de compar. Renvoie l'adresse du pointeur qui repère
-//    la cellule qui contient cette occurrence si elle existe. Renvoie sinon
-//    l'adresse du pointeur qui marque la fin de la liste.
-static cell **hashtable__search(const hashtable *ht, const void *keyref) {
-  size_t k = HASHVAL(ht->hashfun, ht->lbnslots, keyref);
+//  hashtable__search_at : recherche dans la liste d'indice k du tableau de
+//    hachage de la table de hachage associé à ht une clé égale à keyref au sens
+//    de compar. Renvoie l'adresse du pointeur qui repère la cellule qui
+//    contient cette occurrence si elle existe. Renvoie sinon l'adresse du
+//    pointeur qui marque la fin de la liste.
+static cell **hashtable__search_at(const hashtable *ht, const void *keyref,
+    size_t k) {
   cell * const *pp = &ht->hasharray[k];
   while (*pp != NULL && ht->compar(keyref, (*pp)->keyref) != 0) {
     pp = &(*pp)->next;
@@ -100,6 +103,13 @@ static cell **hashtable__search(const hashtable *ht, const void *keyref) {
   return (cell **) pp;
 }
 
+//  hashtable__search : similaire à hashtable__search_at, dans la liste de
+//    keyref.
+static cell **hashtable__search(const hashtable *ht, const void *keyref) {
+  return hashtable__search_at(ht, keyref,
+      HASHVAL(ht->hashfun, ht->lbnslots, keyref));
+}
+
 //  hashtable__add_enlarge : initialise ou agrandit le tableau de hachage de la
 //    table de hachage associée à ht. Il est supposé que la valeur de
 //    nfreeentries est nulle. Renvoie une valeur non nulle en cas de dépassement
@@ -124,7 +134,8 @@ static int hashtable__add_enlarge(hashtable *ht) {
       || (HT__LDFACT_MAX_NUMER > sizeof *a
       && HT__LDFACT_MAX_NUMER > HT__LDFACT_MAX_DENOM
       && m > SIZE_MAX / HT__LDFACT_MAX_NUMER * HT__LDFACT_MAX_DENOM)
-      || (a = realloc(ht->hasharray, m * sizeof *a)) == NULL) {
+      || (a = allocator_resize(ht->al, ht->hasharray, m_ * sizeof *a,
+      m * sizeof *a)) == NULL) {
     if (b) {
       HT__MAKE_BLANK(ht);
     }
@@ -160,10 +171,16 @@ static int hashtable__add_enlarge(hashtable *ht) {
 
 hashtable *hashtable_empty(int (*compar)(const void *, const void *),
     size_t (*hashfun)(const void *)) {
-  hashtable *ht = malloc(sizeof *ht);
+  return hashtable_empty_alloc(compar, hashfun, allocator_libc());
+}
+
+hashtable *hashtable_empty_alloc(int (*compar)(const void *, const void *),
+    size_t (*hashfun)(const void *), const allocator *al) {
+  hashtable *ht = allocator_alloc(al, sizeof *ht);
   if (ht == NULL) {
     return NULL;
   }
+  ht->al = al;
   ht->compar = compar;
   ht->hashfun = hashfun;
   HT__MAKE_BLANK(ht);
@@ -175,20 +192,27 @@ void hashtable_dispose(hashtable **htptr) {
   if (*htptr == NULL) {
     return;
   }
-  if (!HT__IS_BLANK(*htptr)) {
-    size_t m = POW2((*htptr)->lbnslots);
-    for (size_t k = 0; k < m; ++k) {
-      cell *p = (*htptr)->hasharray[k];
-      while (p != NULL) {
-        cell *t = p;
-        p = p->next;
-        free(t);
-      }
+  hashtable_clear(*htptr);
+  allocator_release((*htptr)->al, *htptr, sizeof **htptr);
+  *htptr = NULL;
+}
+
+void hashtable_clear(hashtable *ht) {
+  if (HT__IS_BLANK(ht)) {
+    return;
+  }
+  size_t m = POW2(ht->lbnslots);
+  for (size_t k = 0; k < m; ++k) {
+    cell *p = ht->hasharray[k];
+    while (p != NULL) {
+      cell *t = p;
+      p = p->next;
+      allocator_release(ht->al, t, sizeof *t);
     }
-    free((*htptr)->hasharray);
   }
-  free(*htptr);
-  *htptr = NULL;
+  allocator_release(ht->al, ht->hasharray, m * sizeof *ht->hasharray);
+  HT__MAKE_BLANK(ht);
+  ht->nfreeentries = 0;
 }
 
 void *hashtable_add(hashtable *ht, const void *keyref, const void *valref) {
@@ -207,7 +231,7 @@ void *hashtable_add(hashtable *ht, const void *keyref, const void *valref) {
     }
     pp = hashtable__search(ht, keyref);
   }
-  cell *p = malloc(sizeof *p);
+  cell *p = allocator_alloc(ht->al, sizeof *p);
   if (p == NULL) {
     return NULL;
   }
@@ -227,7 +251,7 @@ void *hashtable_remove(hashtable *ht, const void *keyref) {
   cell *p = *pp;
   const void *r = p->valref;
   *pp = p->next;
-  free(p);
+  allocator_release(ht->al, p, sizeof *p);
   ht->nfreeentries += 1;
   return (void *) r;
 }
@@ -237,6 +261,13 @@ void *hashtable_search(hashtable *ht, const void *keyref) {
   return p == NULL ? NULL : (void *) p->valref;
 }
 
+void *hashtable_search_hashed(hashtable *ht, const void *keyref,
+    size_t hashval) {
+  const cell *p
+    = *hashtable__search_at(ht, keyref, hashval % POW2(ht->lbnslots));
+  return p == NULL ? NULL : (void *) p->valref;
+}
+
 #if defined HASHTABLE_STATS && HASHTABLE_STATS != 0
 
 void hashtable_get_stats(hashtable *ht,
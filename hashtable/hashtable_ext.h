@@ -0,0 +1,37 @@
+//  hashtable_ext.h : partie interface complémentaire du module hashtable.
+
+//  Les fonctions déclarées ici complètent celles de la partie interface
+//    hashtable.h, dont le source ne peut être modifié. Le fonctionnement
+//    général qui y est décrit s'applique à elles. Un contrôleur renvoyé avec
+//    succès par la fonction hashtable_empty_alloc est, pour toutes les
+//    fonctions du module, un contrôleur renvoyé avec succès par la fonction
+//    hashtable_empty.
+
+#ifndef HASHTABLE_EXT__H
+#define HASHTABLE_EXT__H
+
+#include <stdlib.h>
+#include "allocator.h"
+#include "hashtable.h"
+
+//  hashtable_empty_alloc : similaire à hashtable_empty, mais toutes les
+//    allocations dynamiques effectuées pour la gestion de la table de hachage,
+//    contrôleur compris, le sont à l'aide de l'allocateur pointé par al, qui
+//    doit rester valide jusqu'à la révocation du contrôleur. hashtable_empty
+//    équivaut à hashtable_empty_alloc avec allocator_libc().
+extern hashtable *hashtable_empty_alloc(
+    int (*compar)(const void *, const void *),
+    size_t (*hashfun)(const void *), const allocator *al);
+
+//  hashtable_clear : retire de la table de hachage associée à ht tous ses
+//    couples et libère les ressources allouées à leur gestion. La table est
+//    ensuite dans l'état où l'a laissée hashtable_empty.
+extern void hashtable_clear(hashtable *ht);
+
+//  hashtable_search_hashed : similaire à hashtable_search, hashval étant
+//    supposée égale à la valeur de la fonction de pré-hachage pour la clé de
+//    référence keyref, qui n'est donc pas recalculée.
+extern void *hashtable_search_hashed(hashtable *ht, const void *keyref,
+    size_t hashval);
+
+#endif
@@ -1,75 +1,132 @@
 //  Partie implantation du module holdall.
 
-#include "holdall.h"
+#include "holdall_ext.h"
 
-//  struct holdall, holdall : implantation par tableau dynamique
+//  struct holdall, holdall : implantation par répertoire de blocs de taille
+//    fixe. Les blocs ne sont jamais déplacés : seul le répertoire, petit, est
+//    réalloué lorsqu'il est plein
 
 #include <limits.h>
 #include <stdint.h>
+#include <string.h>
+#include "allocator.h"
 
-//  HA__CAPACITY_MIN : Taille minimale (et celle d'origine) du tableau
-//    dynamique d'un fourretout
-#define HA__CAPACITY_MIN 4
+//  HA__BLOCK_SHIFT : logarithme en base 2 du nombre de références d'un bloc
+#define HA__BLOCK_SHIFT 10
 
-//  HA__CAPACITY_MUL : facteur par lequel est multipliée la taille du tableau
-//    dynamique d'un fourretout lorsque celui-ci est plein
-#define HA__CAPACITY_MUL 2
+//  HA__BLOCK_LEN : nombre de références d'un bloc
+#define HA__BLOCK_LEN ((size_t) 1 << HA__BLOCK_SHIFT)
+
+//  HA__DIR_MIN : Taille minimale (et celle d'origine) du répertoire d'un
+//    fourretout
+#define HA__DIR_MIN 4
+
+//  HA__DIR_MUL : facteur par lequel est multipliée la taille du répertoire
+//    d'un fourretout lorsque celui-ci est plein
+#define HA__DIR_MUL 2
 
 //  Structure ------------------------------------------------------------------
 
+//  struct holdall : le répertoire dir de longueur dir_size repère, sur ses
+//    nblocks premières entrées, des blocs de HA__BLOCK_LEN références. La
+//    référence de rang i figure à l'indice i % HA__BLOCK_LEN du bloc d'indice
+//    i / HA__BLOCK_LEN.
 struct holdall {
-  void **harr;
-  size_t harr_size;
+  void ***dir;
+  size_t dir_size;
+  size_t nblocks;
   size_t count;
+  const allocator *al;
 };
 
-//  Fonction auxiliaire --------------------------------------------------------
+//  HA__REF : désigne la référence de rang i du fourretout ha.
+#define HA__REF(ha, i)                                                         \
+  ((ha)->dir[(i) >> HA__BLOCK_SHIFT][(i) & (HA__BLOCK_LEN - 1)])
 
-//  holdall_increase_capacity : multiplie la capacité du fourretout ha (c'est-
-//    à-dire la taille de son tableau) par HA__CAPACITY_MUL. Renvoie -1 en cas
-//    de dépassement de capacité, et ha reste inchangé. Renvoie sinon 0.
-int holdall__increase_capacity(holdall *ha) {
-  if (ha->harr_size > SIZE_MAX / HA__CAPACITY_MUL) {
-    return -1;
+//  Fonctions auxiliaires ------------------------------------------------------
+
+//  holdall__add_block : ajoute un bloc au fourretout ha, en multipliant au
+//    besoin la taille de son répertoire par HA__DIR_MUL. Renvoie -1 en cas de
+//    dépassement de capacité, et ha reste inchangé. Renvoie sinon 0.
+static int holdall__add_block(holdall *ha) {
+  if (ha->nblocks == ha->dir_size) {
+    if (ha->dir_size > SIZE_MAX / HA__DIR_MUL / sizeof *ha->dir) {
+      return -1;
+    }
+    void ***t = allocator_resize(ha->al, ha->dir,
+        ha->dir_size * sizeof *ha->dir,
+        ha->dir_size * HA__DIR_MUL * sizeof *ha->dir);
+    if (t == NULL) {
+      return -1;
+    }
+    ha->dir = t;
+    ha->dir_size *= HA__DIR_MUL;
   }
-  void **t = realloc(ha->harr,
-      ha->harr_size * HA__CAPACITY_MUL * sizeof *ha->harr);
-  if (t == NULL) {
+  void **b = allocator_alloc(ha->al, HA__BLOCK_LEN * sizeof *b);
+  if (b == NULL) {
     return -1;
   }
-  ha->harr = t;
-  ha->harr_size *= HA__CAPACITY_MUL;
+  ha->dir[ha->nblocks] = b;
+  ++ha->nblocks;
   return 0;
 }
 
-//  Fonctions ------------------------------------------------------------------
-
-holdall *holdall_empty(void) {
-  holdall *ha = malloc(sizeof *ha);
+//  holdall__empty_alloc : similaire à holdall_empty, les allocations étant
+//    confiées à l'allocateur pointé par al.
+static holdall *holdall__empty_alloc(const allocator *al) {
+  holdall *ha = allocator_alloc(al, sizeof *ha);
   if (ha == NULL) {
     return NULL;
   }
-  ha->harr = malloc(HA__CAPACITY_MIN * sizeof *ha->harr);
-  if (ha->harr == NULL) {
-    free(ha);
+  ha->dir = allocator_alloc(al, HA__DIR_MIN * sizeof *ha->dir);
+  if (ha->dir == NULL) {
+    allocator_release(al, ha, sizeof *ha);
     return NULL;
   }
-  ha->harr_size = HA__CAPACITY_MIN;
+  ha->dir_size = HA__DIR_MIN;
+  ha->nblocks = 0;
   ha->count = 0;
+  ha->al = al;
   return ha;
 }
 
+//  holdall__segment : similaire à holdall_segment, le nombre de références
+//    renvoyé étant de plus borné par last - i.
+static size_t holdall__segment(holdall *ha, size_t i, size_t last,
+    void ***refs) {
+  size_t k = i & (HA__BLOCK_LEN - 1);
+  *refs = ha->dir[i >> HA__BLOCK_SHIFT] + k;
+  k = HA__BLOCK_LEN - k;
+  return k < last - i ? k : last - i;
+}
+
+//  Fonctions ------------------------------------------------------------------
+
+holdall *holdall_empty(void) {
+  return holdall__empty_alloc(allocator_libc());
+}
+
 void holdall_dispose(holdall **haptr) {
-  free((*haptr)->harr);
-  free(*haptr);
+  if (*haptr == NULL) {
+    return;
+  }
+  holdall *ha = *haptr;
+  const allocator *al = ha->al;
+  for (size_t b = 0; b < ha->nblocks; ++b) {
+    allocator_release(al, ha->dir[b], HA__BLOCK_LEN * sizeof *ha->dir[b]);
+  }
+  allocator_release(al, ha->dir, ha->dir_size * sizeof *ha->dir);
+  allocator_release(al, ha, sizeof *ha);
   *haptr = NULL;
 }
 
 int holdall_put(holdall *ha, void *ref) {
-  if (ha->count == ha->harr_size - 1 && holdall__increase_capacity(ha) != 0) {
+  if (ha->count == ha->nblocks * HA__BLOCK_LEN
+      && holdall__add_block(ha) != 0) {
     return -1;
   }
-  ha->harr[ha->count++] = ref;
+  HA__REF(ha, ha->count) = ref;
+  ++ha->count;
   return 0;
 }
 
@@ -79,11 +136,16 @@ size_t holdall_count(holdall *ha) {
 
 int holdall_apply(holdall *ha,
     int (*fun)(void *)) {
-  for (size_t i = 0; i < ha->count; ++i) {
-    int r = fun(ha->harr[i]);
-    if (r != 0) {
-      return r;
+  for (size_t i = 0; i < ha->count;) {
+    void **refs;
+    size_t k = holdall__segment(ha, i, ha->count, &refs);
+    for (size_t j = 0; j < k; ++j) {
+      int r = fun(refs[j]);
+      if (r != 0) {
+        return r;
+      }
     }
+    i += k;
   }
   return 0;
 }
@@ -91,11 +153,16 @@ int holdall_apply(holdall *ha,
 int holdall_apply_context(holdall *ha,
     void *context, void *(*fun1)(void *context, void *ptr),
     int (*fun2)(void *ptr, void *resultfun1)) {
-  for (size_t i = 0; i < ha->count; ++i) {
-    int r = fun2(ha->harr[i], fun1(context, ha->harr[i]));
-    if (r != 0) {
-      return r;
+  for (size_t i = 0; i < ha->count;) {
+    void **refs;
+    size_t k = holdall__segment(ha, i, ha->count, &refs);
+    for (size_t j = 0; j < k; ++j) {
+      int r = fun2(refs[j], fun1(context, refs[j]));
+      if (r != 0) {
+        return r;
+      }
     }
+    i += k;
   }
   return 0;
 }
@@ -103,11 +170,16 @@ int holdall_apply_context(holdall *ha,
 int holdall_apply_context2(holdall *ha,
     void *context1, void *(*fun1)(void *context1, void *ptr),
     void *context2, int (*fun2)(void *context2, void *ptr, void *resultfun1)) {
-  for (size_t i = 0; i < ha->count; ++i) {
-    int r = fun2(context2, ha->harr[i], fun1(context1, ha->harr[i]));
-    if (r != 0) {
-      return r;
+  for (size_t i = 0; i < ha->count;) {
+    void **refs;
+    size_t k = holdall__segment(ha, i, ha->count, &refs);
+    for (size_t j = 0; j < k; ++j) {
+      int r = fun2(context2, refs[j], fun1(context1, refs[j]));
+      if (r != 0) {
+        return r;
+      }
     }
+    i += k;
   }
   return 0;
 }
@@ -116,8 +188,173 @@ int holdall_apply_context2(holdall *ha,
 
 #if defined HOLDALL_WANT_EXT && HOLDALL_WANT_EXT != 0
 
+//  holdall__gather : renvoie l'adresse d'un tableau qui contient, dans l'ordre,
+//    les références de rang compris entre first inclus et last exclu du
+//    fourretout ha. Ce tableau est celui d'un bloc si elles y figurent toutes,
+//    une copie allouée à l'aide de ha->al sinon. Renvoie NULL en cas de
+//    dépassement de capacité.
+static void **holdall__gather(holdall *ha, size_t first, size_t last) {
+  void **refs;
+  if (first == last || holdall__segment(ha, first, last, &refs)
+      == last - first) {
+    return first == last ? NULL : refs;
+  }
+  void **t = allocator_alloc(ha->al, (last - first) * sizeof *t);
+  if (t == NULL) {
+    return NULL;
+  }
+  for (size_t i = first; i < last;) {
+    size_t k = holdall__segment(ha, i, last, &refs);
+    memcpy(t + (i - first), refs, k * sizeof *refs);
+    i += k;
+  }
+  return t;
+}
+
+//  holdall__scatter : recopie dans le fourretout ha, aux rangs compris entre
+//    first inclus et last exclu, les références du tableau t renvoyé par
+//    holdall__gather pour ces rangs, puis libère t s'il s'agit d'une copie.
+static void holdall__scatter(holdall *ha, size_t first, size_t last,
+    void **t) {
+  void **refs;
+  if (holdall__segment(ha, first, last, &refs) == last - first) {
+    return;
+  }
+  for (size_t i = first; i < last;) {
+    size_t k = holdall__segment(ha, i, last, &refs);
+    memcpy(refs, t + (i - first), k * sizeof *refs);
+    i += k;
+  }
+  allocator_release(ha->al, t, (last - first) * sizeof *t);
+}
+
+//  holdall__sift : sert pour holdall__heapsort. Rétablit, à partir de
+//    l'indice i, la propriété de tas maximal selon compar du tas de longueur n
+//    formé des références du fourretout ha de rang first et suivants.
+static void holdall__sift(holdall *ha, size_t first, size_t n, size_t i,
+    int (*compar)(const void *, const void *)) {
+  while (2 * i + 1 < n) {
+    size_t c = 2 * i + 1;
+    if (c + 1 < n && compar(&HA__REF(ha, first + c + 1),
+        &HA__REF(ha, first + c)) > 0) {
+      ++c;
+    }
+    if (compar(&HA__REF(ha, first + c), &HA__REF(ha, first + i)) <= 0) {
+      return;
+    }
+    void *t = HA__REF(ha, first + i);
+    HA__REF(ha, first + i) = HA__REF(ha, first + c);
+    HA__REF(ha, first + c) = t;
+    i = c;
+  }
+}
+
+//  holdall__heapsort : trie sur place, par tas, les références du fourretout
+//    ha de rang compris entre first inclus et last exclu selon compar. Sert
+//    lorsque la mémoire manque pour les rassembler dans un tableau.
+static void holdall__heapsort(holdall *ha, size_t first, size_t last,
+    int (*compar)(const void *, const void *)) {
+  size_t n = last - first;
+  for (size_t i = n / 2; i > 0; --i) {
+    holdall__sift(ha, first, n, i - 1, compar);
+  }
+  while (n > 1) {
+    --n;
+    void *t = HA__REF(ha, first);
+    HA__REF(ha, first) = HA__REF(ha, first + n);
+    HA__REF(ha, first + n) = t;
+    holdall__sift(ha, first, n, 0, compar);
+  }
+}
+
 void holdall_sort(holdall *ha, int (*compar)(const void *, const void *)) {
-  qsort(ha->harr, ha->count, sizeof(void *), compar);
+  holdall_sort_slice(ha, 0, ha->count, compar);
+}
+
+void holdall_sort_slice(holdall *ha, size_t first, size_t last,
+    int (*compar)(const void *, const void *)) {
+  if (last - first < 2) {
+    return;
+  }
+  void **t = holdall__gather(ha, first, last);
+  if (t == NULL) {
+    holdall__heapsort(ha, first, last, compar);
+    return;
+  }
+  qsort(t, last - first, sizeof *t, compar);
+  holdall__scatter(ha, first, last, t);
+}
+
+void holdall_filter_context(holdall *ha, void *context,
+    bool (*keep)(void *context, void *ref)) {
+  size_t j = 0;
+  for (size_t i = 0; i < ha->count;) {
+    void **refs;
+    size_t k = holdall__segment(ha, i, ha->count, &refs);
+    for (size_t l = 0; l < k; ++l) {
+      if (keep(context, refs[l])) {
+        HA__REF(ha, j) = refs[l];
+        ++j;
+      }
+    }
+    i += k;
+  }
+  ha->count = j;
+  size_t n = (j + HA__BLOCK_LEN - 1) >> HA__BLOCK_SHIFT;
+  while (ha->nblocks > n) {
+    --ha->nblocks;
+    allocator_release(ha->al, ha->dir[ha->nblocks],
+        HA__BLOCK_LEN * sizeof *ha->dir[ha->nblocks]);
+  }
+}
+
+holdall *holdall_empty_alloc(const allocator *al) {
+  return holdall__empty_alloc(al);
+}
+
+int holdall_apply_slice(holdall *ha, size_t first, size_t last,
+    void *context, int (*fun)(void *context, void *ref)) {
+  for (size_t i = first; i < last;) {
+    void **refs;
+    size_t k = holdall__segment(ha, i, last, &refs);
+    for (size_t j = 0; j < k; ++j) {
+      int r = fun(context, refs[j]);
+      if (r != 0) {
+        return r;
+      }
+    }
+    i += k;
+  }
+  return 0;
+}
+
+int holdall_reorder(holdall *ha, size_t first, size_t last, void *context,
+    void (*fun)(void *context, void **refs, size_t n)) {
+  void **t = holdall__gather(ha, first, last);
+  if (t == NULL && first != last) {
+    return -1;
+  }
+  fun(context, t, last - first);
+  if (first != last) {
+    holdall__scatter(ha, first, last, t);
+  }
+  return 0;
+}
+
+int holdall_reserve(holdall *ha, size_t n) {
+  if (n > SIZE_MAX - ha->count - HA__BLOCK_LEN) {
+    return -1;
+  }
+  while (ha->nblocks * HA__BLOCK_LEN < ha->count + n) {
+    if (holdall__add_block(ha) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+size_t holdall_segment(holdall *ha, size_t i, void ***refs) {
+  return holdall__segment(ha, i, ha->count, refs);
 }
 
 #endif
@@ -0,0 +1,92 @@
+//  Partie interface complémentaire du module holdall (fourretout).
+//
+//  Les fonctions déclarées ici complètent celles de la partie interface
+//    holdall.h, dont le source ne peut être modifié. Elles sont définies par la
+//    partie implantation du module lorsque celui-ci gère l'extension.
+//
+//  holdall_filter_context retire des références d'un fourretout. Pour tout
+//    fourretout, la spécification de holdall_count figurant dans holdall.h est
+//    étendue ainsi : holdall_count renvoie le nombre d'insertions effectuées
+//    avec succès dans le fourretout associé à ha depuis sa création, diminué du
+//    nombre de références qui en ont été retirées par holdall_filter_context,
+//    c'est-à-dire le nombre de références qu'il contient.
+
+#ifndef HOLDALL_EXT__H
+#define HOLDALL_EXT__H
+
+#include <stdbool.h>
+#include "allocator.h"
+#include "holdall.h"
+
+#if defined HOLDALL_WANT_EXT && HOLDALL_WANT_EXT != 0
+
+//  holdall_filter_context : parcourt le fourretout associé à ha en appelant
+//    keep(context, ref) pour chacune des références ref dans l'ordre dans
+//    lequel elles figurent dans le fourretout, et retire du fourretout les
+//    références pour lesquelles l'appel renvoie false. L'ordre relatif des
+//    références conservées est préservé. Il est permis à keep de disposer de
+//    l'objet repéré par ref lorsqu'elle renvoie false. Après l'appel,
+//    holdall_count renvoie le nombre de références conservées ; les
+//    ressources devenues inutiles sont, si possible, libérées.
+extern void holdall_filter_context(holdall *ha, void *context,
+    bool (*keep)(void *context, void *ref));
+
+//  holdall_empty_alloc : similaire à holdall_empty, mais toutes les
+//    allocations dynamiques effectuées pour la gestion du fourretout,
+//    contrôleur compris, le sont à l'aide de l'allocateur pointé par al, qui
+//    doit rester valide jusqu'à la révocation du contrôleur. holdall_empty
+//    équivaut à holdall_empty_alloc avec allocator_libc().
+extern holdall *holdall_empty_alloc(const allocator *al);
+
+//  holdall_apply_slice : parcourt les références du fourretout associé à ha
+//    dont le rang, compté à partir de 0 dans l'ordre dans lequel elles y
+//    figurent, est compris entre first inclus et last exclu, en appelant
+//    fun(context, ref) pour chacune d'elles dans cet ordre. last est supposé
+//    au plus égal à holdall_count(ha). Si, lors du parcours, la valeur de
+//    l'appel n'est pas nulle, l'exécution de la fonction prend fin et la
+//    fonction renvoie cette valeur. Sinon, la fonction renvoie zéro.
+extern int holdall_apply_slice(holdall *ha, size_t first, size_t last,
+    void *context, int (*fun)(void *context, void *ref));
+
+//  holdall_sort_slice : similaire à holdall_sort, le tri ne portant que sur
+//    les références de rang compris entre first inclus et last exclu, last
+//    étant supposé au plus égal à holdall_count(ha). Les autres références ne
+//    sont pas déplacées.
+extern void holdall_sort_slice(holdall *ha, size_t first, size_t last,
+    int (*compar)(const void *, const void *));
+
+//  holdall_reorder : appelle fun(context, refs, n), refs étant l'adresse d'un
+//    tableau qui contient, dans l'ordre dans lequel elles figurent dans le
+//    fourretout associé à ha, ses n = last - first références de rang compris
+//    entre first inclus et last exclu, last étant supposé au plus égal à
+//    holdall_count(ha). fun peut permuter les éléments du tableau, mais pas en
+//    modifier les valeurs ; les références figurent ensuite dans le fourretout
+//    dans l'ordre obtenu. Permet de réorganiser le fourretout par un tri autre
+//    que celui de holdall_sort. Renvoie une valeur non nulle, sans appeler fun
+//    et le fourretout restant inchangé, en cas de dépassement de capacité.
+//    Renvoie sinon zéro.
+extern int holdall_reorder(holdall *ha, size_t first, size_t last,
+    void *context, void (*fun)(void *context, void **refs, size_t n));
+
+//  holdall_reserve : tente de faire en sorte que les n prochaines insertions
+//    au fourretout associé à ha n'échouent pas pour cause de dépassement de
+//    capacité. Renvoie une valeur non nulle en cas de dépassement de capacité,
+//    les ressources éventuellement allouées restant acquises au fourretout.
+//    Renvoie sinon zéro.
+extern int holdall_reserve(holdall *ha, size_t n);
+
+//  holdall_segment : affecte à *refs l'adresse de la référence de rang i,
+//    compté à partir de 0, du fourretout associé à ha, i étant supposé
+//    strictement inférieur à holdall_count(ha). Renvoie le nombre, au moins
+//    égal à 1, des références qui figurent de manière contiguë à partir de
+//    cette adresse, dans l'ordre dans lequel elles figurent dans le
+//    fourretout. Permet de parcourir le fourretout par segments, sans appel de
+//    fonction par référence. L'adresse reste valide tant que le fourretout
+//    n'est modifié que par holdall_put ou holdall_reserve ; les références
+//    du segment peuvent être permutées entre elles ou avec celles d'autres
+//    segments du fourretout, mais pas modifiées.
+extern size_t holdall_segment(holdall *ha, size_t i, void ***refs);
+
+#endif
+
+#endif
@@ -0,0 +1,240 @@
+//  Partie implantation du module outbuf.
+
+#include "outbuf.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+//  OUTBUF__SIZE : capacité en octets d'un tampon associé à un descripteur.
+#define OUTBUF__SIZE 65536
+
+//  OUTBUF__SIZE_MIN : capacité initiale en octets d'un tampon sans
+//    descripteur.
+#define OUTBUF__SIZE_MIN 4096
+
+//  OUTBUF__SIZE_MUL : multiplicateur de la capacité d'un tampon sans
+//    descripteur lorsqu'il est plein.
+#define OUTBUF__SIZE_MUL 2
+
+//  OUTBUF__IOV_MAX : nombre maximal de zones écrites par un appel à writev.
+#ifdef IOV_MAX
+#define OUTBUF__IOV_MAX IOV_MAX
+#else
+#define OUTBUF__IOV_MAX 16
+#endif
+
+//  struct outbuf : le tableau buf de longueur capacity contient sur ses size
+//    premiers octets le texte écrit et pas encore vidé. fd est le descripteur
+//    sur lequel le tampon est vidé, négatif s'il n'y en a pas. error indique
+//    qu'une erreur est survenue.
+struct outbuf {
+  int fd;
+  char *buf;
+  size_t size;
+  size_t capacity;
+  bool error;
+};
+
+//  outbuf__tabs : suite de tabulations recopiée par outbuf_tabs.
+static const char outbuf__tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"
+    "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+//  outbuf__digits : écritures décimales sur deux chiffres des entiers de 0 à
+//    99, recopiées par outbuf_ulong.
+static const char outbuf__digits[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+//  outbuf__write_all : écrit les n octets pointés par s sur le descripteur fd,
+//    en répétant l'appel à write tant qu'il reste des octets à écrire.
+//    Renvoie 0 en cas de succès, une valeur non nulle en cas d'erreur.
+static int outbuf__write_all(int fd, const char *s, size_t n) {
+  while (n > 0) {
+    ssize_t r = write(fd, s, n);
+    if (r < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return 1;
+    }
+    s += r;
+    n -= (size_t) r;
+  }
+  return 0;
+}
+
+//  outbuf__reserve : fait en sorte que le tampon associé à ob puisse recevoir
+//    n octets de plus, en le vidant sur son descripteur ou, s'il n'en a pas,
+//    en augmentant sa capacité. Renvoie 0 en cas de succès, une valeur non
+//    nulle en cas d'erreur ou si n dépasse la capacité d'un tampon associé à
+//    un descripteur.
+static int outbuf__reserve(outbuf *ob, size_t n) {
+  if (ob->error) {
+    return 1;
+  }
+  if (ob->capacity - ob->size >= n) {
+    return 0;
+  }
+  if (ob->fd >= 0) {
+    return outbuf_flush(ob) != 0 || n > ob->capacity;
+  }
+  size_t capacity = ob->capacity;
+  while (capacity - ob->size < n) {
+    if (capacity > SIZE_MAX / OUTBUF__SIZE_MUL) {
+      ob->error = true;
+      return 1;
+    }
+    capacity *= OUTBUF__SIZE_MUL;
+  }
+  char *buf = realloc(ob->buf, capacity);
+  if (buf == NULL) {
+    ob->error = true;
+    return 1;
+  }
+  ob->buf = buf;
+  ob->capacity = capacity;
+  return 0;
+}
+
+outbuf *outbuf_empty(int fd) {
+  outbuf *ob = malloc(sizeof *ob);
+  if (ob == NULL) {
+    return NULL;
+  }
+  ob->fd = fd;
+  ob->size = 0;
+  ob->capacity = fd >= 0 ? OUTBUF__SIZE : OUTBUF__SIZE_MIN;
+  ob->error = false;
+  ob->buf = malloc(ob->capacity);
+  if (ob->buf == NULL) {
+    free(ob);
+    return NULL;
+  }
+  return ob;
+}
+
+void outbuf_dispose(outbuf **ob) {
+  if (*ob == NULL) {
+    return;
+  }
+  free((*ob)->buf);
+  free(*ob);
+  *ob = NULL;
+}
+
+int outbuf_write(outbuf *ob, const char *s, size_t n) {
+  if (ob->fd >= 0 && !ob->error && n > ob->capacity - ob->size) {
+    if (outbuf_flush(ob) != 0) {
+      return 1;
+    }
+    if (n >= ob->capacity) {
+      if (outbuf__write_all(ob->fd, s, n) != 0) {
+        ob->error = true;
+        return 1;
+      }
+      return 0;
+    }
+  }
+  if (outbuf__reserve(ob, n) != 0) {
+    return 1;
+  }
+  memcpy(ob->buf + ob->size, s, n);
+  ob->size += n;
+  return 0;
+}
+
+int outbuf_puts(outbuf *ob, const char *s) {
+  return outbuf_write(ob, s, strlen(s));
+}
+
+int outbuf_tabs(outbuf *ob, size_t n) {
+  while (n > sizeof outbuf__tabs - 1) {
+    if (outbuf_write(ob, outbuf__tabs, sizeof outbuf__tabs - 1) != 0) {
+      return 1;
+    }
+    n -= sizeof outbuf__tabs - 1;
+  }
+  return outbuf_write(ob, outbuf__tabs, n);
+}
+
+int outbuf_ulong(outbuf *ob, long unsigned int x, char c) {
+  char tmp[3 * sizeof x + 1];
+  char *p = tmp + sizeof tmp;
+  *--p = c;
+  while (x >= 100) {
+    size_t d = (size_t) (x % 100) * 2;
+    x /= 100;
+    *--p = outbuf__digits[d + 1];
+    *--p = outbuf__digits[d];
+  }
+  if (x >= 10) {
+    size_t d = (size_t) x * 2;
+    *--p = outbuf__digits[d + 1];
+    *--p = outbuf__digits[d];
+  } else {
+    *--p = (char) ('0' + x);
+  }
+  return outbuf_write(ob, p, (size_t) (tmp + sizeof tmp - p));
+}
+
+int outbuf_flush(outbuf *ob) {
+  if (ob->error) {
+    return 1;
+  }
+  if (ob->fd < 0 || ob->size == 0) {
+    return 0;
+  }
+  if (outbuf__write_all(ob->fd, ob->buf, ob->size) != 0) {
+    ob->error = true;
+    return 1;
+  }
+  ob->size = 0;
+  return 0;
+}
+
+int outbuf_writev(int fd, outbuf **ob, size_t n) {
+  struct iovec iov[OUTBUF__IOV_MAX];
+  int r = 0;
+  size_t k = 0;
+  while (k < n) {
+    size_t m = 0;
+    size_t total = 0;
+    for (; k < n && m < OUTBUF__IOV_MAX; ++k) {
+      if (ob[k]->error) {
+        r = 1;
+      } else if (ob[k]->size != 0) {
+        iov[m].iov_base = ob[k]->buf;
+        iov[m].iov_len = ob[k]->size;
+        total += ob[k]->size;
+        ++m;
+      }
+      ob[k]->size = 0;
+    }
+    size_t i = 0;
+    while (total > 0) {
+      ssize_t w = writev(fd, iov + i, (int) (m - i));
+      if (w < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return 1;
+      }
+      total -= (size_t) w;
+      while (i < m && (size_t) w >= iov[i].iov_len) {
+        w -= (ssize_t) iov[i].iov_len;
+        ++i;
+      }
+      if (i < m) {
+        iov[i].iov_base = (char *) iov[i].iov_base + w;
+        iov[i].iov_len -= (size_t) w;
+      }
+    }
+  }
+  return r;
+}
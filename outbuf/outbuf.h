@@ -0,0 +1,65 @@
+//  Partie interface du module outbuf (tampon de sortie).
+//
+//  Le module outbuf permet d'écrire un texte dans un tampon en mémoire, sans
+//    passer par les fonctions de formatage ni par les verrous de la
+//    bibliothèque standard. Un tampon associé à un descripteur de fichier est
+//    vidé sur celui-ci par blocs de grande taille ; un tampon sans descripteur
+//    croît à la demande et son contenu peut être écrit plus tard, avec celui
+//    d'autres tampons, en un seul appel à writev.
+//
+//  Fonctionnement général :
+//  - une erreur, dépassement de capacité ou erreur d'écriture, est
+//      mémorisée par le tampon : les écritures suivantes sont alors sans effet
+//      et toutes les fonctions qui renvoient un int renvoient une valeur non
+//      nulle.
+
+#ifndef OUTBUF__H
+#define OUTBUF__H
+
+#include <stdlib.h>
+
+//  struct outbuf, outbuf : type et nom de type d'un contrôleur regroupant les
+//    informations permettant de gérer un tampon de sortie.
+typedef struct outbuf outbuf;
+
+//  outbuf_empty : tente d'allouer les ressources nécessaires pour gérer un
+//    nouveau tampon vide. Si fd est positif ou nul, le tampon est vidé sur le
+//    descripteur fd dès qu'il est plein ; sinon, il croît à la demande.
+//    Renvoie NULL en cas de dépassement de capacité, un pointeur vers le
+//    contrôleur associé sinon.
+extern outbuf *outbuf_empty(int fd);
+
+//  outbuf_dispose : sans effet si *ob vaut NULL. Libère sinon les ressources
+//    allouées à la gestion du tampon associé à *ob, sans le vider, puis
+//    affecte NULL à *ob.
+extern void outbuf_dispose(outbuf **ob);
+
+//  outbuf_write : écrit les n octets pointés par s dans le tampon associé à
+//    ob. Renvoie 0 en cas de succès, une valeur non nulle en cas d'erreur.
+extern int outbuf_write(outbuf *ob, const char *s, size_t n);
+
+//  outbuf_puts : écrit la chaine pointée par s dans le tampon associé à ob.
+//    Renvoie 0 en cas de succès, une valeur non nulle en cas d'erreur.
+extern int outbuf_puts(outbuf *ob, const char *s);
+
+//  outbuf_tabs : écrit n caractères de tabulation dans le tampon associé à
+//    ob. Renvoie 0 en cas de succès, une valeur non nulle en cas d'erreur.
+extern int outbuf_tabs(outbuf *ob, size_t n);
+
+//  outbuf_ulong : écrit l'écriture décimale de x, suivie du caractère c, dans
+//    le tampon associé à ob. Renvoie 0 en cas de succès, une valeur non nulle
+//    en cas d'erreur.
+extern int outbuf_ulong(outbuf *ob, long unsigned int x, char c);
+
+//  outbuf_flush : vide le tampon associé à ob sur son descripteur, sauf s'il
+//    n'en a pas. Renvoie 0 en cas de succès, une valeur non nulle en cas
+//    d'erreur.
+extern int outbuf_flush(outbuf *ob);
+
+//  outbuf_writev : écrit sur le descripteur fd, dans l'ordre, le contenu des
+//    n tampons sans descripteur du tableau ob, à l'aide d'aussi peu d'appels à
+//    writev que possible, puis les vide. Renvoie 0 en cas de succès, une
+//    valeur non nulle en cas d'erreur ou si l'un des tampons est en erreur.
+extern int outbuf_writev(int fd, outbuf **ob, size_t n);
+
+#endif
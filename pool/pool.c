@@ -0,0 +1,127 @@
+//  Partie implantation du module pool.
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+
+//  struct pool : les composants mutex et cond protègent et signalent toute
+//    modification de l'état du groupe. Le tableau threads de longueur nthreads
+//    mémorise les fils démarrés. next est le numéro de la prochaine tâche à
+//    démarrer, consumed le nombre de résultats récupérés par pool_wait. Les
+//    tableaux done et result de longueur ntasks indiquent si chaque tâche est
+//    terminée et mémorisent son résultat. cancel indique que les tâches non
+//    démarrées doivent être abandonnées.
+struct pool {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  pthread_t *threads;
+  size_t nthreads;
+  size_t ntasks;
+  size_t window;
+  size_t next;
+  size_t consumed;
+  bool *done;
+  int *result;
+  bool cancel;
+  void *context;
+  int (*fun)(void *context, size_t k);
+};
+
+//  pool__worker : fonction exécutée par chacun des fils du groupe pointé par
+//    arg. Démarre la prochaine tâche tant qu'il en reste, que la fenêtre le
+//    permet et que le groupe n'est pas abandonné.
+static void *pool__worker(void *arg) {
+  pool *p = arg;
+  pthread_mutex_lock(&p->mutex);
+  while (true) {
+    while (!p->cancel && p->next < p->ntasks
+        && p->next >= p->consumed + p->window) {
+      pthread_cond_wait(&p->cond, &p->mutex);
+    }
+    if (p->cancel || p->next >= p->ntasks) {
+      break;
+    }
+    size_t k = p->next;
+    ++p->next;
+    pthread_mutex_unlock(&p->mutex);
+    int r = p->fun(p->context, k);
+    pthread_mutex_lock(&p->mutex);
+    p->result[k] = r;
+    p->done[k] = true;
+    pthread_cond_broadcast(&p->cond);
+  }
+  pthread_mutex_unlock(&p->mutex);
+  return NULL;
+}
+
+pool *pool_start(size_t nthreads, size_t ntasks, size_t window,
+    void *context, int (*fun)(void *context, size_t k)) {
+  pool *p = malloc(sizeof *p);
+  if (p == NULL) {
+    return NULL;
+  }
+  p->threads = malloc(nthreads * sizeof *p->threads);
+  p->done = calloc(ntasks, sizeof *p->done);
+  p->result = malloc(ntasks * sizeof *p->result);
+  if (p->threads == NULL || p->done == NULL || p->result == NULL) {
+    goto error;
+  }
+  pthread_mutex_init(&p->mutex, NULL);
+  pthread_cond_init(&p->cond, NULL);
+  p->nthreads = 0;
+  p->ntasks = ntasks;
+  p->window = window;
+  p->next = 0;
+  p->consumed = 0;
+  p->cancel = false;
+  p->context = context;
+  p->fun = fun;
+  while (p->nthreads < nthreads
+      && pthread_create(&p->threads[p->nthreads], NULL, pool__worker, p)
+      == 0) {
+    ++p->nthreads;
+  }
+  if (p->nthreads == 0) {
+    pool_dispose(&p);
+  }
+  return p;
+error:
+  free(p->threads);
+  free(p->done);
+  free(p->result);
+  free(p);
+  return NULL;
+}
+
+int pool_wait(pool *p, size_t k) {
+  pthread_mutex_lock(&p->mutex);
+  while (!p->done[k]) {
+    pthread_cond_wait(&p->cond, &p->mutex);
+  }
+  int r = p->result[k];
+  p->consumed = k + 1;
+  pthread_cond_broadcast(&p->cond);
+  pthread_mutex_unlock(&p->mutex);
+  return r;
+}
+
+void pool_dispose(pool **p) {
+  if (*p == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&(*p)->mutex);
+  (*p)->cancel = true;
+  pthread_cond_broadcast(&(*p)->cond);
+  pthread_mutex_unlock(&(*p)->mutex);
+  for (size_t k = 0; k < (*p)->nthreads; ++k) {
+    pthread_join((*p)->threads[k], NULL);
+  }
+  pthread_cond_destroy(&(*p)->cond);
+  pthread_mutex_destroy(&(*p)->mutex);
+  free((*p)->threads);
+  free((*p)->done);
+  free((*p)->result);
+  free(*p);
+  *p = NULL;
+}
@@ -0,0 +1,38 @@
+//  Partie interface du module pool (groupe de travailleurs).
+//
+//  Le module pool permet d'exécuter une suite de tâches indépendantes,
+//    numérotées à partir de 0, sur un groupe de fils d'exécution, tout en
+//    récupérant leurs résultats dans l'ordre des numéros. Les tâches sont
+//    démarrées dans l'ordre de leurs numéros, par le premier fil disponible.
+
+#ifndef POOL__H
+#define POOL__H
+
+#include <stdlib.h>
+
+//  struct pool, pool : type et nom de type d'un contrôleur regroupant les
+//    informations permettant de gérer un groupe de travailleurs.
+typedef struct pool pool;
+
+//  pool_start : tente de démarrer nthreads fils d'exécution qui appellent
+//    fun(context, k) pour chaque numéro de tâche k compris entre 0 et
+//    ntasks - 1. Au plus window tâches, supposé non nul, sont démarrées ou
+//    terminées sans que leur résultat n'ait été récupéré par pool_wait, ce qui
+//    borne les ressources retenues par les tâches en avance. Renvoie NULL en
+//    cas de dépassement de capacité ou si aucun fil n'a pu être démarré.
+//    Renvoie sinon un pointeur vers le contrôleur associé.
+extern pool *pool_start(size_t nthreads, size_t ntasks, size_t window,
+    void *context, int (*fun)(void *context, size_t k));
+
+//  pool_wait : attend la fin de la tâche de numéro k du groupe associé à p et
+//    renvoie la valeur renvoyée par fun pour cette tâche. Les appels à
+//    pool_wait doivent se faire pour k = 0, 1, 2... dans cet ordre.
+extern int pool_wait(pool *p, size_t k);
+
+//  pool_dispose : sans effet si *p vaut NULL. Sinon, renonce aux tâches du
+//    groupe associé à *p qui n'ont pas encore démarré, attend la fin de celles
+//    en cours, libère les ressources allouées à la gestion du groupe puis
+//    affecte NULL à *p.
+extern void pool_dispose(pool **p);
+
+#endif
@@ -0,0 +1,194 @@
+//  Partie implantation du module psort.
+
+#include "psort.h"
+
+#include <stdint.h>
+#include <string.h>
+#include "steal.h"
+
+//  PSORT__RUN_MIN : longueur minimale d'un segment trié séparément.
+#define PSORT__RUN_MIN 8192
+
+//  struct psort__job, psort__job : contexte des tâches d'une étape du tri. Les
+//    segments sont repérés dans src par le tableau bound de longueur nrun + 1 :
+//    le segment de numéro k s'étend de l'indice bound[k] inclus à
+//    bound[k + 1] exclu. Lors d'une fusion, les segments de numéros 2j et
+//    2j + 1 sont fusionnés dans dst à partir de l'indice bound[2j], en nseg
+//    tranches. compar est la fonction de comparaison.
+typedef struct psort__job psort__job;
+
+struct psort__job {
+  void **src;
+  void **dst;
+  const size_t *bound;
+  size_t nrun;
+  size_t nseg;
+  int (*compar)(const void *, const void *);
+};
+
+//  psort__run : exécute fun(job, 0, k) pour tout k compris entre 0 et
+//    ntasks - 1, sur nthreads fils si possible, sinon sur le fil appelant.
+static void psort__run(psort__job *job, size_t nthreads, size_t ntasks,
+    int (*fun)(psort__job *job, size_t worker, size_t k)) {
+  if (steal_run(nthreads, ntasks, job,
+      (int (*)(void *, size_t, size_t))fun) < 0) {
+    for (size_t k = 0; k < ntasks; ++k) {
+      fun(job, 0, k);
+    }
+  }
+}
+
+//  psort__sort_run : trie par qsort le segment de numéro k de job->src.
+//    Renvoie 0.
+static int psort__sort_run(psort__job *job, size_t worker, size_t k) {
+  (void) worker;
+  qsort(job->src + job->bound[k], job->bound[k + 1] - job->bound[k],
+      sizeof *job->src, job->compar);
+  return 0;
+}
+
+//  psort__sift : sert pour psort__heapsort. Rétablit, à partir de l'indice i,
+//    la propriété de tas maximal selon compar du tas formé des n références
+//    du tableau base.
+static void psort__sift(void **base, size_t n, size_t i,
+    int (*compar)(const void *, const void *)) {
+  while (2 * i + 1 < n) {
+    size_t c = 2 * i + 1;
+    if (c + 1 < n && compar(&base[c + 1], &base[c]) > 0) {
+      ++c;
+    }
+    if (compar(&base[c], &base[i]) <= 0) {
+      return;
+    }
+    void *t = base[i];
+    base[i] = base[c];
+    base[c] = t;
+    i = c;
+  }
+}
+
+//  psort__heapsort : trie sur place, par tas, les n références du tableau base
+//    selon compar. Sert lorsque la mémoire manque, qsort pouvant allouer un
+//    tableau temporaire.
+static void psort__heapsort(void **base, size_t n,
+    int (*compar)(const void *, const void *)) {
+  for (size_t i = n / 2; i > 0; --i) {
+    psort__sift(base, n, i - 1, compar);
+  }
+  while (n > 1) {
+    --n;
+    void *t = base[0];
+    base[0] = base[n];
+    base[n] = t;
+    psort__sift(base, n, 0, compar);
+  }
+}
+
+//  psort__corank : renvoie le nombre d'éléments issus de la suite a de
+//    longueur na parmi les k premiers éléments de la fusion stable de a et de
+//    la suite b de longueur nb, selon compar.
+static size_t psort__corank(size_t k, void **a, size_t na, void **b,
+    size_t nb, int (*compar)(const void *, const void *)) {
+  size_t lo = k > nb ? k - nb : 0;
+  size_t hi = k < na ? k : na;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (compar(&a[mid], &b[k - mid - 1]) <= 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+//  psort__merge_slice : produit la tranche de numéro k % job->nseg de la
+//    fusion des segments de numéros 2j et 2j + 1 de job->src, où j vaut
+//    k / job->nseg. Le segment 2j + 1 est vide s'il n'existe pas. Renvoie 0.
+static int psort__merge_slice(psort__job *job, size_t worker, size_t k) {
+  (void) worker;
+  size_t j = k / job->nseg;
+  size_t s = k % job->nseg;
+  size_t first = job->bound[2 * j];
+  size_t mid = job->bound[2 * j + 1];
+  size_t last = 2 * j + 2 <= job->nrun ? job->bound[2 * j + 2] : mid;
+  void **a = job->src + first;
+  void **b = job->src + mid;
+  size_t na = mid - first;
+  size_t nb = last - mid;
+  size_t len = na + nb;
+  size_t k0 = len / job->nseg * s + len % job->nseg * s / job->nseg;
+  size_t k1 = len / job->nseg * (s + 1)
+      + len % job->nseg * (s + 1) / job->nseg;
+  size_t i = psort__corank(k0, a, na, b, nb, job->compar);
+  size_t i1 = psort__corank(k1, a, na, b, nb, job->compar);
+  size_t l = k0 - i;
+  size_t l1 = k1 - i1;
+  void **out = job->dst + first + k0;
+  while (i < i1 && l < l1) {
+    if (job->compar(&b[l], &a[i]) < 0) {
+      *out++ = b[l++];
+    } else {
+      *out++ = a[i++];
+    }
+  }
+  memcpy(out, a + i, (i1 - i) * sizeof *out);
+  memcpy(out + (i1 - i), b + l, (l1 - l) * sizeof *out);
+  return 0;
+}
+
+void psort(void **base, size_t n, size_t nthreads,
+    int (*compar)(const void *, const void *)) {
+  psort_alloc(base, n, nthreads, compar, allocator_libc());
+}
+
+void psort_alloc(void **base, size_t n, size_t nthreads,
+    int (*compar)(const void *, const void *), const allocator *al) {
+  size_t nrun = n / PSORT__RUN_MIN < nthreads ? n / PSORT__RUN_MIN : nthreads;
+  if (nrun <= 1) {
+    qsort(base, n, sizeof *base, compar);
+    return;
+  }
+  void **tmp = n > SIZE_MAX / sizeof *tmp ? NULL
+      : allocator_alloc(al, n * sizeof *tmp);
+  size_t *bound = allocator_alloc(al, (nrun + 1) * sizeof *bound);
+  if (tmp == NULL || bound == NULL) {
+    if (tmp != NULL) {
+      allocator_release(al, tmp, n * sizeof *tmp);
+    }
+    if (bound != NULL) {
+      allocator_release(al, bound, (nrun + 1) * sizeof *bound);
+    }
+    psort__heapsort(base, n, compar);
+    return;
+  }
+  for (size_t k = 0; k <= nrun; ++k) {
+    bound[k] = n / nrun * k + n % nrun * k / nrun;
+  }
+  psort__job job = {
+    .src = base,
+    .dst = tmp,
+    .bound = bound,
+    .nrun = nrun,
+    .nseg = 1,
+    .compar = compar,
+  };
+  psort__run(&job, nthreads, nrun, psort__sort_run);
+  while (job.nrun > 1) {
+    size_t npair = (job.nrun + 1) / 2;
+    job.nseg = (nthreads + npair - 1) / npair;
+    psort__run(&job, nthreads, npair * job.nseg, psort__merge_slice);
+    for (size_t j = 0; j <= npair; ++j) {
+      bound[j] = 2 * j < job.nrun ? bound[2 * j] : n;
+    }
+    job.nrun = npair;
+    void **t = job.src;
+    job.src = job.dst;
+    job.dst = t;
+  }
+  if (job.src != base) {
+    memcpy(base, job.src, n * sizeof *base);
+  }
+  allocator_release(al, tmp, n * sizeof *tmp);
+  allocator_release(al, bound, (nrun + 1) * sizeof *bound);
+}
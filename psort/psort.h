@@ -0,0 +1,34 @@
+//  Partie interface du module psort (tri parallèle).
+//
+//  Le module psort permet de trier un tableau de références sur plusieurs fils
+//    d'exécution. Le tableau est découpé en autant de segments que de fils,
+//    chaque segment est trié séparément par qsort, puis les segments triés
+//    sont fusionnés deux à deux jusqu'à n'en former plus qu'un. Chaque fusion
+//    est elle-même partagée entre plusieurs fils : la suite fusionnée est
+//    découpée en tranches de même longueur dont les origines dans les deux
+//    segments sont déterminées par recherche dichotomique.
+
+#ifndef PSORT__H
+#define PSORT__H
+
+#include <stdlib.h>
+#include "allocator.h"
+
+//  psort : trie les n références du tableau base selon la fonction de
+//    comparaison compar, appliquée comme par qsort(base, n, sizeof *base,
+//    compar), à l'aide d'au plus nthreads fils d'exécution. La fusion est
+//    stable ; lorsque compar définit un ordre total, le résultat est donc
+//    celui de qsort. Le tri est effectué par qsort sur le seul fil appelant si
+//    nthreads vaut au plus 1 ou si n est trop petit pour en tirer profit, et
+//    sur place, par tas, en cas de dépassement de capacité. psort équivaut à
+//    psort_alloc avec allocator_libc().
+extern void psort(void **base, size_t n, size_t nthreads,
+    int (*compar)(const void *, const void *));
+
+//  psort_alloc : similaire à psort, mais le tableau temporaire de n références
+//    et le tableau des bornes des segments sont alloués à l'aide de
+//    l'allocateur pointé par al.
+extern void psort_alloc(void **base, size_t n, size_t nthreads,
+    int (*compar)(const void *, const void *), const allocator *al);
+
+#endif
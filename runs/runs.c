@@ -0,0 +1,309 @@
+//  Partie implantation du module runs.
+
+#include "runs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//  Un état de mot est formé de la longueur de sa chaine (size_t), de ses
+//    caractères, de son canal (int) et de son compteur (long unsigned int).
+
+//  struct runs : les tableaux run et level, de longueur capacity, mémorisent
+//    pour chacune des nrun suites le flot de son fichier temporaire et sa
+//    génération. Les générations sont décroissantes au sens large dans
+//    l'ordre des suites, si bien que les suites d'une même génération sont
+//    consécutives. compar est la fonction de comparaison des chaines selon
+//    l'ordre des suites.
+struct runs {
+  FILE **run;
+  unsigned int *level;
+  size_t nrun;
+  size_t capacity;
+  int (*compar)(const char *, const char *);
+};
+
+//  runs__compare_reverse : compare les chaines s1 et s2 dans l'ordre inverse
+//    de strcoll.
+static int runs__compare_reverse(const char *s1, const char *s2) {
+  return strcoll(s2, s1);
+}
+
+runs *runs_empty(bool reversed) {
+  runs *rs = malloc(sizeof *rs);
+  if (rs == NULL) {
+    return NULL;
+  }
+  rs->run = NULL;
+  rs->level = NULL;
+  rs->nrun = 0;
+  rs->capacity = 0;
+  rs->compar = reversed ? runs__compare_reverse : strcoll;
+  return rs;
+}
+
+void runs_dispose(runs **rs) {
+  if (*rs == NULL) {
+    return;
+  }
+  for (size_t k = 0; k < (*rs)->nrun; ++k) {
+    fclose((*rs)->run[k]);
+  }
+  free((*rs)->run);
+  free((*rs)->level);
+  free(*rs);
+  *rs = NULL;
+}
+
+//  Écriture -------------------------------------------------------------------
+
+//  runs__put : écrit dans le flot f l'état du mot de chaine s, de canal channel
+//    et de compteur count. Renvoie 2 en cas d'erreur, 0 sinon.
+static int runs__put(FILE *f, const char *s, int channel,
+    long unsigned int count) {
+  size_t len = strlen(s);
+  if (fwrite(&len, sizeof len, 1, f) != 1
+      || fwrite(s, 1, len, f) != len
+      || fwrite(&channel, sizeof channel, 1, f) != 1
+      || fwrite(&count, sizeof count, 1, f) != 1) {
+    return 2;
+  }
+  return 0;
+}
+
+//  runs__put_word : sert pour runs_write, via wc_apply_context. Écrit dans le
+//    flot f l'état du mot pointé par p. Renvoie 2 en cas d'erreur, 0 sinon.
+static int runs__put_word(FILE *f, word *p) {
+  return runs__put(f, word_str(p), word_channel(p), word_count(p));
+}
+
+//  runs__add : tente d'ajouter à rs la suite de génération level écrite dans
+//    le flot f. Renvoie 1 en cas de dépassement de capacité, 0 sinon.
+static int runs__add(runs *rs, FILE *f, unsigned int level) {
+  if (rs->nrun == rs->capacity) {
+    size_t c = rs->capacity * 2 + RUNS_FANIN;
+    FILE **p = realloc(rs->run, c * sizeof *p);
+    if (p == NULL) {
+      return 1;
+    }
+    rs->run = p;
+    unsigned int *l = realloc(rs->level, c * sizeof *l);
+    if (l == NULL) {
+      return 1;
+    }
+    rs->level = l;
+    rs->capacity = c;
+  }
+  rs->run[rs->nrun] = f;
+  rs->level[rs->nrun] = level;
+  ++rs->nrun;
+  return 0;
+}
+
+//  Fusion ---------------------------------------------------------------------
+
+//  struct runs__head : tête de lecture d'une suite, dont l'état courant est
+//    formé de la chaine buf, du canal channel et du compteur count. Le tampon
+//    buf est de longueur bufsize.
+struct runs__head {
+  char *buf;
+  size_t bufsize;
+  int channel;
+  long unsigned int count;
+};
+
+//  runs__next : lit dans la tête h l'état suivant de la suite du flot f.
+//    Affecte à *more false si la suite est épuisée, true sinon. Renvoie 1 en
+//    cas de dépassement de capacité, 2 en cas d'erreur, sinon 0.
+static int runs__next(FILE *f, struct runs__head *h, bool *more) {
+  size_t len;
+  *more = fread(&len, sizeof len, 1, f) == 1;
+  if (!*more) {
+    return ferror(f) ? 2 : 0;
+  }
+  if (len >= h->bufsize) {
+    char *b = realloc(h->buf, len + 1);
+    if (b == NULL) {
+      return 1;
+    }
+    h->buf = b;
+    h->bufsize = len + 1;
+  }
+  if (fread(h->buf, 1, len, f) != len
+      || fread(&h->channel, sizeof h->channel, 1, f) != 1
+      || fread(&h->count, sizeof h->count, 1, f) != 1) {
+    return 2;
+  }
+  h->buf[len] = '\0';
+  return 0;
+}
+
+//  runs__sift : rétablit la propriété de tas, selon compar appliquée aux
+//    chaines des têtes heads, du sous-arbre de racine i du tas heap de
+//    longueur n dont seule cette racine est éventuellement mal placée.
+static void runs__sift(size_t *heap, size_t n, size_t i,
+    struct runs__head *heads, int (*compar)(const char *, const char *)) {
+  while (2 * i + 1 < n) {
+    size_t c = 2 * i + 1;
+    if (c + 1 < n && compar(heads[heap[c + 1]].buf, heads[heap[c]].buf) < 0) {
+      ++c;
+    }
+    if (compar(heads[heap[c]].buf, heads[heap[i]].buf) >= 0) {
+      return;
+    }
+    size_t t = heap[i];
+    heap[i] = heap[c];
+    heap[c] = t;
+    i = c;
+  }
+}
+
+//  runs__merge : fusionne les n suites de rs à partir de celle d'indice first
+//    et appelle fun(context, S, C, N) pour chaque mot de chaine S, de canal C
+//    et de compteur N, mots de canal multiple compris, dans l'ordre des
+//    suites. Les appels sont interrompus avant la fin si un appel à fun
+//    renvoie une valeur différente de 0 ; cette valeur est alors renvoyée.
+//    Renvoie sinon 1 en cas de dépassement de capacité, 2 en cas d'erreur,
+//    0 sinon.
+static int runs__merge(runs *rs, size_t first, size_t n, void *context,
+    int (*fun)(void *context, const char *s, int channel,
+    long unsigned int count)) {
+  struct runs__head *heads = calloc(n + 1, sizeof *heads);
+  size_t *heap = malloc((n + 1) * sizeof *heap);
+  int r = 0;
+  if (heads == NULL || heap == NULL) {
+    r = 1;
+    goto dispose;
+  }
+  // La tête supplémentaire heads[n] mémorise le mot en cours de réunion, dont
+  //    la chaine est échangée avec celle de la tête d'où il provient
+  struct runs__head *cur = &heads[n];
+  size_t m = 0;
+  for (size_t k = 0; k < n; ++k) {
+    FILE *f = rs->run[first + k];
+    if (fflush(f) != 0) {
+      r = 2;
+      goto dispose;
+    }
+    rewind(f);
+    bool more;
+    if ((r = runs__next(f, &heads[k], &more)) != 0) {
+      goto dispose;
+    }
+    if (more) {
+      heap[m] = k;
+      ++m;
+    }
+  }
+  for (size_t i = m; i > 0; --i) {
+    runs__sift(heap, m, i - 1, heads, rs->compar);
+  }
+  while (m > 0) {
+    size_t k = heap[0];
+    struct runs__head t = *cur;
+    *cur = heads[k];
+    heads[k] = t;
+    do {
+      bool more;
+      if ((r = runs__next(rs->run[first + k], &heads[k], &more)) != 0) {
+        goto dispose;
+      }
+      if (!more) {
+        --m;
+        heap[0] = heap[m];
+      }
+      runs__sift(heap, m, 0, heads, rs->compar);
+      if (m == 0 || strcmp(heads[heap[0]].buf, cur->buf) != 0) {
+        break;
+      }
+      k = heap[0];
+      if (heads[k].channel != cur->channel) {
+        cur->channel = MULTI_CHANNEL;
+      }
+      cur->count += heads[k].count;
+    } while (true);
+    if ((r = fun(context, cur->buf, cur->channel, cur->count)) != 0) {
+      goto dispose;
+    }
+  }
+dispose:
+  for (size_t k = 0; heads != NULL && k <= n; ++k) {
+    free(heads[k].buf);
+  }
+  free(heads);
+  free(heap);
+  return r;
+}
+
+//  runs__cascade : tant que les RUNS_FANIN dernières suites de rs sont de même
+//    génération, les remplace par leur fusion, de la génération suivante.
+//    Renvoie 1 en cas de dépassement de capacité, 2 en cas d'erreur, sinon 0.
+static int runs__cascade(runs *rs) {
+  while (rs->nrun >= RUNS_FANIN
+      && rs->level[rs->nrun - RUNS_FANIN] == rs->level[rs->nrun - 1]) {
+    size_t first = rs->nrun - RUNS_FANIN;
+    FILE *f = tmpfile();
+    if (f == NULL) {
+      return 2;
+    }
+    int r = runs__merge(rs, first, RUNS_FANIN, f,
+        (int (*)(void *, const char *, int, long unsigned int))runs__put);
+    if (r != 0) {
+      fclose(f);
+      return r;
+    }
+    for (size_t k = first; k < rs->nrun; ++k) {
+      fclose(rs->run[k]);
+    }
+    rs->run[first] = f;
+    ++rs->level[first];
+    rs->nrun = first + 1;
+  }
+  return 0;
+}
+
+int runs_write(runs *rs, wordcounter *w) {
+  if (wc_word_count(w) == 0) {
+    wc_clear(w);
+    return 0;
+  }
+  FILE *f = tmpfile();
+  if (f == NULL) {
+    return 2;
+  }
+  if (wc_apply_context(w, f, (int (*)(void *, word *))runs__put_word) != 0) {
+    fclose(f);
+    return 2;
+  }
+  if (runs__add(rs, f, 0) != 0) {
+    fclose(f);
+    return 1;
+  }
+  wc_clear(w);
+  return runs__cascade(rs);
+}
+
+//  struct runs__exclusive, runs__exclusive_call : sert pour runs_merge, via
+//    runs__merge. Seuls les mots qui ne sont pas de canal multiple sont
+//    transmis à fun.
+struct runs__exclusive {
+  void *context;
+  int (*fun)(void *context, const char *s, int channel,
+      long unsigned int count);
+};
+
+static int runs__exclusive_call(struct runs__exclusive *ex, const char *s,
+    int channel, long unsigned int count) {
+  return channel == MULTI_CHANNEL ? 0 : ex->fun(ex->context, s, channel, count);
+}
+
+int runs_merge(runs *rs, void *context,
+    int (*fun)(void *context, const char *s, int channel,
+    long unsigned int count)) {
+  struct runs__exclusive ex = {
+    .context = context,
+    .fun = fun,
+  };
+  return runs__merge(rs, 0, rs->nrun, &ex,
+      (int (*)(void *, const char *, int, long unsigned int))
+      runs__exclusive_call);
+}
@@ -0,0 +1,76 @@
+//  Partie interface du module runs (suites triées).
+//
+//  Le module runs permet de décider quels mots n'appartiennent qu'à un seul
+//    canal sans que le vocabulaire de tous les canaux ne réside en mémoire.
+//    Le contenu d'un compteur de mots, le plus souvent celui d'un seul
+//    fichier, est trié puis écrit dans un fichier temporaire sous la forme
+//    d'une suite triée d'états de mots, et le compteur est vidé. Une fois
+//    toutes les suites écrites, leur fusion fait se succéder les états d'un
+//    même mot, ce qui suffit à décider s'il est exclusif : seuls les états de
+//    tête de chaque suite résident en mémoire, et les mots exclusifs sont
+//    obtenus dans l'ordre du tri.
+
+#ifndef RUNS__H
+#define RUNS__H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "wordcounter.h"
+
+//  Fonctionnement général :
+//  - une suite est une suite d'enregistrements binaires, chacun étant l'état
+//      (chaine, canal, compteur) d'un mot ;
+//  - les états d'un même mot dans différentes suites sont réunis lors de la
+//      fusion : leurs compteurs sont additionnés et le mot est de canal
+//      multiple si ses canaux diffèrent. Deux chaines distinctes sont
+//      supposées n'être jamais équivalentes pour la collation courante ;
+//  - le nombre de suites ouvertes est borné : lorsque RUNS_FANIN suites de
+//      même génération ont été écrites, elles sont fusionnées en une seule
+//      suite de la génération suivante, qui conserve les mots de canal
+//      multiple ;
+//  - les fichiers temporaires sont supprimés au plus tard à la fin du
+//      programme ;
+//  - les fonctions qui peuvent échouer renvoient 1 en cas de dépassement de
+//      capacité et 2 en cas d'erreur d'entrée-sortie sur les fichiers
+//      temporaires.
+
+//  RUNS_FANIN : nombre de suites de même génération fusionnées en une seule.
+#define RUNS_FANIN 64
+
+//  struct runs, runs : type et nom de type d'un contrôleur regroupant les
+//    informations permettant de gérer des suites triées sur disque.
+typedef struct runs runs;
+
+//  runs_empty : tente d'allouer les ressources nécessaires pour gérer des
+//    suites triées par wc_sort_lexical, ou par wc_sort_lexical_reverse si
+//    reversed vaut true, initialement sans suite. Renvoie NULL en cas de
+//    dépassement de capacité. Renvoie sinon un pointeur vers le contrôleur
+//    associé.
+extern runs *runs_empty(bool reversed);
+
+//  runs_dispose : sans effet si *rs vaut NULL. Libère sinon les ressources
+//    allouées à la gestion des suites associées à *rs, fichiers temporaires
+//    compris, puis affecte NULL à *rs.
+extern void runs_dispose(runs **rs);
+
+//  runs_write : ajoute aux suites associées à rs la suite des états des mots
+//    de w, supposé trié selon l'ordre des suites, puis vide w à l'aide de
+//    wc_clear. Seuls les mots exclusifs de w étant visibles après le tri, ses
+//    mots sont supposés avoir été comptés dans un seul canal. Aucune suite
+//    n'est ajoutée si w est vide. Renvoie 1 en cas de dépassement de
+//    capacité, 2 en cas d'erreur d'entrée-sortie, le contenu de w et des
+//    suites étant alors indéterminé. Renvoie sinon 0.
+extern int runs_write(runs *rs, wordcounter *w);
+
+//  runs_merge : fusionne les suites associées à rs et appelle
+//    fun(context, S, C, N) pour chaque mot exclusif de chaine S, de canal C
+//    et de compteur N dans l'ordre des suites. La chaine S n'est valide que
+//    durant l'appel. Les appels sont interrompus avant la fin si un appel à
+//    fun renvoie une valeur différente de 0 ; cette valeur est alors
+//    renvoyée. Renvoie sinon 1 en cas de dépassement de capacité, 2 en cas
+//    d'erreur d'entrée-sortie, 0 sinon.
+extern int runs_merge(runs *rs, void *context,
+    int (*fun)(void *context, const char *s, int channel,
+    long unsigned int count));
+
+#endif
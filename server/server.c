@@ -0,0 +1,175 @@
+//  Partie implantation du module server.
+
+#define _GNU_SOURCE
+
+#include "server.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//  SERVER__BUF_MIN : capacité initiale en octets du tampon de lecture d'une
+//    connexion.
+#define SERVER__BUF_MIN 4096
+
+//  struct server, server : contexte partagé par les fils des connexions. lock
+//    est le verrou de la structure interrogée par query.
+typedef struct server server;
+
+struct server {
+  pthread_rwlock_t lock;
+  void *context;
+  bool (*exclusive)(void *context, const char *s);
+  int (*query)(void *context, const char *s, outbuf *ob);
+};
+
+//  struct server__session, server__session : connexion de descripteur fd au
+//    serveur sv.
+typedef struct server__session server__session;
+
+struct server__session {
+  server *sv;
+  int fd;
+};
+
+//  server__answer : traite la requête s de la connexion ss et écrit sa réponse
+//    à l'aide du tampon sans descripteur ob. Renvoie une valeur non nulle si
+//    la connexion doit être fermée, 0 sinon.
+static int server__answer(server__session *ss, const char *s, outbuf *ob) {
+  server *sv = ss->sv;
+  if (sv->exclusive(sv->context, s)) {
+    pthread_rwlock_wrlock(&sv->lock);
+  } else {
+    pthread_rwlock_rdlock(&sv->lock);
+  }
+  int r = sv->query(sv->context, s, ob);
+  pthread_rwlock_unlock(&sv->lock);
+  outbuf_write(ob, "\n", 1);
+  if (outbuf_writev(ss->fd, &ob, 1) != 0) {
+    return 1;
+  }
+  return r;
+}
+
+//  server__session_run : fonction exécutée par le fil de la connexion pointée
+//    par arg. Lit les requêtes de la connexion et y répond jusqu'à sa
+//    fermeture, puis libère les ressources associées.
+static void *server__session_run(void *arg) {
+  server__session *ss = arg;
+  outbuf *ob = outbuf_empty(-1);
+  char *buf = malloc(SERVER__BUF_MIN);
+  size_t capacity = SERVER__BUF_MIN;
+  size_t size = 0;
+  bool done = ob == NULL || buf == NULL;
+  while (!done) {
+    if (size == capacity) {
+      char *b = capacity >= SERVER_LINE_MAX
+          ? NULL : realloc(buf, 2 * capacity);
+      if (b == NULL) {
+        break;
+      }
+      buf = b;
+      capacity *= 2;
+    }
+    ssize_t n = read(ss->fd, buf + size, capacity - size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    size += (size_t) n;
+    // Traitement des lignes complètes, la dernière restant en attente
+    size_t first = 0;
+    char *eol;
+    while (!done
+        && (eol = memchr(buf + first, '\n', size - first)) != NULL) {
+      *eol = '\0';
+      if (eol > buf + first && eol[-1] == '\r') {
+        eol[-1] = '\0';
+      }
+      done = server__answer(ss, buf + first, ob) != 0;
+      first = (size_t) (eol - buf) + 1;
+    }
+    memmove(buf, buf + first, size - first);
+    size -= first;
+  }
+  close(ss->fd);
+  free(buf);
+  outbuf_dispose(&ob);
+  free(ss);
+  return NULL;
+}
+
+//  server__listen : crée la socket locale de chemin path, prête à accepter des
+//    connexions. Renvoie son descripteur en cas de succès, une valeur
+//    négative sinon.
+static int server__listen(const char *path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof addr.sun_path) {
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  struct stat st;
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(path);
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (bind(fd, (struct sockaddr *) &addr, sizeof addr) != 0
+      || listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int server_run(const char *path, void *context,
+    bool (*exclusive)(void *context, const char *s),
+    int (*query)(void *context, const char *s, outbuf *ob)) {
+  server sv = {
+    .context = context,
+    .exclusive = exclusive,
+    .query = query,
+  };
+  signal(SIGPIPE, SIG_IGN);
+  int fd = server__listen(path);
+  if (fd < 0) {
+    return 2;
+  }
+  pthread_rwlock_init(&sv.lock, NULL);
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  while (true) {
+    int cfd = accept(fd, NULL, NULL);
+    if (cfd < 0) {
+      // Faute de descripteur disponible, une connexion doit se fermer
+      if (errno != EINTR && errno != ECONNABORTED) {
+        sleep(1);
+      }
+      continue;
+    }
+    server__session *ss = malloc(sizeof *ss);
+    if (ss == NULL) {
+      close(cfd);
+      continue;
+    }
+    ss->sv = &sv;
+    ss->fd = cfd;
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, server__session_run, ss) != 0) {
+      close(cfd);
+      free(ss);
+    }
+  }
+}
@@ -0,0 +1,40 @@
+//  Partie interface du module server (serveur de requêtes).
+//
+//  Le module server permet de répondre, sur une socket locale, à des requêtes
+//    d'une ligne portant sur une structure de données résidente. Chaque
+//    connexion est servie par son propre fil d'exécution ; les requêtes qui
+//    ne font que consulter la structure sont traitées simultanément, celles
+//    qui la modifient le sont seules.
+//
+//  Fonctionnement général :
+//  - une requête est une ligne terminée par le caractère de fin de ligne,
+//      qui ne figure pas dans la chaine transmise, pas plus qu'un éventuel
+//      caractère de retour chariot qui le précède ;
+//  - la réponse à une requête est suivie d'une ligne vide ;
+//  - une connexion dont une requête dépasse SERVER_LINE_MAX octets est
+//      fermée.
+
+#ifndef SERVER__H
+#define SERVER__H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "outbuf.h"
+
+//  SERVER_LINE_MAX : longueur maximale en octets d'une requête.
+#define SERVER_LINE_MAX 65536
+
+//  server_run : crée la socket locale de chemin path, en retirant au préalable
+//    une socket de même chemin laissée par un serveur précédent, puis accepte
+//    indéfiniment des connexions. Pour chaque requête S d'une connexion,
+//    appelle query(context, S, ob), ob étant un tampon sans descripteur dont le
+//    contenu est ensuite écrit sur la connexion ; l'appel a lieu sous un verrou
+//    exclusif si exclusive(context, S) renvoie true, sous un verrou partagé
+//    sinon. La connexion est fermée si query renvoie une valeur non nulle. Le
+//    signal SIGPIPE est ignoré. Ne rend la main qu'en cas d'échec de la
+//    création de la socket, en renvoyant une valeur non nulle.
+extern int server_run(const char *path, void *context,
+    bool (*exclusive)(void *context, const char *s),
+    int (*query)(void *context, const char *s, outbuf *ob));
+
+#endif
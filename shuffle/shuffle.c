@@ -0,0 +1,264 @@
+//  Partie implantation du module shuffle.
+
+#include "shuffle.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+//  SHUFFLE__BATCH_SIZE : capacité en octets d'un lot, sauf pour un mot trop
+//    long pour y tenir seul.
+#define SHUFFLE__BATCH_SIZE 16384
+
+//  SHUFFLE__QUEUE_LEN : nombre maximal de lots en attente dans une file.
+#define SHUFFLE__QUEUE_LEN 8
+
+//  struct shuffle__batch, shuffle__batch : lot de mots. Le tableau data de
+//    longueur capacity contient, sur ses size premiers octets, une suite
+//    d'enregistrements formés d'un canal de type int suivi d'une chaine
+//    terminée par le caractère nul.
+typedef struct shuffle__batch shuffle__batch;
+
+struct shuffle__batch {
+  size_t size;
+  size_t capacity;
+  char data[];
+};
+
+//  struct shuffle__part, shuffle__part : partition et file d'attente de son
+//    fil compteur thread. Les composants mutex, nonempty et nonfull protègent
+//    et signalent toute modification de la file. La file contient count lots
+//    rangés circulairement dans slot à partir de l'indice head. closed indique
+//    qu'aucun lot ne sera plus déposé.
+typedef struct shuffle__part shuffle__part;
+
+struct shuffle__part {
+  shuffle *sh;
+  wordcounter *w;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t nonempty;
+  pthread_cond_t nonfull;
+  shuffle__batch *slot[SHUFFLE__QUEUE_LEN];
+  size_t head;
+  size_t count;
+  bool closed;
+};
+
+//  struct shuffle : le tableau part de longueur npart mémorise les partitions.
+//    failed indique que le comptage d'un mot a échoué.
+struct shuffle {
+  shuffle__part *part;
+  size_t npart;
+  atomic_bool failed;
+};
+
+//  struct shuffle_writer : le tableau batch de longueur sh->npart mémorise le
+//    lot en cours de chaque partition, NULL s'il n'y en a pas.
+struct shuffle_writer {
+  shuffle *sh;
+  shuffle__batch **batch;
+};
+
+//  shuffle__index : renvoie l'indice de la partition, parmi npart, à laquelle
+//    appartient le mot de valeur de hachage h.
+static size_t shuffle__index(uint64_t h, size_t npart) {
+  return (size_t) (((h >> 32) * (uint64_t) npart) >> 32);
+}
+
+//  shuffle__count : compte dans la partition p les mots du lot b. Renvoie une
+//    valeur non nulle en cas de dépassement de capacité, 0 sinon.
+static int shuffle__count(shuffle__part *p, const shuffle__batch *b) {
+  size_t i = 0;
+  while (i < b->size) {
+    int channel;
+    memcpy(&channel, b->data + i, sizeof channel);
+    const char *s = b->data + i + sizeof channel;
+    int r = channel == UNDEFINED_CHANNEL
+        ? wc_add_filtered(p->w, s) : wc_addcount(p->w, s, channel);
+    if (r != 0) {
+      return r;
+    }
+    i += sizeof channel + strlen(s) + 1;
+  }
+  return 0;
+}
+
+//  shuffle__worker : fonction exécutée par le fil compteur de la partition
+//    pointée par arg. Vide la file tant qu'elle n'est pas fermée ; après un
+//    échec, les lots sont abandonnés sans être comptés.
+static void *shuffle__worker(void *arg) {
+  shuffle__part *p = arg;
+  pthread_mutex_lock(&p->mutex);
+  while (true) {
+    while (p->count == 0 && !p->closed) {
+      pthread_cond_wait(&p->nonempty, &p->mutex);
+    }
+    if (p->count == 0) {
+      break;
+    }
+    shuffle__batch *b = p->slot[p->head];
+    p->head = (p->head + 1) % SHUFFLE__QUEUE_LEN;
+    --p->count;
+    pthread_cond_signal(&p->nonfull);
+    pthread_mutex_unlock(&p->mutex);
+    if (!atomic_load(&p->sh->failed) && shuffle__count(p, b) != 0) {
+      atomic_store(&p->sh->failed, true);
+    }
+    free(b);
+    pthread_mutex_lock(&p->mutex);
+  }
+  pthread_mutex_unlock(&p->mutex);
+  return NULL;
+}
+
+//  shuffle__send : dépose le lot b dans la file de la partition p, en
+//    attendant au besoin qu'une place s'y libère.
+static void shuffle__send(shuffle__part *p, shuffle__batch *b) {
+  pthread_mutex_lock(&p->mutex);
+  while (p->count == SHUFFLE__QUEUE_LEN) {
+    pthread_cond_wait(&p->nonfull, &p->mutex);
+  }
+  p->slot[(p->head + p->count) % SHUFFLE__QUEUE_LEN] = b;
+  ++p->count;
+  pthread_cond_signal(&p->nonempty);
+  pthread_mutex_unlock(&p->mutex);
+}
+
+//  shuffle__close : ferme les files des n premières partitions de sh, attend
+//    la fin de leurs fils compteurs et libère les ressources associées.
+static void shuffle__close(shuffle *sh, size_t n) {
+  for (size_t k = 0; k < n; ++k) {
+    shuffle__part *p = &sh->part[k];
+    pthread_mutex_lock(&p->mutex);
+    p->closed = true;
+    pthread_cond_signal(&p->nonempty);
+    pthread_mutex_unlock(&p->mutex);
+  }
+  for (size_t k = 0; k < n; ++k) {
+    shuffle__part *p = &sh->part[k];
+    pthread_join(p->thread, NULL);
+    pthread_cond_destroy(&p->nonfull);
+    pthread_cond_destroy(&p->nonempty);
+    pthread_mutex_destroy(&p->mutex);
+  }
+}
+
+shuffle *shuffle_start(wordcounter **part, size_t npart) {
+  shuffle *sh = malloc(sizeof *sh);
+  if (sh == NULL) {
+    return NULL;
+  }
+  sh->part = malloc(npart * sizeof *sh->part);
+  if (sh->part == NULL) {
+    free(sh);
+    return NULL;
+  }
+  sh->npart = npart;
+  atomic_init(&sh->failed, false);
+  for (size_t k = 0; k < npart; ++k) {
+    shuffle__part *p = &sh->part[k];
+    p->sh = sh;
+    p->w = part[k];
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->nonempty, NULL);
+    pthread_cond_init(&p->nonfull, NULL);
+    p->head = 0;
+    p->count = 0;
+    p->closed = false;
+    if (pthread_create(&p->thread, NULL, shuffle__worker, p) != 0) {
+      pthread_cond_destroy(&p->nonfull);
+      pthread_cond_destroy(&p->nonempty);
+      pthread_mutex_destroy(&p->mutex);
+      shuffle__close(sh, k);
+      free(sh->part);
+      free(sh);
+      return NULL;
+    }
+  }
+  return sh;
+}
+
+int shuffle_finish(shuffle **sh) {
+  shuffle__close(*sh, (*sh)->npart);
+  int r = atomic_load(&(*sh)->failed);
+  free((*sh)->part);
+  free(*sh);
+  *sh = NULL;
+  return r;
+}
+
+shuffle_writer *shuffle_writer_empty(shuffle *sh) {
+  shuffle_writer *sw = malloc(sizeof *sw);
+  if (sw == NULL) {
+    return NULL;
+  }
+  sw->sh = sh;
+  sw->batch = calloc(sh->npart, sizeof *sw->batch);
+  if (sw->batch == NULL) {
+    free(sw);
+    return NULL;
+  }
+  return sw;
+}
+
+void shuffle_writer_dispose(shuffle_writer **sw) {
+  if (*sw == NULL) {
+    return;
+  }
+  for (size_t k = 0; k < (*sw)->sh->npart; ++k) {
+    free((*sw)->batch[k]);
+  }
+  free((*sw)->batch);
+  free(*sw);
+  *sw = NULL;
+}
+
+int shuffle_put(shuffle_writer *sw, const char *s, int channel) {
+  shuffle *sh = sw->sh;
+  size_t k = shuffle__index(wc_str_hash(s), sh->npart);
+  size_t len = strlen(s) + 1;
+  if (len > SIZE_MAX - sizeof channel - sizeof(shuffle__batch)) {
+    return 1;
+  }
+  size_t rec = sizeof channel + len;
+  shuffle__batch *b = sw->batch[k];
+  if (b != NULL && b->capacity - b->size < rec) {
+    shuffle__send(&sh->part[k], b);
+    sw->batch[k] = b = NULL;
+    if (atomic_load(&sh->failed)) {
+      return 1;
+    }
+  }
+  if (b == NULL) {
+    size_t capacity = rec > SHUFFLE__BATCH_SIZE ? rec : SHUFFLE__BATCH_SIZE;
+    b = malloc(sizeof *b + capacity);
+    if (b == NULL) {
+      return 1;
+    }
+    b->size = 0;
+    b->capacity = capacity;
+    sw->batch[k] = b;
+  }
+  memcpy(b->data + b->size, &channel, sizeof channel);
+  memcpy(b->data + b->size + sizeof channel, s, len);
+  b->size += rec;
+  return 0;
+}
+
+int shuffle_flush(shuffle_writer *sw) {
+  shuffle *sh = sw->sh;
+  for (size_t k = 0; k < sh->npart; ++k) {
+    if (sw->batch[k] != NULL) {
+      shuffle__send(&sh->part[k], sw->batch[k]);
+      sw->batch[k] = NULL;
+    }
+  }
+  return atomic_load(&sh->failed);
+}
+
+size_t shuffle_part(uint64_t h, size_t npart) {
+  return shuffle__index(h, npart);
+}
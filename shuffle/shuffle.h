@@ -0,0 +1,84 @@
+//  Partie interface du module shuffle (répartition des mots entre partitions).
+//
+//  Le module shuffle permet de compter des mots sur plusieurs fils d'exécution
+//    sans verrou sur les compteurs ni fusion finale. Le vocabulaire est réparti
+//    entre plusieurs compteurs de mots, ou partitions, selon la valeur de
+//    hachage des mots : toutes les occurrences d'un même mot aboutissent ainsi
+//    dans la même partition. Chaque partition est la propriété exclusive d'un
+//    fil compteur. Des producteurs découpent les entrées en mots et déposent
+//    ceux-ci, par lots, dans la file d'attente de la partition à laquelle ils
+//    appartiennent. Une fois le comptage terminé, chaque mot figure dans une
+//    seule partition ; les partitions peuvent être triées séparément, puis
+//    parcourues ensemble à l'aide de wc_apply_merge.
+
+#ifndef SHUFFLE__H
+#define SHUFFLE__H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "wordcounter.h"
+
+//  Fonctionnement général :
+//  - les files d'attente sont bornées : un producteur qui dépose un lot dans
+//      une file pleine attend que le fil compteur de la partition l'ait
+//      vidée ;
+//  - les lots d'un même producteur sont traités dans l'ordre où ils ont été
+//      déposés ;
+//  - les partitions ne doivent pas être utilisées en dehors du module entre
+//      shuffle_start et shuffle_finish.
+
+//  struct shuffle, shuffle : type et nom de type d'un contrôleur regroupant les
+//    informations permettant de gérer les fils compteurs et leurs files
+//    d'attente.
+typedef struct shuffle shuffle;
+
+//  struct shuffle_writer, shuffle_writer : type et nom de type d'un contrôleur
+//    regroupant les informations permettant à un producteur de constituer ses
+//    lots de mots. Un tel contrôleur ne doit être utilisé que par un fil
+//    d'exécution à la fois.
+typedef struct shuffle_writer shuffle_writer;
+
+//  shuffle_start : tente de démarrer un fil compteur pour chacune des npart
+//    partitions du tableau part, npart étant supposé non nul. Renvoie NULL en
+//    cas de dépassement de capacité ou si l'un des fils n'a pu être démarré.
+//    Renvoie sinon un pointeur vers le contrôleur associé.
+extern shuffle *shuffle_start(wordcounter **part, size_t npart);
+
+//  shuffle_finish : attend que les files d'attente associées à *sh soient
+//    vidées, arrête les fils compteurs, libère les ressources allouées à leur
+//    gestion puis affecte NULL à *sh. Renvoie 1 si le comptage d'un mot a
+//    dépassé la capacité d'une partition, 0 sinon.
+extern int shuffle_finish(shuffle **sh);
+
+//  shuffle_writer_empty : tente d'allouer les ressources nécessaires pour
+//    permettre à un nouveau producteur de déposer des mots dans les files
+//    d'attente associées à sh. Renvoie NULL en cas de dépassement de capacité.
+//    Renvoie sinon un pointeur vers le contrôleur associé.
+extern shuffle_writer *shuffle_writer_empty(shuffle *sh);
+
+//  shuffle_writer_dispose : sans effet si *sw vaut NULL. Libère sinon les
+//    ressources allouées à la gestion du producteur associé à *sw, en
+//    abandonnant les mots qui n'ont pas été déposés, puis affecte NULL à *sw.
+extern void shuffle_writer_dispose(shuffle_writer **sw);
+
+//  shuffle_put : ajoute le mot égal à la chaine pointée par s au lot en cours
+//    de la partition à laquelle il appartient. Le mot y sera compté dans le
+//    canal channel à l'aide de wc_addcount ou, si channel est indéfini, ajouté
+//    au filtre de la partition à l'aide de wc_add_filtered. Un lot plein est
+//    déposé dans la file d'attente de sa partition. Renvoie 1 en cas de
+//    dépassement de capacité ou si le comptage d'un mot a déjà échoué dans
+//    une partition, sinon renvoie 0.
+extern int shuffle_put(shuffle_writer *sw, const char *s, int channel);
+
+//  shuffle_flush : dépose tous les lots en cours du producteur associé à sw.
+//    Renvoie 1 si le comptage d'un mot a déjà échoué dans une partition,
+//    sinon renvoie 0.
+extern int shuffle_flush(shuffle_writer *sw);
+
+//  shuffle_part : renvoie l'indice de la partition, parmi npart, à laquelle
+//    appartient le mot de valeur de hachage h (voir wc_str_hash). Permet
+//    d'ajouter directement à la bonne partition, en dehors de shuffle_start
+//    et shuffle_finish, des mots comptés par ailleurs.
+extern size_t shuffle_part(uint64_t h, size_t npart);
+
+#endif
@@ -0,0 +1,370 @@
+//  Partie implantation du module sketch.
+
+#include "sketch.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "wordcounter.h"
+
+//  SKETCH__HLL_BITS, SKETCH__HLL_LEN : nombre de bits de la valeur de hachage
+//    qui désignent le registre de l'estimateur HyperLogLog, nombre de ces
+//    registres.
+#define SKETCH__HLL_BITS 14
+#define SKETCH__HLL_LEN ((size_t) 1 << SKETCH__HLL_BITS)
+
+//  SKETCH__BLOOM_BITS, SKETCH__BLOOM_HASHES : nombre de bits du filtre de
+//    Bloom, qui doit être une puissance de 2, et nombre de bits positionnés
+//    par mot.
+#define SKETCH__BLOOM_BITS ((size_t) 1 << 23)
+#define SKETCH__BLOOM_HASHES 4
+
+//  SKETCH__MIX : mélange les bits de la variable x de type uint64_t.
+#define SKETCH__MIX(x)                                                         \
+  ((x) ^= (x) >> 33, (x) *= 0xff51afd7ed558ccdULL,                             \
+  (x) ^= (x) >> 33, (x) *= 0xc4ceb9fe1a85ec53ULL,                              \
+  (x) ^= (x) >> 33)
+
+//  struct sketch__entry, sketch__entry : mot du résumé, de chaine str de
+//    longueur len et de valeur de hachage h, dont le nombre d'occurrences est
+//    estimé à count ; pos est sa position dans le tas.
+typedef struct sketch__entry sketch__entry;
+
+struct sketch__entry {
+  char *str;
+  size_t len;
+  uint64_t h;
+  long unsigned int count;
+  size_t pos;
+};
+
+//  struct sketch : les n mots du résumé, au plus capacity, sont rangés dans le
+//    tableau entry ; heap est un tas de leurs indices, le mot dont
+//    l'estimation est la plus faible étant à la racine ; index est une table
+//    de hachage à adressage ouvert de longueur nindex, puissance de 2, dont
+//    les cases valent 0 ou l'indice d'un mot plus 1. hll est le tableau des
+//    registres de l'estimateur HyperLogLog, bloom celui des octets du filtre,
+//    dont nset bits sont positionnés. total est le nombre d'occurrences
+//    ajoutées.
+struct sketch {
+  const allocator *al;
+  size_t capacity;
+  size_t n;
+  sketch__entry *entry;
+  size_t *heap;
+  size_t *index;
+  size_t nindex;
+  unsigned char *hll;
+  unsigned char *bloom;
+  size_t nset;
+  long unsigned int total;
+};
+
+sketch *sketch_empty(size_t capacity, const allocator *al) {
+  if (capacity > SIZE_MAX / 4 / sizeof(sketch__entry)) {
+    return NULL;
+  }
+  sketch *sk = malloc(sizeof *sk);
+  if (sk == NULL) {
+    return NULL;
+  }
+  sk->al = al;
+  sk->capacity = capacity;
+  sk->n = 0;
+  sk->nindex = 1;
+  while (sk->nindex < 2 * capacity) {
+    sk->nindex *= 2;
+  }
+  sk->entry = allocator_alloc(al, capacity * sizeof *sk->entry);
+  sk->heap = allocator_alloc(al, capacity * sizeof *sk->heap);
+  sk->index = allocator_alloc(al, sk->nindex * sizeof *sk->index);
+  sk->hll = allocator_alloc(al, SKETCH__HLL_LEN);
+  sk->bloom = allocator_alloc(al, SKETCH__BLOOM_BITS / CHAR_BIT);
+  sk->nset = 0;
+  sk->total = 0;
+  if (sk->entry == NULL || sk->heap == NULL || sk->index == NULL
+      || sk->hll == NULL || sk->bloom == NULL) {
+    sketch_dispose(&sk);
+    return NULL;
+  }
+  memset(sk->index, 0, sk->nindex * sizeof *sk->index);
+  memset(sk->hll, 0, SKETCH__HLL_LEN);
+  memset(sk->bloom, 0, SKETCH__BLOOM_BITS / CHAR_BIT);
+  return sk;
+}
+
+void sketch_dispose(sketch **sk) {
+  if (*sk == NULL) {
+    return;
+  }
+  const allocator *al = (*sk)->al;
+  for (size_t k = 0; k < (*sk)->n; ++k) {
+    allocator_release(al, (*sk)->entry[k].str, (*sk)->entry[k].len + 1);
+  }
+  allocator_release(al, (*sk)->entry, (*sk)->capacity * sizeof *(*sk)->entry);
+  allocator_release(al, (*sk)->heap, (*sk)->capacity * sizeof *(*sk)->heap);
+  allocator_release(al, (*sk)->index, (*sk)->nindex * sizeof *(*sk)->index);
+  allocator_release(al, (*sk)->hll, SKETCH__HLL_LEN);
+  allocator_release(al, (*sk)->bloom, SKETCH__BLOOM_BITS / CHAR_BIT);
+  free(*sk);
+  *sk = NULL;
+}
+
+//  Résumé Space-Saving --------------------------------------------------------
+
+//  sketch__find : renvoie la case de la table de hachage de sk qui contient le
+//    mot de chaine s et de valeur de hachage h, ou à défaut la case vide où il
+//    peut être inséré. Affecte à *found true dans le premier cas, false sinon.
+static size_t sketch__find(const sketch *sk, uint64_t h, const char *s,
+    bool *found) {
+  size_t mask = sk->nindex - 1;
+  size_t i = (size_t) h & mask;
+  while (sk->index[i] != 0) {
+    const sketch__entry *e = &sk->entry[sk->index[i] - 1];
+    if (e->h == h && strcmp(e->str, s) == 0) {
+      *found = true;
+      return i;
+    }
+    i = (i + 1) & mask;
+  }
+  *found = false;
+  return i;
+}
+
+//  sketch__unlink : vide la case i de la table de hachage de sk en y ramenant
+//    les cases suivantes de la même grappe qui peuvent l'occuper, de sorte que
+//    la recherche de leurs mots aboutisse toujours.
+static void sketch__unlink(sketch *sk, size_t i) {
+  size_t mask = sk->nindex - 1;
+  size_t j = i;
+  while (true) {
+    j = (j + 1) & mask;
+    if (sk->index[j] == 0) {
+      break;
+    }
+    size_t home = (size_t) sk->entry[sk->index[j] - 1].h & mask;
+    // La case j peut être ramenée en i si sa case d'origine n'est pas
+    //    strictement entre i et j dans l'ordre circulaire
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      sk->index[i] = sk->index[j];
+      i = j;
+    }
+  }
+  sk->index[i] = 0;
+}
+
+//  sketch__swap : échange les positions i et j du tas de sk.
+static void sketch__swap(sketch *sk, size_t i, size_t j) {
+  size_t t = sk->heap[i];
+  sk->heap[i] = sk->heap[j];
+  sk->heap[j] = t;
+  sk->entry[sk->heap[i]].pos = i;
+  sk->entry[sk->heap[j]].pos = j;
+}
+
+//  sketch__count : renvoie l'estimation du mot à la position i du tas de sk.
+static long unsigned int sketch__count(const sketch *sk, size_t i) {
+  return sk->entry[sk->heap[i]].count;
+}
+
+//  sketch__sift_up, sketch__sift_down : rétablit la propriété de tas de sk,
+//    éventuellement violée par le seul mot à la position i, en le faisant
+//    remonter, descendre.
+static void sketch__sift_up(sketch *sk, size_t i) {
+  while (i > 0 && sketch__count(sk, (i - 1) / 2) > sketch__count(sk, i)) {
+    sketch__swap(sk, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void sketch__sift_down(sketch *sk, size_t i) {
+  while (2 * i + 1 < sk->n) {
+    size_t c = 2 * i + 1;
+    if (c + 1 < sk->n && sketch__count(sk, c + 1) < sketch__count(sk, c)) {
+      ++c;
+    }
+    if (sketch__count(sk, c) >= sketch__count(sk, i)) {
+      return;
+    }
+    sketch__swap(sk, i, c);
+    i = c;
+  }
+}
+
+//  sketch__summary_add : ajoute au résumé de sk une occurrence du mot de
+//    chaine s et de valeur de hachage h. S'il n'y figure pas et que le résumé
+//    est plein, il remplace le mot dont l'estimation est la plus faible et en
+//    hérite, augmentée de 1. Renvoie 1 en cas de dépassement de capacité, 0
+//    sinon.
+static int sketch__summary_add(sketch *sk, uint64_t h, const char *s) {
+  bool found;
+  size_t i = sketch__find(sk, h, s, &found);
+  if (found) {
+    sketch__entry *e = &sk->entry[sk->index[i] - 1];
+    ++e->count;
+    sketch__sift_down(sk, e->pos);
+    return 0;
+  }
+  size_t len = strlen(s);
+  if (sk->n < sk->capacity) {
+    char *str = allocator_alloc(sk->al, len + 1);
+    if (str == NULL) {
+      return 1;
+    }
+    sketch__entry *e = &sk->entry[sk->n];
+    *e = (sketch__entry) {
+      .str = str,
+      .len = len,
+      .h = h,
+      .count = 1,
+      .pos = sk->n,
+    };
+    memcpy(str, s, len + 1);
+    sk->index[i] = sk->n + 1;
+    sk->heap[sk->n] = sk->n;
+    ++sk->n;
+    sketch__sift_up(sk, e->pos);
+    return 0;
+  }
+  size_t m = sk->heap[0];
+  sketch__entry *e = &sk->entry[m];
+  size_t old = sketch__find(sk, e->h, e->str, &found);
+  if (len != e->len) {
+    char *str = allocator_resize(sk->al, e->str, e->len + 1, len + 1);
+    if (str == NULL) {
+      return 1;
+    }
+    e->str = str;
+  }
+  sketch__unlink(sk, old);
+  memcpy(e->str, s, len + 1);
+  e->len = len;
+  e->h = h;
+  ++e->count;
+  sk->index[sketch__find(sk, h, s, &found)] = m + 1;
+  sketch__sift_down(sk, 0);
+  return 0;
+}
+
+//  Estimateur HyperLogLog et filtre de Bloom ----------------------------------
+
+//  sketch__hll_add : ajoute à l'estimateur de sk le mot de valeur de hachage h.
+//    Les SKETCH__HLL_BITS bits de poids fort de h désignent un registre, qui
+//    retient le plus grand rang du premier bit à 1 des bits restants.
+static void sketch__hll_add(sketch *sk, uint64_t h) {
+  size_t j = (size_t) (h >> (64 - SKETCH__HLL_BITS));
+  uint64_t w = (h << SKETCH__HLL_BITS)
+      | ((uint64_t) 1 << (SKETCH__HLL_BITS - 1));
+  unsigned char rank = 1;
+  while ((w & ((uint64_t) 1 << 63)) == 0) {
+    w <<= 1;
+    ++rank;
+  }
+  if (rank > sk->hll[j]) {
+    sk->hll[j] = rank;
+  }
+}
+
+//  sketch__bloom_bit : renvoie le numéro du bit de rang i, compris entre 0 et
+//    SKETCH__BLOOM_HASHES - 1, du filtre associé à la valeur de hachage h, par
+//    double hachage.
+static size_t sketch__bloom_bit(uint64_t h, size_t i) {
+  uint64_t h2 = h ^ 0x9e3779b97f4a7c15ULL;
+  SKETCH__MIX(h2);
+  return (size_t) (h + i * (h2 | 1)) & (SKETCH__BLOOM_BITS - 1);
+}
+
+int sketch_add(sketch *sk, const char *s) {
+  uint64_t h = wc_str_hash(s);
+  ++sk->total;
+  sketch__hll_add(sk, h);
+  for (size_t i = 0; i < SKETCH__BLOOM_HASHES; ++i) {
+    size_t b = sketch__bloom_bit(h, i);
+    unsigned char bit = (unsigned char) (1u << (b % CHAR_BIT));
+    if ((sk->bloom[b / CHAR_BIT] & bit) == 0) {
+      sk->bloom[b / CHAR_BIT] |= bit;
+      ++sk->nset;
+    }
+  }
+  return sketch__summary_add(sk, h, s);
+}
+
+bool sketch_contains(const sketch *sk, const char *s) {
+  uint64_t h = wc_str_hash(s);
+  for (size_t i = 0; i < SKETCH__BLOOM_HASHES; ++i) {
+    size_t b = sketch__bloom_bit(h, i);
+    if ((sk->bloom[b / CHAR_BIT] & (1u << (b % CHAR_BIT))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//  Estimations ----------------------------------------------------------------
+
+long unsigned int sketch_total(const sketch *sk) {
+  return sk->total;
+}
+
+double sketch_distinct(const sketch *sk) {
+  double m = (double) SKETCH__HLL_LEN;
+  double sum = 0.0;
+  size_t zeros = 0;
+  for (size_t j = 0; j < SKETCH__HLL_LEN; ++j) {
+    sum += 1.0 / (double) ((uint64_t) 1 << sk->hll[j]);
+    zeros += sk->hll[j] == 0;
+  }
+  double e = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+  // Correction des petites valeurs par comptage linéaire des registres nuls
+  if (e <= 2.5 * m && zeros != 0) {
+    e = m * log(m / (double) zeros);
+  }
+  return e;
+}
+
+long unsigned int sketch_count_error(const sketch *sk) {
+  return sk->n < sk->capacity ? 0 : sketch__count(sk, 0);
+}
+
+double sketch_false_positive(const sketch *sk) {
+  double fill = (double) sk->nset / (double) SKETCH__BLOOM_BITS;
+  double p = 1.0;
+  for (size_t i = 0; i < SKETCH__BLOOM_HASHES; ++i) {
+    p *= fill;
+  }
+  return p;
+}
+
+//  sketch__compare : sert pour sketch_apply, via qsort. Compare les mots
+//    **e1ptr et **e2ptr selon l'ordre décroissant de leurs estimations, puis
+//    selon strcmp.
+static int sketch__compare(const sketch__entry **e1ptr,
+    const sketch__entry **e2ptr) {
+  long unsigned int c1 = (*e1ptr)->count;
+  long unsigned int c2 = (*e2ptr)->count;
+  int r = (c1 < c2) - (c1 > c2);
+  return r != 0 ? r : strcmp((*e1ptr)->str, (*e2ptr)->str);
+}
+
+int sketch_apply(const sketch *sk, void *context,
+    int (*fun)(void *context, const char *s, long unsigned int count)) {
+  if (sk->n == 0) {
+    return 0;
+  }
+  const sketch__entry **ref = malloc(sk->n * sizeof *ref);
+  if (ref == NULL) {
+    return 1;
+  }
+  for (size_t k = 0; k < sk->n; ++k) {
+    ref[k] = &sk->entry[k];
+  }
+  qsort(ref, sk->n, sizeof *ref,
+      (int (*)(const void *, const void *))sketch__compare);
+  int r = 0;
+  for (size_t k = 0; r == 0 && k < sk->n; ++k) {
+    r = fun(context, ref[k]->str, ref[k]->count);
+  }
+  free(ref);
+  return r;
+}
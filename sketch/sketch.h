@@ -0,0 +1,85 @@
+//  Partie interface du module sketch (croquis de comptage).
+//
+//  Le module sketch permet de résumer, dans un espace fixé à l'avance et quel
+//    que soit le nombre de mots lus, les mots d'un canal. Un croquis réunit :
+//  - un résumé Space-Saving de capacité k, qui mémorise au plus k mots avec
+//      une estimation par excès de leur nombre d'occurrences : tout mot dont
+//      le nombre d'occurrences dépasse N / k, N étant le nombre total de mots
+//      lus, y figure ;
+//  - un estimateur HyperLogLog du nombre de mots distincts lus ;
+//  - un filtre de Bloom des mots lus, qui permet de décider, avec une faible
+//      probabilité de faux positif mais sans faux négatif, si un mot a été
+//      lu.
+
+#ifndef SKETCH__H
+#define SKETCH__H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "allocator.h"
+
+//  Fonctionnement général :
+//  - les mots sont identifiés par leur valeur de hachage wc_str_hash, dont
+//      les estimations héritent des rares collisions ;
+//  - SKETCH_DISTINCT_ERROR est l'erreur relative type de l'estimation du
+//      nombre de mots distincts ;
+//  - les fonctions qui peuvent échouer renvoient 1 en cas de dépassement de
+//      capacité.
+
+//  SKETCH_DISTINCT_ERROR : erreur relative type de l'estimateur HyperLogLog,
+//    1.04 / sqrt(m) pour ses m = 2^14 registres.
+#define SKETCH_DISTINCT_ERROR 0.008125
+
+//  struct sketch, sketch : type et nom de type d'un contrôleur regroupant les
+//    informations permettant de gérer un croquis.
+typedef struct sketch sketch;
+
+//  sketch_empty : tente d'allouer à l'aide de l'allocateur al les ressources
+//    nécessaires pour gérer un croquis initialement vide dont le résumé est de
+//    capacité capacity, supposée non nulle. Renvoie NULL en cas de
+//    dépassement de capacité. Renvoie sinon un pointeur vers le contrôleur
+//    associé.
+extern sketch *sketch_empty(size_t capacity, const allocator *al);
+
+//  sketch_dispose : sans effet si *sk vaut NULL. Libère sinon les ressources
+//    allouées à la gestion du croquis associé à *sk puis affecte NULL à *sk.
+extern void sketch_dispose(sketch **sk);
+
+//  sketch_add : ajoute au croquis associé à sk une occurrence du mot de chaine
+//    s. Renvoie 1 en cas de dépassement de capacité, le croquis restant
+//    cohérent, 0 sinon.
+extern int sketch_add(sketch *sk, const char *s);
+
+//  sketch_contains : renvoie false si le mot de chaine s n'a pas été ajouté au
+//    croquis associé à sk, true s'il l'a probablement été.
+extern bool sketch_contains(const sketch *sk, const char *s);
+
+//  sketch_total : renvoie le nombre d'occurrences de mots ajoutées au croquis
+//    associé à sk.
+extern long unsigned int sketch_total(const sketch *sk);
+
+//  sketch_distinct : renvoie l'estimation du nombre de mots distincts ajoutés
+//    au croquis associé à sk.
+extern double sketch_distinct(const sketch *sk);
+
+//  sketch_count_error : renvoie un majorant de l'excès de l'estimation du
+//    nombre d'occurrences de tout mot du résumé du croquis associé à sk. Il
+//    vaut 0 tant que le résumé n'est pas plein, les estimations étant alors
+//    exactes, et ne dépasse jamais sketch_total(sk) / k.
+extern long unsigned int sketch_count_error(const sketch *sk);
+
+//  sketch_false_positive : renvoie l'estimation de la probabilité qu'un mot
+//    qui n'a pas été ajouté au croquis associé à sk soit pourtant signalé par
+//    sketch_contains.
+extern double sketch_false_positive(const sketch *sk);
+
+//  sketch_apply : appelle fun(context, S, N) pour chaque mot de chaine S du
+//    résumé du croquis associé à sk, N étant l'estimation de son nombre
+//    d'occurrences, dans l'ordre décroissant de ces estimations. Les appels
+//    sont interrompus avant la fin si un appel à fun renvoie une valeur
+//    différente de 0 ; cette valeur est alors renvoyée. Renvoie sinon 1 en
+//    cas de dépassement de capacité, 0 sinon.
+extern int sketch_apply(const sketch *sk, void *context,
+    int (*fun)(void *context, const char *s, long unsigned int count));
+
+#endif
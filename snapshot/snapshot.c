@@ -0,0 +1,454 @@
+//  Partie implantation du module snapshot.
+
+#define _GNU_SOURCE
+
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "atomicfile.h"
+
+//  SNAPSHOT__MAGIC : premiers octets d'un instantané.
+#define SNAPSHOT__MAGIC "XWCSNAP"
+
+//  SNAPSHOT__BYTE_ORDER : valeur écrite dans l'en-tête, qui permet de
+//    reconnaitre un instantané écrit avec un autre boutisme.
+#define SNAPSHOT__BYTE_ORDER 0x01020304
+
+//  SNAPSHOT__VERSION : version du format.
+#define SNAPSHOT__VERSION 2
+
+//  SNAPSHOT__FLAG_ONLY_ALPHA_NUM : drapeau de l'en-tête indiquant que les
+//    fichiers ont été comptés avec only_alpha_num.
+#define SNAPSHOT__FLAG_ONLY_ALPHA_NUM 1
+
+//  SNAPSHOT__FP_MIN : capacité initiale du tableau des empreintes recueillies
+//    par snapshot_write.
+#define SNAPSHOT__FP_MIN 64
+
+//  struct snapshot__header, snapshot__header : en-tête d'un instantané. Il est
+//    suivi de nwords enregistrements, de nfps empreintes, des noms des nfiles
+//    fichiers, terminés par le caractère nul, sur names_size octets, puis de
+//    la réserve des chaines sur pool_size octets. max_len est la longueur de
+//    la plus longue chaine.
+typedef struct snapshot__header snapshot__header;
+
+struct snapshot__header {
+  char magic[8];
+  uint32_t byte_order;
+  uint32_t version;
+  uint64_t flags;
+  uint64_t max_w_len;
+  uint64_t ngram;
+  uint64_t nfiles;
+  uint64_t nwords;
+  uint64_t nfps;
+  uint64_t names_size;
+  uint64_t pool_size;
+  uint64_t max_len;
+};
+
+//  struct snapshot__record, snapshot__record : enregistrement d'un mot, de
+//    compteur count, rencontré dans le fichier de rang file. Sa chaine est
+//    formée des prefix premiers caractères de la chaine du mot précédent,
+//    suivis de la chaine qui figure à la position suffix de la réserve.
+typedef struct snapshot__record snapshot__record;
+
+struct snapshot__record {
+  uint64_t count;
+  uint64_t suffix;
+  uint32_t file;
+  uint32_t prefix;
+};
+
+//  struct snapshot : la projection de l'instantané commence à l'adresse map et
+//    s'étend sur size octets. hdr, rec, fps et pool en repèrent l'en-tête, les
+//    enregistrements, les empreintes et la réserve ; le tableau name repère
+//    les noms des fichiers.
+struct snapshot {
+  void *map;
+  size_t size;
+  const snapshot__header *hdr;
+  const snapshot__record *rec;
+  const uint64_t *fps;
+  const char **name;
+  const char *pool;
+};
+
+//  Lecture --------------------------------------------------------------------
+
+//  snapshot__check : vérifie la cohérence de l'en-tête de l'instantané projeté
+//    associé à sn avec sa taille, puis repère ses différentes parties. Renvoie
+//    1 en cas de dépassement de capacité, 3 si l'instantané est invalide, 0
+//    sinon.
+static int snapshot__check(snapshot *sn) {
+  const snapshot__header *h = sn->map;
+  if (sn->size < sizeof *h
+      || memcmp(h->magic, SNAPSHOT__MAGIC, sizeof SNAPSHOT__MAGIC) != 0
+      || h->byte_order != SNAPSHOT__BYTE_ORDER
+      || h->version != SNAPSHOT__VERSION
+      || h->ngram == 0
+      || h->max_len >= SIZE_MAX
+      || h->nfiles > (uint64_t) (INT_MAX - START_CHANNEL)) {
+    return 3;
+  }
+  uint64_t left = sn->size - sizeof *h;
+  if (h->nwords > left / sizeof *sn->rec) {
+    return 3;
+  }
+  left -= h->nwords * sizeof *sn->rec;
+  if (h->nfps > left / sizeof *sn->fps) {
+    return 3;
+  }
+  left -= h->nfps * sizeof *sn->fps;
+  if (h->names_size > left || h->pool_size != left - h->names_size
+      || h->nfiles > h->names_size) {
+    return 3;
+  }
+  sn->hdr = h;
+  sn->rec = (const snapshot__record *) (h + 1);
+  sn->fps = (const uint64_t *) (sn->rec + h->nwords);
+  const char *names = (const char *) (sn->fps + h->nfps);
+  sn->pool = names + h->names_size;
+  sn->name = malloc((size_t) h->nfiles * sizeof *sn->name);
+  if (sn->name == NULL && h->nfiles != 0) {
+    return 1;
+  }
+  const char *s = names;
+  for (size_t k = 0; k < h->nfiles; ++k) {
+    const char *e = memchr(s, '\0', (size_t) (sn->pool - s));
+    if (e == NULL) {
+      return 3;
+    }
+    sn->name[k] = s;
+    s = e + 1;
+  }
+  return s == sn->pool ? 0 : 3;
+}
+
+snapshot *snapshot_open(const char *path, int *error) {
+  snapshot *sn = malloc(sizeof *sn);
+  if (sn == NULL) {
+    *error = 1;
+    return NULL;
+  }
+  sn->map = MAP_FAILED;
+  sn->name = NULL;
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    *error = 2;
+    goto error;
+  }
+  sn->size = (size_t) st.st_size;
+  if (sn->size < sizeof(snapshot__header)) {
+    *error = 3;
+    goto error;
+  }
+  sn->map = mmap(NULL, sn->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (sn->map == MAP_FAILED) {
+    *error = 2;
+    goto error;
+  }
+  close(fd);
+  fd = -1;
+  madvise(sn->map, sn->size, MADV_SEQUENTIAL);
+  *error = snapshot__check(sn);
+  if (*error != 0) {
+    goto error;
+  }
+  return sn;
+error:
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (sn->map != MAP_FAILED) {
+    munmap(sn->map, sn->size);
+  }
+  free(sn->name);
+  free(sn);
+  return NULL;
+}
+
+void snapshot_dispose(snapshot **sn) {
+  if (*sn == NULL) {
+    return;
+  }
+  munmap((*sn)->map, (*sn)->size);
+  free((*sn)->name);
+  free(*sn);
+  *sn = NULL;
+}
+
+size_t snapshot_file_count(const snapshot *sn) {
+  return (size_t) sn->hdr->nfiles;
+}
+
+const char *snapshot_file_name(const snapshot *sn, size_t k) {
+  return sn->name[k];
+}
+
+size_t snapshot_word_count(const snapshot *sn) {
+  return (size_t) sn->hdr->nwords;
+}
+
+size_t snapshot_max_w_len(const snapshot *sn) {
+  return (size_t) sn->hdr->max_w_len;
+}
+
+bool snapshot_only_alpha_num(const snapshot *sn) {
+  return (sn->hdr->flags & SNAPSHOT__FLAG_ONLY_ALPHA_NUM) != 0;
+}
+
+size_t snapshot_ngram(const snapshot *sn) {
+  return (size_t) sn->hdr->ngram;
+}
+
+int snapshot_apply(snapshot *sn, void *context,
+    int (*fun)(void *context, const char *s, int channel,
+    long unsigned int count)) {
+  const snapshot__header *h = sn->hdr;
+  char *buf = malloc((size_t) h->max_len + 1);
+  if (buf == NULL) {
+    return 1;
+  }
+  // La chaine du mot courant occupe les len premiers octets de buf
+  size_t len = 0;
+  int r = 0;
+  for (size_t i = 0; r == 0 && i < h->nwords; ++i) {
+    const snapshot__record *p = &sn->rec[i];
+    if (p->file >= h->nfiles || p->prefix > len
+        || (i % SNAPSHOT_BUCKET == 0 && p->prefix != 0)
+        || p->suffix >= h->pool_size) {
+      r = 3;
+      break;
+    }
+    const char *s = sn->pool + p->suffix;
+    const char *e = memchr(s, '\0', (size_t) (h->pool_size - p->suffix));
+    if (e == NULL || (size_t) (e - s) > h->max_len - p->prefix) {
+      r = 3;
+      break;
+    }
+    len = p->prefix + (size_t) (e - s);
+    memcpy(buf + p->prefix, s, (size_t) (e - s) + 1);
+    r = fun(context, buf, START_CHANNEL + (int) p->file,
+        (long unsigned int) p->count);
+  }
+  free(buf);
+  return r;
+}
+
+int snapshot_apply_fingerprints(snapshot *sn, void *context,
+    int (*fun)(void *context, uint64_t fp)) {
+  for (size_t i = 0; i < sn->hdr->nfps; ++i) {
+    int r = fun(context, sn->fps[i]);
+    if (r != 0) {
+      return r;
+    }
+  }
+  return 0;
+}
+
+//  Écriture -------------------------------------------------------------------
+
+//  struct snapshot__gather, snapshot__gather : mots et empreintes recueillis
+//    par snapshot_write. Le tableau words, de capacité suffisante, reçoit les
+//    nwords mots exclusifs ; le tableau fps, de capacité fcap, reçoit les nfps
+//    empreintes.
+typedef struct snapshot__gather snapshot__gather;
+
+struct snapshot__gather {
+  const word **words;
+  size_t nwords;
+  uint64_t *fps;
+  size_t nfps;
+  size_t fcap;
+};
+
+//  snapshot__gather_fp : sert pour snapshot_write. Ajoute fp aux empreintes
+//    de g. Renvoie 1 en cas de dépassement de capacité, 0 sinon.
+static int snapshot__gather_fp(snapshot__gather *g, uint64_t fp) {
+  if (g->nfps == g->fcap) {
+    size_t c = g->fcap == 0 ? SNAPSHOT__FP_MIN : g->fcap * 2;
+    if (c > SIZE_MAX / sizeof *g->fps) {
+      return 1;
+    }
+    uint64_t *t = realloc(g->fps, c * sizeof *t);
+    if (t == NULL) {
+      return 1;
+    }
+    g->fps = t;
+    g->fcap = c;
+  }
+  g->fps[g->nfps] = fp;
+  ++g->nfps;
+  return 0;
+}
+
+//  snapshot__gather_word : sert pour snapshot_write, via wc_apply_context.
+//    Range p parmi les mots de g s'il est exclusif, son empreinte parmi les
+//    empreintes de g s'il est de canal multiple. Renvoie 1 en cas de
+//    dépassement de capacité, 0 sinon.
+static int snapshot__gather_word(snapshot__gather *g, const word *p) {
+  int channel = word_channel(p);
+  if (channel >= START_CHANNEL) {
+    g->words[g->nwords] = p;
+    ++g->nwords;
+    return 0;
+  }
+  if (channel == MULTI_CHANNEL) {
+    return snapshot__gather_fp(g, wc_str_hash(word_str(p)));
+  }
+  return 0;
+}
+
+//  snapshot__compare_word : sert pour snapshot_write, via qsort. Compare octet
+//    par octet les chaines des mots pointés par *w1ptr et *w2ptr.
+static int snapshot__compare_word(const word **w1ptr, const word **w2ptr) {
+  return strcmp(word_str(*w1ptr), word_str(*w2ptr));
+}
+
+//  snapshot__compare_fp : sert pour snapshot_write, via qsort. Compare les
+//    empreintes pointées par fp1 et fp2.
+static int snapshot__compare_fp(const uint64_t *fp1, const uint64_t *fp2) {
+  return (*fp1 > *fp2) - (*fp1 < *fp2);
+}
+
+//  snapshot__prefix : renvoie la longueur, bornée par UINT32_MAX, du plus long
+//    préfixe commun aux chaines pointées par s1 et s2.
+static size_t snapshot__prefix(const char *s1, const char *s2) {
+  size_t n = 0;
+  while (n < UINT32_MAX && s1[n] != '\0' && s1[n] == s2[n]) {
+    ++n;
+  }
+  return n;
+}
+
+//  snapshot__put : écrit dans le flot f l'instantané des mots et des
+//    empreintes de g, la position de chaque mot dans words étant celle de son
+//    enregistrement, à partir de l'en-tête pointé par h, complété au passage.
+//    Renvoie 2 en cas d'erreur d'écriture, 0 sinon.
+static int snapshot__put(FILE *f, snapshot__header *h,
+    const snapshot__gather *g, const char * const *name, size_t nfiles) {
+  if (fwrite(h, sizeof *h, 1, f) != 1) {
+    return 2;
+  }
+  uint64_t pool_size = 0;
+  uint64_t max_len = 0;
+  for (size_t i = 0; i < g->nwords; ++i) {
+    const char *s = word_str(g->words[i]);
+    size_t prefix = i % SNAPSHOT_BUCKET == 0
+        ? 0 : snapshot__prefix(word_str(g->words[i - 1]), s);
+    size_t len = prefix + strlen(s + prefix);
+    snapshot__record rec = {
+      .count = word_count(g->words[i]),
+      .suffix = pool_size,
+      .file = (uint32_t) (word_channel(g->words[i]) - START_CHANNEL),
+      .prefix = (uint32_t) prefix,
+    };
+    if (fwrite(&rec, sizeof rec, 1, f) != 1) {
+      return 2;
+    }
+    pool_size += len - prefix + 1;
+    max_len = len > max_len ? len : max_len;
+  }
+  if (g->nfps != 0
+      && fwrite(g->fps, sizeof *g->fps, g->nfps, f) != g->nfps) {
+    return 2;
+  }
+  uint64_t names_size = 0;
+  for (size_t k = 0; k < nfiles; ++k) {
+    size_t n = strlen(name[k]) + 1;
+    if (fwrite(name[k], 1, n, f) != n) {
+      return 2;
+    }
+    names_size += n;
+  }
+  for (size_t i = 0; i < g->nwords; ++i) {
+    const char *s = word_str(g->words[i]);
+    size_t prefix = i % SNAPSHOT_BUCKET == 0
+        ? 0 : snapshot__prefix(word_str(g->words[i - 1]), s);
+    if (fputs(s + prefix, f) == EOF || fputc('\0', f) == EOF) {
+      return 2;
+    }
+  }
+  h->names_size = names_size;
+  h->pool_size = pool_size;
+  h->max_len = max_len;
+  if (fseek(f, 0, SEEK_SET) != 0 || fwrite(h, sizeof *h, 1, f) != 1) {
+    return 2;
+  }
+  return 0;
+}
+
+int snapshot_write(const char *path, wordcounter **w, size_t n,
+    const char * const *name, size_t nfiles, size_t max_w_len,
+    bool only_alpha_num, size_t ngram) {
+  size_t total = 0;
+  for (size_t k = 0; k < n; ++k) {
+    total += wc_word_count(w[k]);
+  }
+  snapshot__gather g = {
+    .words = malloc(total * sizeof *g.words),
+    .nwords = 0,
+    .fps = NULL,
+    .nfps = 0,
+    .fcap = 0,
+  };
+  int r = 1;
+  if (g.words == NULL && total != 0) {
+    goto dispose;
+  }
+  for (size_t k = 0; k < n; ++k) {
+    if (wc_apply_context(w[k], &g,
+        (int (*)(void *, word *))snapshot__gather_word) != 0
+        || wc_apply_multi_fingerprints(w[k], &g,
+        (int (*)(void *, uint64_t))snapshot__gather_fp) != 0) {
+      goto dispose;
+    }
+  }
+  if (g.nwords != 0) {
+    qsort(g.words, g.nwords, sizeof *g.words,
+        (int (*)(const void *, const void *))snapshot__compare_word);
+  }
+  if (g.nfps != 0) {
+    qsort(g.fps, g.nfps, sizeof *g.fps,
+        (int (*)(const void *, const void *))snapshot__compare_fp);
+  }
+  size_t m = 0;
+  for (size_t i = 0; i < g.nfps; ++i) {
+    if (m == 0 || g.fps[i] != g.fps[m - 1]) {
+      g.fps[m] = g.fps[i];
+      ++m;
+    }
+  }
+  g.nfps = m;
+  snapshot__header h = {
+    .magic = SNAPSHOT__MAGIC,
+    .byte_order = SNAPSHOT__BYTE_ORDER,
+    .version = SNAPSHOT__VERSION,
+    .flags = only_alpha_num ? SNAPSHOT__FLAG_ONLY_ALPHA_NUM : 0,
+    .max_w_len = max_w_len,
+    .ngram = ngram,
+    .nfiles = nfiles,
+    .nwords = g.nwords,
+    .nfps = g.nfps,
+  };
+  atomicfile *af = atomicfile_open(path, &r);
+  if (af == NULL) {
+    goto dispose;
+  }
+  r = snapshot__put(atomicfile_stream(af), &h, &g, name, nfiles);
+  if (atomicfile_close(&af, r == 0) != 0) {
+    r = 2;
+  }
+dispose:
+  free(g.words);
+  free(g.fps);
+  return r;
+}
@@ -0,0 +1,106 @@
+//  Partie interface du module snapshot (instantané).
+//
+//  Le module snapshot permet d'enregistrer dans un fichier binaire l'état
+//    d'un comptage : la liste des fichiers lus, puis pour chaque mot exclusif,
+//    c'est-à-dire de canal supérieur ou égal à START_CHANNEL, sa chaine, son
+//    canal et son compteur, et enfin l'empreinte (voir wc_str_hash) de chaque
+//    mot de canal multiple. Un instantané est ensuite projeté en mémoire et
+//    parcouru sans analyse : il peut être fusionné avec d'autres instantanés
+//    et avec de nouveaux fichiers bien plus vite que ne le serait un nouveau
+//    comptage de tous les fichiers.
+
+#ifndef SNAPSHOT__H
+#define SNAPSHOT__H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "wordcounter.h"
+
+//  Fonctionnement général :
+//  - un instantané commence par un en-tête de taille fixe, suivi d'un tableau
+//      d'enregistrements de taille fixe, un par mot, des empreintes, triées,
+//      des noms des fichiers et de la réserve des chaines. Les mots sont
+//      rangés dans l'ordre croissant de leurs chaines comparées octet par
+//      octet ; chaque chaine n'est stockée dans la réserve que privée de son
+//      plus long préfixe commun avec la précédente, sauf une sur
+//      SNAPSHOT_BUCKET qui l'est en entier ;
+//  - les entiers sont écrits dans la représentation de la machine : un
+//      instantané écrit sur une machine dont les entiers ont un autre boutisme
+//      est refusé ;
+//  - le canal d'un mot est repéré dans l'instantané par le rang, compté à
+//      partir de 0, du fichier dans lequel il a été rencontré ;
+//  - les fonctions qui peuvent échouer renvoient 1 en cas de dépassement de
+//      capacité, 2 en cas d'erreur d'entrée-sortie et 3 si le fichier n'est pas
+//      un instantané valide.
+
+//  SNAPSHOT_BUCKET : nombre de mots consécutifs dont les chaines partagent un
+//    préfixe avec la chaine précédente, la première exceptée.
+#define SNAPSHOT_BUCKET 16
+
+//  struct snapshot, snapshot : type et nom de type d'un contrôleur regroupant
+//    les informations permettant d'accéder à un instantané projeté en mémoire.
+typedef struct snapshot snapshot;
+
+//  snapshot_open : tente d'ouvrir et de projeter en mémoire l'instantané de
+//    chemin path, puis d'en vérifier l'en-tête. Renvoie NULL en cas d'échec, le
+//    code d'erreur étant affecté à *error. Renvoie sinon un pointeur vers le
+//    contrôleur associé.
+extern snapshot *snapshot_open(const char *path, int *error);
+
+//  snapshot_dispose : sans effet si *sn vaut NULL. Libère sinon les
+//    ressources allouées à la gestion de l'instantané associé à *sn, dont sa
+//    projection, puis affecte NULL à *sn.
+extern void snapshot_dispose(snapshot **sn);
+
+//  snapshot_file_count, snapshot_file_name : renvoie respectivement le nombre
+//    de fichiers de l'instantané associé à sn et le nom du fichier de rang k,
+//    k étant supposé strictement inférieur à ce nombre.
+extern size_t snapshot_file_count(const snapshot *sn);
+extern const char *snapshot_file_name(const snapshot *sn, size_t k);
+
+//  snapshot_word_count : renvoie le nombre de mots de l'instantané associé à
+//    sn.
+extern size_t snapshot_word_count(const snapshot *sn);
+
+//  snapshot_max_w_len, snapshot_only_alpha_num, snapshot_ngram : renvoient les
+//    valeurs des paramètres de découpage en mots (voir wc_filecount) et de la
+//    longueur des suites de mots comptées (voir wc_set_ngram) avec lesquelles
+//    les fichiers de l'instantané associé à sn ont été comptés.
+extern size_t snapshot_max_w_len(const snapshot *sn);
+extern bool snapshot_only_alpha_num(const snapshot *sn);
+extern size_t snapshot_ngram(const snapshot *sn);
+
+//  snapshot_apply : appelle fun(context, S, channel, count) pour chaque mot de
+//    l'instantané associé à sn, dans l'ordre croissant des chaines, S étant sa
+//    chaine, valide seulement durant l'appel, channel START_CHANNEL augmenté
+//    du rang du fichier dans lequel il a été rencontré, et count son
+//    compteur. Les appels sont interrompus avant la fin si un appel à fun
+//    renvoie une valeur différente de 0 ; cette valeur est alors renvoyée.
+//    Renvoie sinon 1 en cas de dépassement de capacité, 3 si un
+//    enregistrement est invalide, 0 sinon.
+extern int snapshot_apply(snapshot *sn, void *context,
+    int (*fun)(void *context, const char *s, int channel,
+    long unsigned int count));
+
+//  snapshot_apply_fingerprints : appelle fun(context, fp) pour chaque
+//    empreinte fp de mot de canal multiple de l'instantané associé à sn. Les
+//    appels sont interrompus avant la fin si un appel à fun renvoie une valeur
+//    différente de 0 ; cette valeur est alors renvoyée. Renvoie sinon 0.
+extern int snapshot_apply_fingerprints(snapshot *sn, void *context,
+    int (*fun)(void *context, uint64_t fp));
+
+//  snapshot_write : écrit dans le fichier de chemin path l'instantané du
+//    comptage des nfiles fichiers de noms name[0], ..., name[nfiles - 1] dont
+//    les mots ont été comptés, avec les paramètres de découpage max_w_len et
+//    only_alpha_num, par suites de ngram mots, dans les n compteurs de mots
+//    du tableau w, supposés avoir des vocabulaires disjoints. Le fichier est
+//    écrit à côté sous un nom temporaire puis renommé, si bien qu'un
+//    instantané existant de même chemin n'est remplacé qu'en cas de succès.
+//    Les compteurs de mots ne sont pas modifiés. Renvoie 0 en cas de succès,
+//    1 en cas de dépassement de capacité, 2 en cas d'erreur d'écriture.
+extern int snapshot_write(const char *path, wordcounter **w, size_t n,
+    const char * const *name, size_t nfiles, size_t max_w_len,
+    bool only_alpha_num, size_t ngram);
+
+#endif
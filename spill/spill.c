@@ -0,0 +1,530 @@
+//  Partie implantation du module spill.
+
+#include "spill.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+//  SPILL__FANOUT : nombre de partitions entre lesquelles est répartie une
+//    partition dont le contenu ne tient pas en mémoire lors de son chargement.
+#define SPILL__FANOUT 4
+
+//  SPILL__LEVEL_MAX : nombre maximal de répartitions successives d'une même
+//    partition.
+#define SPILL__LEVEL_MAX 16
+
+//  SPILL__TAG_WORD, SPILL__TAG_FP : premier octet d'un enregistrement, selon
+//    qu'il s'agit de l'état d'un mot ou de l'empreinte d'un mot de canal
+//    multiple. L'état d'un mot est ensuite formé de la longueur de sa chaine
+//    (size_t), de ses caractères, de son canal (int) et de son compteur
+//    (long unsigned int) ; l'empreinte est un uint64_t.
+#define SPILL__TAG_WORD 'W'
+#define SPILL__TAG_FP   'F'
+
+//  struct spill : les tableaux part, level et runend, de longueur capacity,
+//    mémorisent pour chacune des npart partitions le flot de son fichier
+//    temporaire, son niveau de répartition et, après spill_sort, la position
+//    de fin de la suite triée qui y a été écrite. Les nbase premières
+//    partitions, de niveau 0, reçoivent les déversements ; les suivantes sont
+//    ajoutées lorsqu'une partition est répartie à nouveau.
+struct spill {
+  FILE **part;
+  unsigned int *level;
+  long int *runend;
+  size_t nbase;
+  size_t npart;
+  size_t capacity;
+};
+
+//  spill__index : renvoie l'indice, parmi n partitions de niveau level, de la
+//    partition qui reçoit le mot ou l'empreinte de valeur de hachage h. Le
+//    niveau est mêlé à h de sorte que les indices aux différents niveaux
+//    soient indépendants.
+static size_t spill__index(uint64_t h, unsigned int level, size_t n) {
+  h ^= level * 0x9e3779b97f4a7c15ULL;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return (size_t) (h >> 32) % n;
+}
+
+//  spill__part : renvoie le flot de la partition de niveau 0 de sp qui reçoit
+//    le mot ou l'empreinte de valeur de hachage h.
+static FILE *spill__part(const spill *sp, uint64_t h) {
+  return sp->part[spill__index(h, 0, sp->nbase)];
+}
+
+//  spill__add : tente d'ajouter à sp n nouvelles partitions vides de niveau
+//    level. Renvoie 1 en cas de dépassement de capacité, 2 en cas d'erreur à
+//    la création d'un fichier temporaire, sinon 0.
+static int spill__add(spill *sp, size_t n, unsigned int level) {
+  if (sp->npart + n > sp->capacity) {
+    size_t c = sp->capacity * 2 + n;
+    FILE **p = realloc(sp->part, c * sizeof *p);
+    if (p == NULL) {
+      return 1;
+    }
+    sp->part = p;
+    unsigned int *l = realloc(sp->level, c * sizeof *l);
+    if (l == NULL) {
+      return 1;
+    }
+    sp->level = l;
+    long int *e = realloc(sp->runend, c * sizeof *e);
+    if (e == NULL) {
+      return 1;
+    }
+    sp->runend = e;
+    sp->capacity = c;
+  }
+  for (size_t k = 0; k < n; ++k) {
+    FILE *f = tmpfile();
+    if (f == NULL) {
+      return 2;
+    }
+    sp->part[sp->npart] = f;
+    sp->level[sp->npart] = level;
+    sp->runend[sp->npart] = 0;
+    ++sp->npart;
+  }
+  return 0;
+}
+
+spill *spill_empty(size_t npart) {
+  spill *sp = malloc(sizeof *sp);
+  if (sp == NULL) {
+    return NULL;
+  }
+  sp->part = NULL;
+  sp->level = NULL;
+  sp->runend = NULL;
+  sp->nbase = npart;
+  sp->npart = 0;
+  sp->capacity = 0;
+  if (spill__add(sp, npart, 0) != 0) {
+    spill_dispose(&sp);
+    return NULL;
+  }
+  return sp;
+}
+
+void spill_dispose(spill **sp) {
+  if (*sp == NULL) {
+    return;
+  }
+  for (size_t k = 0; k < (*sp)->npart; ++k) {
+    fclose((*sp)->part[k]);
+  }
+  free((*sp)->part);
+  free((*sp)->level);
+  free((*sp)->runend);
+  free(*sp);
+  *sp = NULL;
+}
+
+//  Écriture -------------------------------------------------------------------
+
+//  spill__put_state, spill__put_fp : écrit dans le flot f l'enregistrement de
+//    l'état pointé par sw, de l'empreinte fp. Renvoie 2 en cas d'erreur, 0
+//    sinon.
+static int spill__put_state(FILE *f, const spill_word *sw) {
+  size_t len = strlen(sw->str);
+  if (fputc(SPILL__TAG_WORD, f) == EOF
+      || fwrite(&len, sizeof len, 1, f) != 1
+      || fwrite(sw->str, 1, len, f) != len
+      || fwrite(&sw->channel, sizeof sw->channel, 1, f) != 1
+      || fwrite(&sw->count, sizeof sw->count, 1, f) != 1) {
+    return 2;
+  }
+  return 0;
+}
+
+static int spill__put_fp(FILE *f, uint64_t fp) {
+  if (fputc(SPILL__TAG_FP, f) == EOF
+      || fwrite(&fp, sizeof fp, 1, f) != 1) {
+    return 2;
+  }
+  return 0;
+}
+
+//  spill__put_word : écrit dans le flot f l'enregistrement de l'état du mot
+//    pointé par p. Renvoie 2 en cas d'erreur, 0 sinon.
+static int spill__put_word(FILE *f, const word *p) {
+  spill_word sw = {
+    .str = word_str(p),
+    .channel = word_channel(p),
+    .count = word_count(p),
+  };
+  return spill__put_state(f, &sw);
+}
+
+//  spill__write_word, spill__write_fp : sert pour spill_write. Écrit
+//    l'enregistrement du mot pointé par p, de l'empreinte fp, dans la
+//    partition de sp qui lui correspond. Renvoie 2 en cas d'erreur, 0 sinon.
+static int spill__write_word(spill *sp, word *p) {
+  return spill__put_word(spill__part(sp, wc_str_hash(word_str(p))), p);
+}
+
+static int spill__write_fp(spill *sp, uint64_t fp) {
+  return spill__put_fp(spill__part(sp, fp), fp);
+}
+
+int spill_write(spill *sp, wordcounter *w) {
+  if (wc_apply_context(w, sp, (int (*)(void *, word *))spill__write_word)
+      != 0
+      || wc_apply_multi_fingerprints(w, sp,
+      (int (*)(void *, uint64_t))spill__write_fp) != 0) {
+    return 2;
+  }
+  wc_clear(w);
+  return 0;
+}
+
+//  Lecture --------------------------------------------------------------------
+
+//  spill__get_word : lit dans le flot f la suite d'un enregistrement d'état de
+//    mot dont la marque a déjà été lue, à l'aide du tampon *buf de longueur
+//    *bufsize, agrandi au besoin, et l'affecte à *sw. Renvoie 1 en cas de
+//    dépassement de capacité, 2 en cas d'erreur, sinon 0.
+static int spill__get_word(FILE *f, char **buf, size_t *bufsize,
+    spill_word *sw) {
+  size_t len;
+  if (fread(&len, sizeof len, 1, f) != 1) {
+    return 2;
+  }
+  if (len >= *bufsize) {
+    char *b = realloc(*buf, len + 1);
+    if (b == NULL) {
+      return 1;
+    }
+    *buf = b;
+    *bufsize = len + 1;
+  }
+  if (fread(*buf, 1, len, f) != len
+      || fread(&sw->channel, sizeof sw->channel, 1, f) != 1
+      || fread(&sw->count, sizeof sw->count, 1, f) != 1) {
+    return 2;
+  }
+  (*buf)[len] = '\0';
+  sw->str = *buf;
+  return 0;
+}
+
+//  spill__read : lit depuis son début le contenu du flot f d'une partition, à
+//    l'aide du tampon *buf de longueur *bufsize, agrandi au besoin, et appelle
+//    word_fun(context, SW) pour chaque état SW et fp_fun(context, FP) pour
+//    chaque empreinte FP lus, tant que ces appels renvoient 0. Renvoie la
+//    première valeur non nulle renvoyée par ces appels, sinon 1 en cas de
+//    dépassement de capacité, 2 en cas d'erreur, sinon 0.
+static int spill__read(FILE *f, char **buf, size_t *bufsize, void *context,
+    int (*word_fun)(void *context, const spill_word *sw),
+    int (*fp_fun)(void *context, uint64_t fp)) {
+  if (fflush(f) != 0) {
+    return 2;
+  }
+  rewind(f);
+  int c;
+  while ((c = fgetc(f)) != EOF) {
+    int r;
+    if (c == SPILL__TAG_FP) {
+      uint64_t fp;
+      if (fread(&fp, sizeof fp, 1, f) != 1) {
+        return 2;
+      }
+      r = fp_fun(context, fp);
+    } else if (c == SPILL__TAG_WORD) {
+      spill_word sw;
+      r = spill__get_word(f, buf, bufsize, &sw);
+      if (r == 0) {
+        r = word_fun(context, &sw);
+      }
+    } else {
+      r = 2;
+    }
+    if (r != 0) {
+      return r;
+    }
+  }
+  return ferror(f) ? 2 : 0;
+}
+
+//  spill__load_word, spill__load_fp : sert pour spill__read lors du
+//    chargement d'une partition dans w. Renvoie 1 en cas de dépassement de
+//    capacité, 0 sinon.
+static int spill__load_word(wordcounter *w, const spill_word *sw) {
+  return wc_addstate(w, sw->str, sw->channel, sw->count) != 0 ? 1 : 0;
+}
+
+static int spill__load_fp(wordcounter *w, uint64_t fp) {
+  return wc_add_multi_fingerprint(w, fp) != 0 ? 1 : 0;
+}
+
+//  struct spill__split : sert pour spill__split. Les enregistrements lus sont
+//    répartis entre les n partitions de sp de niveau level à partir de first.
+struct spill__split {
+  spill *sp;
+  size_t first;
+  size_t n;
+  unsigned int level;
+};
+
+//  spill__split_part : renvoie le flot de la nouvelle partition qui reçoit le
+//    mot ou l'empreinte de valeur de hachage h.
+static FILE *spill__split_part(const struct spill__split *ss, uint64_t h) {
+  return ss->sp->part[ss->first + spill__index(h, ss->level, ss->n)];
+}
+
+//  spill__split_word, spill__split_fp : sert pour spill__read lors de la
+//    répartition d'une partition. Renvoie 2 en cas d'erreur, 0 sinon.
+
+static int spill__split_word(struct spill__split *ss, const spill_word *sw) {
+  return spill__put_state(spill__split_part(ss, wc_str_hash(sw->str)), sw);
+}
+
+static int spill__split_fp(struct spill__split *ss, uint64_t fp) {
+  return spill__put_fp(spill__split_part(ss, fp), fp);
+}
+
+//  spill__split : répartit le contenu de la partition k de sp, dont le contenu
+//    ne tient pas en mémoire, entre SPILL__FANOUT nouvelles partitions de
+//    niveau supérieur, puis la vide. Renvoie 1 en cas de dépassement de
+//    capacité ou si le niveau maximal est atteint, 2 en cas d'erreur, sinon 0.
+static int spill__split(spill *sp, size_t k, char **buf, size_t *bufsize) {
+  if (sp->level[k] >= SPILL__LEVEL_MAX) {
+    return 1;
+  }
+  struct spill__split ss = {
+    .sp = sp,
+    .first = sp->npart,
+    .n = SPILL__FANOUT,
+    .level = sp->level[k] + 1,
+  };
+  int r = spill__add(sp, ss.n, ss.level);
+  if (r != 0) {
+    return r;
+  }
+  r = spill__read(sp->part[k], buf, bufsize, &ss,
+      (int (*)(void *, const spill_word *))spill__split_word,
+      (int (*)(void *, uint64_t))spill__split_fp);
+  if (r != 0) {
+    return r;
+  }
+  fclose(sp->part[k]);
+  sp->part[k] = tmpfile();
+  return sp->part[k] == NULL ? 2 : 0;
+}
+
+//  spill__collect : pour chaque partition k de sp, charge son contenu dans w,
+//    en retire les mots de canal multiple, appelle fun(context, sp, k, w) puis
+//    vide w. Une partition dont le contenu ne tient pas en mémoire est
+//    répartie à nouveau, les partitions ainsi ajoutées étant traitées à leur
+//    tour. Renvoie la première valeur non nulle renvoyée par fun, par le
+//    chargement ou par la répartition, 0 sinon.
+static int spill__collect(spill *sp, wordcounter *w, void *context,
+    int (*fun)(void *context, spill *sp, size_t k, wordcounter *w)) {
+  char *buf = NULL;
+  size_t bufsize = 0;
+  int r = 0;
+  for (size_t k = 0; r == 0 && k < sp->npart; ++k) {
+    r = spill__read(sp->part[k], &buf, &bufsize, w,
+        (int (*)(void *, const spill_word *))spill__load_word,
+        (int (*)(void *, uint64_t))spill__load_fp);
+    if (r == 0) {
+      wc_reclaim(w);
+      r = fun(context, sp, k, w);
+    } else if (r == 1) {
+      wc_clear(w);
+      r = spill__split(sp, k, &buf, &bufsize);
+    }
+    wc_clear(w);
+  }
+  free(buf);
+  return r;
+}
+
+//  struct spill__apply, spill__apply_call : sert pour spill_collect, via
+//    spill__collect.
+struct spill__apply {
+  void *context;
+  int (*fun)(void *context, wordcounter *w);
+};
+
+static int spill__apply_call(struct spill__apply *ap, spill *sp, size_t k,
+    wordcounter *w) {
+  (void) sp;
+  (void) k;
+  return ap->fun(ap->context, w);
+}
+
+int spill_collect(spill *sp, wordcounter *w, void *context,
+    int (*fun)(void *context, wordcounter *w)) {
+  struct spill__apply ap = {
+    .context = context,
+    .fun = fun,
+  };
+  return spill__collect(sp, w, &ap,
+      (int (*)(void *, spill *, size_t, wordcounter *))spill__apply_call);
+}
+
+//  Tri et fusion --------------------------------------------------------------
+
+//  spill__run_word : sert pour spill__run. Écrit l'état du mot pointé par p
+//    dans le flot f s'il n'est pas de canal multiple. Renvoie 2 en cas
+//    d'erreur, 0 sinon.
+static int spill__run_word(FILE *f, word *p) {
+  return word_channel(p) == MULTI_CHANNEL ? 0 : spill__put_word(f, p);
+}
+
+//  spill__run : sert pour spill_sort, via spill__collect. Trie w à l'aide de
+//    sort puis remplace la partition k de sp par la suite triée des états de
+//    ses mots. Renvoie 2 en cas d'erreur, 0 sinon.
+static int spill__run(void (*sort)(wordcounter *), spill *sp, size_t k,
+    wordcounter *w) {
+  sort(w);
+  FILE *f = sp->part[k];
+  rewind(f);
+  if (wc_apply_context(w, f, (int (*)(void *, word *))spill__run_word) != 0
+      || fflush(f) != 0 || (sp->runend[k] = ftell(f)) < 0) {
+    return 2;
+  }
+  return 0;
+}
+
+//  struct spill__sort, spill__sort_call : sert pour spill_sort, via
+//    spill__collect. La fonction sort est transmise dans une structure, un
+//    pointeur de fonction ne pouvant être converti en pointeur d'objet.
+struct spill__sort {
+  void (*sort)(wordcounter *);
+};
+
+static int spill__sort_call(struct spill__sort *ss, spill *sp, size_t k,
+    wordcounter *w) {
+  return spill__run(ss->sort, sp, k, w);
+}
+
+int spill_sort(spill *sp, wordcounter *w, void (*sort)(wordcounter *)) {
+  struct spill__sort ss = {
+    .sort = sort,
+  };
+  return spill__collect(sp, w, &ss,
+      (int (*)(void *, spill *, size_t, wordcounter *))spill__sort_call);
+}
+
+//  struct spill__head : tête de lecture d'une suite triée, dont l'état courant
+//    est sw, lu à l'aide du tampon buf de longueur bufsize.
+struct spill__head {
+  spill_word sw;
+  char *buf;
+  size_t bufsize;
+};
+
+//  spill__next : lit dans la tête h l'état suivant de la suite triée de la
+//    partition k de sp. Affecte à *more false si la suite est épuisée, true
+//    sinon. Renvoie 1 en cas de dépassement de capacité, 2 en cas d'erreur,
+//    sinon 0.
+static int spill__next(spill *sp, size_t k, struct spill__head *h,
+    bool *more) {
+  FILE *f = sp->part[k];
+  long int pos = ftell(f);
+  if (pos < 0) {
+    return 2;
+  }
+  *more = pos < sp->runend[k];
+  if (!*more) {
+    return 0;
+  }
+  if (fgetc(f) != SPILL__TAG_WORD) {
+    return 2;
+  }
+  return spill__get_word(f, &h->buf, &h->bufsize, &h->sw);
+}
+
+//  spill__sift : rétablit la propriété de tas, selon compar appliquée aux
+//    états des têtes heads, du sous-arbre de racine i du tas heap de longueur
+//    n dont seule cette racine est éventuellement mal placée.
+static void spill__sift(size_t *heap, size_t n, size_t i,
+    struct spill__head *heads,
+    int (*compar)(const spill_word *, const spill_word *)) {
+  while (2 * i + 1 < n) {
+    size_t c = 2 * i + 1;
+    if (c + 1 < n && compar(&heads[heap[c + 1]].sw, &heads[heap[c]].sw) < 0) {
+      ++c;
+    }
+    if (compar(&heads[heap[c]].sw, &heads[heap[i]].sw) >= 0) {
+      return;
+    }
+    size_t t = heap[i];
+    heap[i] = heap[c];
+    heap[c] = t;
+    i = c;
+  }
+}
+
+int spill_merge(spill *sp,
+    int (*compar)(const spill_word *, const spill_word *), void *context,
+    int (*fun)(void *context, const spill_word *)) {
+  struct spill__head *heads = calloc(sp->npart, sizeof *heads);
+  size_t *heap = malloc(sp->npart * sizeof *heap);
+  int r = 0;
+  if (heads == NULL || heap == NULL) {
+    r = 1;
+    goto dispose;
+  }
+  size_t n = 0;
+  for (size_t k = 0; k < sp->npart; ++k) {
+    rewind(sp->part[k]);
+    bool more;
+    if ((r = spill__next(sp, k, &heads[k], &more)) != 0) {
+      goto dispose;
+    }
+    if (more) {
+      heap[n] = k;
+      ++n;
+    }
+  }
+  for (size_t i = n; i > 0; --i) {
+    spill__sift(heap, n, i - 1, heads, compar);
+  }
+  while (n > 0) {
+    size_t k = heap[0];
+    if ((r = fun(context, &heads[k].sw)) != 0) {
+      goto dispose;
+    }
+    bool more;
+    if ((r = spill__next(sp, k, &heads[k], &more)) != 0) {
+      goto dispose;
+    }
+    if (!more) {
+      --n;
+      heap[0] = heap[n];
+    }
+    spill__sift(heap, n, 0, heads, compar);
+  }
+dispose:
+  for (size_t k = 0; heads != NULL && k < sp->npart; ++k) {
+    free(heads[k].buf);
+  }
+  free(heads);
+  free(heap);
+  return r;
+}
+
+int spill_compare_lexical(const spill_word *w1, const spill_word *w2) {
+  return strcoll(w1->str, w2->str);
+}
+
+int spill_compare_lexical_reverse(const spill_word *w1,
+    const spill_word *w2) {
+  return strcoll(w2->str, w1->str);
+}
+
+int spill_compare_count(const spill_word *w1, const spill_word *w2) {
+  int r = (w1->count > w2->count) - (w1->count < w2->count);
+  return r != 0 ? r : spill_compare_lexical(w1, w2);
+}
+
+int spill_compare_count_reverse(const spill_word *w1, const spill_word *w2) {
+  int r = (w1->count < w2->count) - (w1->count > w2->count);
+  return r != 0 ? r : spill_compare_lexical(w1, w2);
+}
@@ -0,0 +1,109 @@
+//  Partie interface du module spill (débordement sur disque).
+//
+//  Le module spill permet de compter les mots d'un vocabulaire qui ne tient
+//    pas en mémoire. Lorsque la mémoire vient à manquer, le contenu d'un
+//    compteur de mots est déversé dans des fichiers temporaires, puis le
+//    compteur est vidé et le comptage se poursuit. Les mots sont répartis
+//    entre les fichiers, ou partitions, selon leur valeur de hachage : toutes
+//    les occurrences d'un même mot aboutissent ainsi dans la même partition.
+//    Une fois le comptage terminé, chaque partition est rechargée seule dans
+//    un compteur de mots, ce qui suffit à décider quels mots n'appartiennent
+//    qu'à un seul canal. Le résultat peut alors être parcouru partition par
+//    partition, ou bien chaque partition peut être triée puis l'ensemble
+//    fusionné : seule une partition à la fois réside en mémoire. Une
+//    partition trop grande pour la mémoire disponible est elle-même répartie
+//    selon d'autres bits de hachage entre de nouvelles partitions.
+
+#ifndef SPILL__H
+#define SPILL__H
+
+#include <stdlib.h>
+#include "wordcounter.h"
+
+//  Fonctionnement général :
+//  - une partition est une suite d'enregistrements binaires, qui sont soit
+//      l'état (chaine, canal, compteur) d'un mot, soit l'empreinte d'un mot de
+//      canal multiple (voir wc_set_reclaim) ;
+//  - après spill_sort, chaque partition est remplacée par la suite triée des
+//      états de ses mots qui ne sont pas de canal multiple ;
+//  - spill_write ne peut plus être appelée après spill_collect ou spill_sort,
+//      ni spill_collect ou spill_sort après spill_sort ;
+//  - les fichiers temporaires sont supprimés au plus tard à la fin du
+//      programme ;
+//  - les fonctions qui peuvent échouer renvoient 1 en cas de dépassement de
+//      capacité et 2 en cas d'erreur d'entrée-sortie sur les fichiers
+//      temporaires.
+
+//  struct spill, spill : type et nom de type d'un contrôleur regroupant les
+//    informations permettant de gérer des partitions sur disque.
+typedef struct spill spill;
+
+//  struct spill_word, spill_word : état d'un mot lu dans une partition : sa
+//    chaine str, son canal channel et son compteur count.
+typedef struct spill_word spill_word;
+
+struct spill_word {
+  const char *str;
+  int channel;
+  long unsigned int count;
+};
+
+//  spill_empty : tente d'allouer les ressources nécessaires pour gérer npart
+//    partitions initialement vides, npart étant supposé non nul. Renvoie NULL
+//    en cas de dépassement de capacité ou d'erreur à la création d'un fichier
+//    temporaire. Renvoie sinon un pointeur vers le contrôleur associé.
+extern spill *spill_empty(size_t npart);
+
+//  spill_dispose : sans effet si *sp vaut NULL. Libère sinon les ressources
+//    allouées à la gestion des partitions associées à *sp, fichiers
+//    temporaires compris, puis affecte NULL à *sp.
+extern void spill_dispose(spill **sp);
+
+//  spill_write : déverse dans les partitions associées à sp l'état de tous les
+//    mots de w ainsi que les empreintes de ses mots de canal multiple, puis
+//    vide w à l'aide de wc_clear. Renvoie 2 en cas d'erreur d'entrée-sortie,
+//    w étant alors laissé inchangé et le contenu des partitions indéterminé.
+//    Renvoie sinon 0.
+extern int spill_write(spill *sp, wordcounter *w);
+
+//  spill_collect : pour chaque partition associée à sp, charge son contenu
+//    dans w, supposé vide, en retire les mots de canal multiple, appelle
+//    fun(context, w) puis vide w. Le mode récupération de w est activé. Les
+//    appels sont interrompus avant la fin si un appel à fun renvoie une valeur
+//    différente de 0 ; cette valeur est alors renvoyée. Renvoie sinon 1 en cas
+//    de dépassement de capacité, 2 en cas d'erreur d'entrée-sortie, 0 sinon.
+extern int spill_collect(spill *sp, wordcounter *w, void *context,
+    int (*fun)(void *context, wordcounter *w));
+
+//  spill_sort : comme spill_collect, mais trie w à l'aide de la fonction sort,
+//    qui est l'une des fonctions wc_sort_*, et remplace chaque partition par
+//    la suite triée des états de ses mots qui ne sont pas de canal multiple.
+//    Renvoie 1 en cas de dépassement de capacité, 2 en cas d'erreur
+//    d'entrée-sortie, 0 sinon.
+extern int spill_sort(spill *sp, wordcounter *w, void (*sort)(wordcounter *));
+
+//  spill_merge : fusionne les partitions triées par spill_sort associées à sp
+//    selon la fonction de comparaison compar, qui doit correspondre à la
+//    fonction de tri utilisée, et appelle fun(context, W) pour chaque état W
+//    dans l'ordre obtenu. La chaine W->str n'est valide que durant l'appel.
+//    Les appels sont interrompus avant la fin si un appel à fun renvoie une
+//    valeur différente de 0 ; cette valeur est alors renvoyée. Renvoie sinon 1
+//    en cas de dépassement de capacité, 2 en cas d'erreur d'entrée-sortie, 0
+//    sinon.
+extern int spill_merge(spill *sp,
+    int (*compar)(const spill_word *, const spill_word *), void *context,
+    int (*fun)(void *context, const spill_word *));
+
+//  spill_compare_lexical, spill_compare_count, spill_compare_lexical_reverse,
+//    spill_compare_count_reverse : fonctions de comparaison à fournir à
+//    spill_merge lorsque les partitions ont été triées respectivement par
+//    wc_sort_lexical, wc_sort_count, wc_sort_lexical_reverse et
+//    wc_sort_count_reverse.
+extern int spill_compare_lexical(const spill_word *w1, const spill_word *w2);
+extern int spill_compare_count(const spill_word *w1, const spill_word *w2);
+extern int spill_compare_lexical_reverse(const spill_word *w1,
+    const spill_word *w2);
+extern int spill_compare_count_reverse(const spill_word *w1,
+    const spill_word *w2);
+
+#endif
@@ -0,0 +1,139 @@
+//  Partie implantation du module steal.
+
+#include "steal.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+//  struct steal__deque, steal__deque : deque d'un fil. Les tâches qui restent
+//    à y prendre sont celles dont le numéro est compris entre lo inclus et hi
+//    exclu. Le composant mutex protège toute modification de lo et de hi.
+typedef struct steal__deque steal__deque;
+
+struct steal__deque {
+  pthread_mutex_t mutex;
+  size_t lo;
+  size_t hi;
+};
+
+//  struct steal__group, steal__group : informations partagées par les fils. Le
+//    tableau dq de longueur n mémorise leurs deques. result mémorise la
+//    première valeur non nulle renvoyée par fun, 0 s'il n'y en a pas.
+typedef struct steal__group steal__group;
+
+struct steal__group {
+  steal__deque *dq;
+  size_t n;
+  atomic_int result;
+  void *context;
+  int (*fun)(void *context, size_t worker, size_t k);
+};
+
+//  struct steal__worker, steal__worker : fil de numéro id du groupe g.
+typedef struct steal__worker steal__worker;
+
+struct steal__worker {
+  steal__group *g;
+  size_t id;
+  pthread_t thread;
+};
+
+//  steal__pop : tente de prendre la tâche à l'avant de la deque d. Renvoie
+//    true et affecte son numéro à *k en cas de succès, renvoie false si la
+//    deque est vide.
+static bool steal__pop(steal__deque *d, size_t *k) {
+  pthread_mutex_lock(&d->mutex);
+  bool r = d->lo < d->hi;
+  if (r) {
+    *k = d->lo;
+    ++d->lo;
+  }
+  pthread_mutex_unlock(&d->mutex);
+  return r;
+}
+
+//  steal__steal : tente de voler, pour le fil de numéro id du groupe g dont la
+//    deque est vide, la moitié arrière de la première deque non vide trouvée
+//    parmi celles des autres fils. Renvoie true en cas de succès, la première
+//    tâche volée étant affectée à *k et les suivantes placées dans la deque du
+//    fil. Renvoie false si toutes les deques sont vides.
+static bool steal__steal(steal__group *g, size_t id, size_t *k) {
+  for (size_t i = 1; i < g->n; ++i) {
+    steal__deque *v = &g->dq[(id + i) % g->n];
+    pthread_mutex_lock(&v->mutex);
+    size_t take = (v->hi - v->lo + 1) / 2;
+    size_t lo = v->hi - take;
+    size_t hi = v->hi;
+    v->hi = lo;
+    pthread_mutex_unlock(&v->mutex);
+    if (take != 0) {
+      *k = lo;
+      steal__deque *d = &g->dq[id];
+      pthread_mutex_lock(&d->mutex);
+      d->lo = lo + 1;
+      d->hi = hi;
+      pthread_mutex_unlock(&d->mutex);
+      return true;
+    }
+  }
+  return false;
+}
+
+//  steal__run : fonction exécutée par chacun des fils, arg pointant vers son
+//    steal__worker. Exécute les tâches de sa deque puis celles qu'il vole,
+//    tant qu'il en reste et qu'aucune n'a échoué.
+static void *steal__run(void *arg) {
+  steal__worker *w = arg;
+  steal__group *g = w->g;
+  size_t k;
+  while (atomic_load(&g->result) == 0
+      && (steal__pop(&g->dq[w->id], &k) || steal__steal(g, w->id, &k))) {
+    int r = g->fun(g->context, w->id, k);
+    if (r != 0) {
+      int zero = 0;
+      atomic_compare_exchange_strong(&g->result, &zero, r);
+    }
+  }
+  return NULL;
+}
+
+int steal_run(size_t nthreads, size_t ntasks, void *context,
+    int (*fun)(void *context, size_t worker, size_t k)) {
+  steal__group g = {
+    .dq = malloc(nthreads * sizeof *g.dq),
+    .n = nthreads,
+    .context = context,
+    .fun = fun,
+  };
+  steal__worker *w = malloc(nthreads * sizeof *w);
+  if (g.dq == NULL || w == NULL) {
+    free(g.dq);
+    free(w);
+    return -1;
+  }
+  atomic_init(&g.result, 0);
+  for (size_t i = 0; i < nthreads; ++i) {
+    pthread_mutex_init(&g.dq[i].mutex, NULL);
+    g.dq[i].lo = ntasks / nthreads * i + (i < ntasks % nthreads
+        ? i : ntasks % nthreads);
+    g.dq[i].hi = g.dq[i].lo + ntasks / nthreads + (i < ntasks % nthreads);
+    w[i].g = &g;
+    w[i].id = i;
+  }
+  size_t started = 0;
+  while (started < nthreads
+      && pthread_create(&w[started].thread, NULL, steal__run, &w[started])
+      == 0) {
+    ++started;
+  }
+  for (size_t i = 0; i < started; ++i) {
+    pthread_join(w[i].thread, NULL);
+  }
+  for (size_t i = 0; i < nthreads; ++i) {
+    pthread_mutex_destroy(&g.dq[i].mutex);
+  }
+  free(g.dq);
+  free(w);
+  return started == 0 ? -1 : atomic_load(&g.result);
+}
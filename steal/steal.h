@@ -0,0 +1,29 @@
+//  Partie interface du module steal (ordonnanceur par vol de tâches).
+//
+//  Le module steal permet d'exécuter une suite de tâches indépendantes, de
+//    durées très inégales et dont l'ordre d'exécution est indifférent, sur un
+//    groupe de fils d'exécution. Les tâches sont d'abord réparties en blocs
+//    contigus entre les files à double entrée, ou deques, des fils. Chaque fil
+//    exécute les tâches de sa deque en les prenant à l'avant ; lorsqu'elle est
+//    vide, il vole la moitié arrière de la deque d'un autre fil. Un fil ne
+//    reste ainsi inoccupé que lorsqu'il ne reste plus de tâche à démarrer.
+
+#ifndef STEAL__H
+#define STEAL__H
+
+#include <stdlib.h>
+
+//  steal_run : tente de démarrer nthreads fils d'exécution, nthreads étant
+//    supposé non nul, qui appellent fun(context, worker, k) pour chaque numéro
+//    de tâche k compris entre 0 et ntasks - 1, worker étant le numéro, compris
+//    entre 0 et nthreads - 1, du fil qui exécute la tâche : deux tâches de même
+//    worker ne sont jamais exécutées simultanément. Attend la fin de toutes les
+//    tâches. Dès qu'un appel à fun renvoie une valeur non nulle, les tâches
+//    non démarrées sont abandonnées. Renvoie -1 en cas de dépassement de
+//    capacité ou si aucun fil n'a pu être démarré, aucune tâche n'étant alors
+//    exécutée. Renvoie sinon la première valeur non nulle renvoyée par fun,
+//    0 si tous les appels ont renvoyé 0.
+extern int steal_run(size_t nthreads, size_t ntasks, void *context,
+    int (*fun)(void *context, size_t worker, size_t k));
+
+#endif
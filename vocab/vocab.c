@@ -0,0 +1,384 @@
+//  Partie implantation du module vocab.
+
+#define _GNU_SOURCE
+
+#include "vocab.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "atomicfile.h"
+
+//  VOCAB__MAGIC : premiers octets d'un vocabulaire.
+#define VOCAB__MAGIC "XWCVOCB"
+
+//  VOCAB__BYTE_ORDER : valeur écrite dans l'en-tête, qui permet de reconnaitre
+//    un vocabulaire écrit avec un autre boutisme.
+#define VOCAB__BYTE_ORDER 0x01020304
+
+//  VOCAB__VERSION : version du format.
+#define VOCAB__VERSION 2
+
+//  VOCAB__BUCKET_LEN : nombre moyen de chaines par groupe. Le vocabulaire de n
+//    chaines compte n / VOCAB__BUCKET_LEN + 1 groupes.
+#define VOCAB__BUCKET_LEN 4
+
+//  struct vocab__header, vocab__header : en-tête d'un vocabulaire de nwords
+//    chaines. Il est suivi des nbuckets pilotes,
+//    complétés au besoin par 4 octets nuls, des nwords positions des chaines
+//    dans la réserve, rangées par identifiant, puis de la réserve des chaines
+//    sur pool_size octets.
+typedef struct vocab__header vocab__header;
+
+struct vocab__header {
+  char magic[8];
+  uint32_t byte_order;
+  uint32_t version;
+  uint64_t nwords;
+  uint64_t nbuckets;
+  uint64_t pool_size;
+};
+
+//  struct vocab : la projection du vocabulaire commence à l'adresse map et
+//    s'étend sur size octets. nwords et nbuckets reprennent les valeurs de
+//    l'en-tête ; pilot, offset et pool en repèrent les pilotes, les positions
+//    des chaines et la réserve.
+struct vocab {
+  void *map;
+  size_t size;
+  size_t nwords;
+  size_t nbuckets;
+  const uint32_t *pilot;
+  const uint64_t *offset;
+  const char *pool;
+};
+
+//  Hachage --------------------------------------------------------------------
+
+//  vocab__mix : renvoie le mélange de x par la finalisation de splitmix64.
+static uint64_t vocab__mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+//  vocab__bucket : renvoie le groupe, parmi nbuckets, au plus UINT32_MAX, de
+//    la chaine de valeur de hachage h. Le groupe croît avec h.
+static size_t vocab__bucket(uint64_t h, size_t nbuckets) {
+  return (size_t) (((h >> 32) * (uint64_t) nbuckets) >> 32);
+}
+
+//  vocab__position : renvoie l'identifiant, parmi n, au plus UINT32_MAX, de la
+//    chaine de valeur de hachage h dont le groupe a pour pilote pilot.
+static size_t vocab__position(uint64_t h, uint64_t pilot, size_t n) {
+  return (size_t) (((vocab__mix(h ^ vocab__mix(pilot + 1)) >> 32)
+      * (uint64_t) n) >> 32);
+}
+
+//  Lecture --------------------------------------------------------------------
+
+//  vocab__check : vérifie la cohérence du vocabulaire projeté associé à v avec
+//    sa taille, puis repère ses différentes parties. Renvoie 3 si le
+//    vocabulaire est invalide, 0 sinon.
+static int vocab__check(vocab *v) {
+  const vocab__header *h = v->map;
+  if (v->size < sizeof *h
+      || memcmp(h->magic, VOCAB__MAGIC, sizeof VOCAB__MAGIC) != 0
+      || h->byte_order != VOCAB__BYTE_ORDER
+      || h->version != VOCAB__VERSION
+      || h->nwords > UINT32_MAX
+      || h->nbuckets != h->nwords / VOCAB__BUCKET_LEN + 1) {
+    return 3;
+  }
+  uint64_t left = v->size - sizeof *h;
+  uint64_t pilots_size = (h->nbuckets + h->nbuckets % 2) * sizeof *v->pilot;
+  if (pilots_size > left) {
+    return 3;
+  }
+  left -= pilots_size;
+  if (h->nwords > left / sizeof *v->offset) {
+    return 3;
+  }
+  left -= h->nwords * sizeof *v->offset;
+  if (h->pool_size != left) {
+    return 3;
+  }
+  v->nwords = (size_t) h->nwords;
+  v->nbuckets = (size_t) h->nbuckets;
+  v->pilot = (const uint32_t *) (h + 1);
+  v->offset = (const uint64_t *) ((const char *) v->pilot + pilots_size);
+  v->pool = (const char *) (v->offset + v->nwords);
+  if (v->nwords != 0 && v->pool[h->pool_size - 1] != '\0') {
+    return 3;
+  }
+  for (size_t id = 0; id < v->nwords; ++id) {
+    if (v->offset[id] >= h->pool_size) {
+      return 3;
+    }
+  }
+  return 0;
+}
+
+vocab *vocab_open(const char *path, int *error) {
+  vocab *v = malloc(sizeof *v);
+  if (v == NULL) {
+    *error = 1;
+    return NULL;
+  }
+  v->map = MAP_FAILED;
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    *error = 2;
+    goto error;
+  }
+  v->size = (size_t) st.st_size;
+  if (v->size < sizeof(vocab__header)) {
+    *error = 3;
+    goto error;
+  }
+  v->map = mmap(NULL, v->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (v->map == MAP_FAILED) {
+    *error = 2;
+    goto error;
+  }
+  close(fd);
+  fd = -1;
+  *error = vocab__check(v);
+  if (*error != 0) {
+    goto error;
+  }
+  madvise(v->map, v->size, MADV_WILLNEED);
+  return v;
+error:
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (v->map != MAP_FAILED) {
+    munmap(v->map, v->size);
+  }
+  free(v);
+  return NULL;
+}
+
+void vocab_dispose(vocab **v) {
+  if (*v == NULL) {
+    return;
+  }
+  munmap((*v)->map, (*v)->size);
+  free(*v);
+  *v = NULL;
+}
+
+size_t vocab_size(const vocab *v) {
+  return v->nwords;
+}
+
+const char *vocab_word(const vocab *v, size_t id) {
+  return v->pool + v->offset[id];
+}
+
+size_t vocab_position(const vocab *v, uint64_t h) {
+  return vocab__position(h, v->pilot[vocab__bucket(h, v->nbuckets)],
+      v->nwords);
+}
+
+//  Écriture -------------------------------------------------------------------
+
+//  struct vocab__key, vocab__key : chaine de rang index parmi celles à écrire,
+//    de valeur de hachage h.
+typedef struct vocab__key vocab__key;
+
+struct vocab__key {
+  uint64_t h;
+  size_t index;
+};
+
+//  struct vocab__range, vocab__range : groupe bucket, dont les chaines occupent
+//    len places consécutives à partir de l'indice first du tableau des clés.
+typedef struct vocab__range vocab__range;
+
+struct vocab__range {
+  size_t bucket;
+  size_t first;
+  size_t len;
+};
+
+//  vocab__compare_key : sert pour vocab_write, via qsort. Compare les valeurs
+//    de hachage, puis les rangs, des clés pointées par k1 et k2.
+static int vocab__compare_key(const vocab__key *k1, const vocab__key *k2) {
+  if (k1->h != k2->h) {
+    return (k1->h > k2->h) - (k1->h < k2->h);
+  }
+  return (k1->index > k2->index) - (k1->index < k2->index);
+}
+
+//  vocab__compare_range : sert pour vocab__place, via qsort. Range les groupes
+//    pointés par r1 et r2 dans l'ordre décroissant de leurs tailles.
+static int vocab__compare_range(const vocab__range *r1,
+    const vocab__range *r2) {
+  return (r1->len < r2->len) - (r1->len > r2->len);
+}
+
+//  vocab__place : choisit les pilotes des nbuckets groupes des n chaines dont
+//    les clés, de valeurs de hachage deux à deux distinctes, sont rangées dans
+//    l'ordre croissant dans le tableau key, à l'aide du tableau range de
+//    longueur nbuckets. Les groupes sont traités du plus grand au plus petit ;
+//    chacun reçoit le plus petit pilote qui attribue à ses chaines des
+//    identifiants encore libres. Affecte les pilotes à pilot et, pour chaque
+//    identifiant id, le rang de sa chaine à slot[id]. Renvoie 1 si aucun
+//    pilote ne convient à l'un des groupes, 0 sinon.
+static int vocab__place(const vocab__key *key, size_t n, size_t nbuckets,
+    vocab__range *range, uint32_t *pilot, size_t *slot) {
+  for (size_t b = 0; b < nbuckets; ++b) {
+    range[b].bucket = b;
+    range[b].first = 0;
+    range[b].len = 0;
+    pilot[b] = 0;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    vocab__range *r = &range[vocab__bucket(key[i].h, nbuckets)];
+    if (r->len == 0) {
+      r->first = i;
+    }
+    ++r->len;
+  }
+  qsort(range, nbuckets, sizeof *range,
+      (int (*)(const void *, const void *))vocab__compare_range);
+  for (size_t id = 0; id < n; ++id) {
+    slot[id] = SIZE_MAX;
+  }
+  for (size_t b = 0; b < nbuckets && range[b].len != 0; ++b) {
+    const vocab__key *k = key + range[b].first;
+    size_t len = range[b].len;
+    uint64_t p = 0;
+    while (true) {
+      // Les identifiants sont réservés au fur et à mesure, ce qui écarte
+      //    aussi deux chaines du groupe de même identifiant
+      size_t j = 0;
+      while (j < len) {
+        size_t id = vocab__position(k[j].h, p, n);
+        if (slot[id] != SIZE_MAX) {
+          break;
+        }
+        slot[id] = k[j].index;
+        ++j;
+      }
+      if (j == len) {
+        break;
+      }
+      while (j > 0) {
+        --j;
+        slot[vocab__position(k[j].h, p, n)] = SIZE_MAX;
+      }
+      if (p == UINT32_MAX) {
+        return 1;
+      }
+      ++p;
+    }
+    pilot[range[b].bucket] = (uint32_t) p;
+  }
+  return 0;
+}
+
+//  vocab__put : écrit dans le flot f le vocabulaire d'en-tête pointé par h,
+//    complété au passage, de pilotes pilot, dont la chaine d'identifiant id
+//    est word[slot[id]]. Renvoie 2 en cas d'erreur d'écriture, 0 sinon.
+static int vocab__put(FILE *f, vocab__header *h, const uint32_t *pilot,
+    const char * const *word, const size_t *slot) {
+  size_t n = (size_t) h->nwords;
+  size_t nbuckets = (size_t) h->nbuckets;
+  const uint32_t zero = 0;
+  if (fwrite(h, sizeof *h, 1, f) != 1
+      || fwrite(pilot, sizeof *pilot, nbuckets, f) != nbuckets
+      || (nbuckets % 2 != 0 && fwrite(&zero, sizeof zero, 1, f) != 1)) {
+    return 2;
+  }
+  uint64_t pool_size = 0;
+  for (size_t id = 0; id < n; ++id) {
+    if (fwrite(&pool_size, sizeof pool_size, 1, f) != 1) {
+      return 2;
+    }
+    pool_size += strlen(word[slot[id]]) + 1;
+  }
+  for (size_t id = 0; id < n; ++id) {
+    const char *s = word[slot[id]];
+    size_t len = strlen(s) + 1;
+    if (fwrite(s, 1, len, f) != len) {
+      return 2;
+    }
+  }
+  h->pool_size = pool_size;
+  if (fseek(f, 0, SEEK_SET) != 0 || fwrite(h, sizeof *h, 1, f) != 1) {
+    return 2;
+  }
+  return 0;
+}
+
+int vocab_write(const char *path, const char * const *word, size_t n,
+    uint64_t (*hash)(const char *s)) {
+  if (n > SIZE_MAX / sizeof(vocab__key)) {
+    return 1;
+  }
+  vocab__key *key = malloc(n * sizeof *key);
+  vocab__range *range = NULL;
+  uint32_t *pilot = NULL;
+  size_t *slot = NULL;
+  int r = 1;
+  if (key == NULL && n != 0) {
+    goto dispose;
+  }
+  // Clés rangées par valeurs de hachage ; parmi celles de même valeur, seule
+  //    la première chaine est retenue
+  for (size_t i = 0; i < n; ++i) {
+    key[i].h = hash(word[i]);
+    key[i].index = i;
+  }
+  if (n != 0) {
+    qsort(key, n, sizeof *key,
+        (int (*)(const void *, const void *))vocab__compare_key);
+  }
+  size_t m = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (m == 0 || key[i].h != key[m - 1].h) {
+      key[m] = key[i];
+      ++m;
+    }
+  }
+  if (m > UINT32_MAX) {
+    goto dispose;
+  }
+  size_t nbuckets = m / VOCAB__BUCKET_LEN + 1;
+  range = malloc(nbuckets * sizeof *range);
+  pilot = malloc(nbuckets * sizeof *pilot);
+  slot = malloc(m * sizeof *slot);
+  if (range == NULL || pilot == NULL || (slot == NULL && m != 0)
+      || vocab__place(key, m, nbuckets, range, pilot, slot) != 0) {
+    goto dispose;
+  }
+  vocab__header h = {
+    .magic = VOCAB__MAGIC,
+    .byte_order = VOCAB__BYTE_ORDER,
+    .version = VOCAB__VERSION,
+    .nwords = m,
+    .nbuckets = nbuckets,
+  };
+  atomicfile *af = atomicfile_open(path, &r);
+  if (af == NULL) {
+    goto dispose;
+  }
+  r = vocab__put(atomicfile_stream(af), &h, pilot, word, slot);
+  if (atomicfile_close(&af, r == 0) != 0) {
+    r = 2;
+  }
+dispose:
+  free(slot);
+  free(pilot);
+  free(range);
+  free(key);
+  return r;
+}
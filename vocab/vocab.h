@@ -0,0 +1,75 @@
+//  Partie interface du module vocab (vocabulaire).
+//
+//  Le module vocab permet d'enregistrer dans un fichier binaire un
+//    vocabulaire, c'est-à-dire un ensemble de chaines deux à deux distinctes,
+//    puis de le projeter en mémoire pour associer à chacune de ses chaines un
+//    identifiant entier compris entre 0 et le nombre de chaines exclu. Les
+//    identifiants sont calculés, à partir d'une valeur de hachage des chaines
+//    fournie par l'utilisateur du module, par une fonction de hachage
+//    parfaite minimale construite à l'écriture du fichier : la recherche
+//    d'une chaine ne demande qu'une lecture dans un petit tableau et une
+//    comparaison de chaines, sans allocation.
+
+#ifndef VOCAB__H
+#define VOCAB__H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+//  Fonctionnement général :
+//  - un vocabulaire commence par un en-tête de taille fixe, suivi d'un tableau
+//      de pilotes, un par groupe de chaines, d'un tableau donnant la position
+//      dans la réserve de la chaine de chaque identifiant, puis de la réserve
+//      des chaines, terminées par le caractère nul ;
+//  - l'identifiant d'une chaine est obtenu à partir de sa valeur de hachage,
+//      qui désigne son groupe, en la hachant de nouveau avec le pilote de ce
+//      groupe. Les pilotes sont choisis à l'écriture de sorte que deux
+//      chaines du vocabulaire n'aient jamais le même identifiant. Le
+//      vocabulaire doit être consulté avec la fonction de hachage qui a servi
+//      à l'écrire ;
+//  - les entiers sont écrits dans la représentation de la machine : un
+//      vocabulaire écrit sur une machine dont les entiers ont un autre
+//      boutisme est refusé ;
+//  - les fonctions qui peuvent échouer renvoient 1 en cas de dépassement de
+//      capacité, 2 en cas d'erreur d'entrée-sortie et 3 si le fichier n'est pas
+//      un vocabulaire valide.
+
+//  struct vocab, vocab : type et nom de type d'un contrôleur regroupant les
+//    informations permettant d'accéder à un vocabulaire projeté en mémoire.
+typedef struct vocab vocab;
+
+//  vocab_open : tente d'ouvrir et de projeter en mémoire le vocabulaire de
+//    chemin path, puis d'en vérifier la cohérence. Renvoie NULL en cas
+//    d'échec, le code d'erreur étant affecté à *error. Renvoie sinon un
+//    pointeur vers le contrôleur associé.
+extern vocab *vocab_open(const char *path, int *error);
+
+//  vocab_dispose : sans effet si *v vaut NULL. Libère sinon les ressources
+//    allouées à la gestion du vocabulaire associé à *v, dont sa projection,
+//    puis affecte NULL à *v.
+extern void vocab_dispose(vocab **v);
+
+//  vocab_size : renvoie le nombre de chaines du vocabulaire associé à v.
+extern size_t vocab_size(const vocab *v);
+
+//  vocab_word : renvoie la chaine d'identifiant id du vocabulaire associé à v,
+//    id étant supposé strictement inférieur à vocab_size(v).
+extern const char *vocab_word(const vocab *v, size_t id);
+
+//  vocab_position : renvoie l'identifiant de la seule chaine du vocabulaire
+//    associé à v qui peut avoir h pour valeur de hachage. Il reste à comparer
+//    cette chaine à celle recherchée. Le vocabulaire est supposé non vide.
+extern size_t vocab_position(const vocab *v, uint64_t h);
+
+//  vocab_write : écrit dans le fichier de chemin path le vocabulaire formé des
+//    n chaines pointées par word[0], ..., word[n - 1], supposées deux à deux
+//    distinctes, de valeurs de hachage données par hash. Une chaine dont la
+//    valeur de hachage est celle d'une chaine précédente n'est pas retenue.
+//    Le fichier est écrit à côté sous un nom temporaire puis renommé, si bien
+//    qu'un vocabulaire existant de même chemin n'est remplacé qu'en cas de
+//    succès. Renvoie 0 en cas de succès, 1 en cas de dépassement de capacité,
+//    2 en cas d'erreur d'écriture.
+extern int vocab_write(const char *path, const char * const *word, size_t n,
+    uint64_t (*hash)(const char *s));
+
+#endif
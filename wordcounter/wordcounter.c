@@ -1,10 +1,15 @@
 #include "wordcounter.h"
 
 #include <ctype.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <string.h>
-#include "hashtable.h"
-#include "holdall.h"
+#include "hashtable_ext.h"
+#include "holdall_ext.h"
+#include "psort.h"
+#include "steal.h"
 
 //  Les directives ci-dessous assurent l'inégalité :
 //    UNDEFINED_CHANNEL < MULTI_CHANNEL < START_CHANNEL
@@ -14,69 +19,317 @@
 
 //  Structures -----------------------------------------------------------------
 
+//  struct fpset, fpset : ensemble d'empreintes de 64 bits, implanté par un
+//    tableau à adressage ouvert et sondage linéaire dont la longueur est une
+//    puissance de 2. La valeur 0 marque un emplacement libre ; une empreinte
+//    nulle est donc remplacée par 1. Le tableau n'est alloué, à l'aide de
+//    l'allocateur al, qu'à la première insertion (fps vaut alors NULL et
+//    lbsize 0).
+typedef struct fpset fpset;
+
+struct fpset {
+  uint64_t *fps;
+  size_t lbsize;
+  size_t count;
+  const allocator *al;
+};
+
+//  struct wordcounter : le composant reclaim indique si le mode récupération
+//    est actif (voir wc_set_reclaim). nmulti est le nombre de mots de canal
+//    multiple encore présents dans counter et ha_word, et multi l'ensemble des
+//    empreintes des mots de canal multiple qui en ont été retirés ; fp_check
+//    indique si des empreintes y ont été ajoutées depuis l'extérieur, auquel
+//    cas des mots présents dans counter peuvent y figurer. Les composants
+//    overflow et overflow_context mémorisent le gestionnaire de dépassement de
+//    capacité (voir wc_set_overflow). Le composant al mémorise l'allocateur
+//    auquel sont confiées toutes les allocations du compteur de mots, de sa
+//    table et de son fourretout. order est la fonction de comparaison du
+//    dernier tri, NULL si des mots ont été ajoutés depuis, et threads le
+//    nombre de fils d'exécution du tri (voir wc_set_threads). limit est la
+//    limite de sélection (voir wc_set_limit) ; visible est le nombre de mots
+//    parcourus par wc_apply et ses variantes, SIZE_MAX s'ils le sont tous.
+//    vocab est le vocabulaire associé (voir wc_set_vocab), NULL s'il n'y en a
+//    pas ; les blocs du tableau vblock contiennent alors le compteur de
+//    chacun de ses mots, rangé selon son identifiant (voir wc__vocab_search).
+//    ngram est la longueur des suites de mots comptées (voir wc_set_ngram).
+//    shared est le compteur de mots filtré dont les mots sont les seuls
+//    comptés par w (voir wc_share_filter), NULL s'il n'y en a pas.
 struct wordcounter {
+  const allocator *al;
   hashtable *counter;
   holdall *ha_word;
   bool filtered;
+  bool reclaim;
+  size_t nmulti;
+  fpset multi;
+  bool fp_check;
+  int (*overflow)(void *context, wordcounter *w);
+  void *overflow_context;
+  int (*order)(const word **, const word **);
+  size_t threads;
+  size_t limit;
+  size_t visible;
+  const vocab *vocab;
+  word **vblock;
+  size_t ngram;
+  const wordcounter *shared;
+};
+
+//  WORD__INLINE_LEN : longueur maximale des mots dont la chaine est stockée
+//    directement dans la clé de leur compteur. Les mots plus longs sont
+//    stockés dans une zone allouée à part.
+#define WORD__INLINE_LEN 15
+
+//  struct wkey, wkey : clé d'un compteur, qui est aussi la clé de recherche
+//    dans la table de hachage. Le composant len mémorise la longueur du mot.
+//    Si len est inférieure ou égale à WORD__INLINE_LEN, le mot est stocké dans
+//    inl, complété par des caractères nuls, si bien que deux telles clés sont
+//    égales si et seulement si leurs composants q le sont. Sinon, le mot est
+//    repéré par ext.
+typedef struct wkey wkey;
+
+struct wkey {
+  union {
+    char inl[WORD__INLINE_LEN + 1];
+    uint64_t q[2];
+    char *ext;
+  };
+  size_t len;
 };
 
+#if WORD__INLINE_LEN + 1 != 2 * 8
+#error Invalid choice for WORD__INLINE_LEN.
+#endif
+
+#define WKEY__IS_INLINE(k) ((k)->len <= WORD__INLINE_LEN)
+
+//  struct word : la clé key est le premier composant, si bien qu'un pointeur
+//    vers un compteur est aussi un pointeur vers sa clé.
 struct word {
-  char *wordstr;
+  wkey key;
   long unsigned int count;
   int channel;
 };
 
-//  Fonction de hashage pour la hashmap ----------------------------------------
+//  Fonctions pour wkey --------------------------------------------------------
 
-size_t str_hashfun(const char *s) {
-  size_t h = 0;
-  for (const unsigned char *p = (const unsigned char *) s; *p != '\0'; ++p) {
-    h = 37 * h + *p;
+//  wkey__from : initialise la clé de recherche *k associée à la chaine pointée
+//    par s. Si le mot est long, *k repère s, qui ne doit alors pas être
+//    modifiée tant que *k est utilisée.
+static void wkey__from(wkey *k, const char *s) {
+  k->len = strlen(s);
+  if (WKEY__IS_INLINE(k)) {
+    k->q[0] = 0;
+    k->q[1] = 0;
+    memcpy(k->inl, s, k->len);
+  } else {
+    k->ext = (char *) s;
+  }
+}
+
+//  wkey__str : renvoie la chaine du mot de la clé pointée par k.
+static char *wkey__str(const wkey *k) {
+  return WKEY__IS_INLINE(k) ? (char *) k->inl : k->ext;
+}
+
+//  wkey__compare : renvoie zéro si les clés pointées par k1 et k2 sont
+//    associées au même mot, une valeur non nulle sinon.
+static int wkey__compare(const wkey *k1, const wkey *k2) {
+  if (k1->len != k2->len) {
+    return 1;
+  }
+  if (WKEY__IS_INLINE(k1)) {
+    return (k1->q[0] != k2->q[0]) | (k1->q[1] != k2->q[1]);
+  }
+  return memcmp(k1->ext, k2->ext, k1->len);
+}
+
+//  MIX64 : brassage final qui répartit les bits de poids fort de x sur ceux de
+//    poids faible.
+#define MIX64(x)                                                               \
+  ((x) ^= (x) >> 33, (x) *= 0xff51afd7ed558ccdULL,                             \
+  (x) ^= (x) >> 33, (x) *= 0xc4ceb9fe1a85ec53ULL,                              \
+  (x) ^= (x) >> 33)
+
+//  WKEY__POLY_BASE : base du hachage polynomial des mots longs.
+#define WKEY__POLY_BASE 0xbf58476d1ce4e5b9ULL
+
+//  wkey__hash : renvoie une valeur de hachage de 64 bits de la clé pointée par
+//    k. Pour un mot court, elle est calculée à partir des deux mots de 64 bits
+//    de inl. Pour un mot long, elle est obtenue par brassage de la valeur
+//    modulo 2^64 du polynôme en WKEY__POLY_BASE dont les coefficients sont ses
+//    caractères, du premier, de plus haut degré, au dernier. La valeur du
+//    polynôme d'une chaine formée de deux parties se déduit ainsi de celles de
+//    ses parties (voir wc__ngram_apply).
+static uint64_t wkey__hash(const wkey *k) {
+  uint64_t h;
+  if (WKEY__IS_INLINE(k)) {
+    h = k->q[0] ^ (k->q[1] * 0x9e3779b97f4a7c15ULL);
+  } else {
+    h = 0;
+    const unsigned char *p = (const unsigned char *) k->ext;
+    for (size_t i = 0; i < k->len; ++i) {
+      h = h * WKEY__POLY_BASE + p[i];
+    }
   }
+  MIX64(h);
   return h;
 }
 
+//  wkey__hashfun : fonction de pré-hachage pour la table de hachage.
+static size_t wkey__hashfun(const wkey *k) {
+  return (size_t) wkey__hash(k);
+}
+
+//  WKEY__FINGERPRINT : empreinte de 64 bits, jamais nulle, du mot de valeur de
+//    hachage h.
+#define WKEY__FINGERPRINT(h) ((h) == 0 ? 1 : (h))
+
+//  wkey__fingerprint : renvoie l'empreinte de 64 bits du mot de la clé pointée
+//    par k.
+static uint64_t wkey__fingerprint(const wkey *k) {
+  uint64_t h = wkey__hash(k);
+  return WKEY__FINGERPRINT(h);
+}
+
+//  Fonctions auxiliaires pour fpset -------------------------------------------
+
+//  FPSET__LBSIZE_MIN : logarithme binaire de la longueur initiale du tableau
+//    d'un ensemble d'empreintes. Le tableau est doublé dès que le nombre
+//    d'empreintes dépasse la moitié de sa longueur.
+#define FPSET__LBSIZE_MIN 10
+
+#define FPSET__MASK(set) (((size_t) 1 << (set)->lbsize) - 1)
+
+//  fpset__init, fpset__dispose : initialise un ensemble vide dont le tableau
+//    sera alloué à l'aide de l'allocateur pointé par al, libère les ressources
+//    allouées à l'ensemble pointé par set.
+static void fpset__init(fpset *set, const allocator *al) {
+  set->fps = NULL;
+  set->lbsize = 0;
+  set->count = 0;
+  set->al = al;
+}
+
+static void fpset__dispose(fpset *set) {
+  if (set->lbsize != 0) {
+    allocator_release(set->al, set->fps, (FPSET__MASK(set) + 1)
+        * sizeof *set->fps);
+  }
+  fpset__init(set, set->al);
+}
+
+//  fpset__slot : renvoie l'adresse de l'emplacement du tableau de l'ensemble
+//    pointé par set qui contient fp, ou à défaut du premier emplacement libre
+//    rencontré en sondant depuis la position de fp. Le tableau est supposé
+//    alloué et non plein.
+static uint64_t *fpset__slot(const fpset *set, uint64_t fp) {
+  size_t mask = FPSET__MASK(set);
+  size_t k = (size_t) fp & mask;
+  while (set->fps[k] != 0 && set->fps[k] != fp) {
+    k = (k + 1) & mask;
+  }
+  return &set->fps[k];
+}
+
+//  fpset__contains : renvoie true si fp appartient à l'ensemble pointé par
+//    set, false sinon.
+static bool fpset__contains(const fpset *set, uint64_t fp) {
+  return set->count != 0 && *fpset__slot(set, fp) == fp;
+}
+
+//  fpset__enlarge : alloue ou double le tableau de l'ensemble pointé par set.
+//    Renvoie une valeur non nulle en cas de dépassement de capacité, et
+//    l'ensemble reste inchangé. Renvoie sinon zéro.
+static int fpset__enlarge(fpset *set) {
+  size_t lbm = set->lbsize == 0 ? FPSET__LBSIZE_MIN : set->lbsize + 1;
+  if (lbm >= sizeof(size_t) * CHAR_BIT
+      || ((size_t) 1 << lbm) > SIZE_MAX / sizeof *set->fps) {
+    return -1;
+  }
+  size_t m = (size_t) 1 << lbm;
+  uint64_t *a = allocator_alloc(set->al, m * sizeof *a);
+  if (a == NULL) {
+    return -1;
+  }
+  for (size_t k = 0; k < m; ++k) {
+    a[k] = 0;
+  }
+  fpset old = *set;
+  set->fps = a;
+  set->lbsize = lbm;
+  for (size_t k = 0; old.lbsize != 0 && k <= FPSET__MASK(&old); ++k) {
+    if (old.fps[k] != 0) {
+      *fpset__slot(set, old.fps[k]) = old.fps[k];
+    }
+  }
+  fpset__dispose(&old);
+  return 0;
+}
+
+//  fpset__add : tente d'ajouter fp à l'ensemble pointé par set. Renvoie une
+//    valeur non nulle en cas de dépassement de capacité. Renvoie sinon zéro.
+static int fpset__add(fpset *set, uint64_t fp) {
+  if ((set->lbsize == 0 || set->count + 1 > FPSET__MASK(set) / 2 + 1)
+      && fpset__enlarge(set) != 0) {
+    return -1;
+  }
+  uint64_t *slot = fpset__slot(set, fp);
+  if (*slot == 0) {
+    *slot = fp;
+    ++set->count;
+  }
+  return 0;
+}
+
 // Fonctions auxiliaires pour word ---------------------------------------------
 
 //  word__from : tente d'allouer les ressources nécessaire à un nouveau compteur
-//    dont le mot est s, le canal channel, et la valeur du compteur est 1.
-//    Renvoie NULL en cas de dépassement de capacité, renvoie sinon le compteur
+//    dont le mot est celui de la clé pointée par k, le canal channel, et la
+//    valeur du compteur est 1, à l'aide de l'allocateur pointé par al. Renvoie
+//    NULL en cas de dépassement de capacité, renvoie sinon le compteur
 //    nouvellement créé.
-static word *word__from(const char *s, int channel) {
-  word *w = malloc(sizeof *w);
+static word *word__from(const wkey *k, int channel, const allocator *al) {
+  word *w = allocator_alloc(al, sizeof *w);
   if (w == NULL) {
     return NULL;
   }
-  char *t = malloc(strlen(s) + 1);
-  if (t == NULL) {
-    free(w);
-    return NULL;
+  w->key = *k;
+  if (!WKEY__IS_INLINE(k)) {
+    char *t = allocator_alloc(al, k->len + 1);
+    if (t == NULL) {
+      allocator_release(al, w, sizeof *w);
+      return NULL;
+    }
+    memcpy(t, k->ext, k->len + 1);
+    w->key.ext = t;
   }
-  strcpy(t, s);
-  w->wordstr = t;
   w->count = 1;
   w->channel = channel;
   return w;
 }
 
-//  word__dispose_content : Libère les ressources associées au compteur w,
-//    sans affecté w à NULL, qui pointe donc désormais sur une zone non
-//    allouée.
-static void word__dispose_content(word *w) {
-  free(w->wordstr);
-  free(w);
+//  word__dispose_content : Libère les ressources associées au compteur w, qui
+//    ont été allouées à l'aide de l'allocateur pointé par al, sans affecté w à
+//    NULL, qui pointe donc désormais sur une zone non allouée.
+static void word__dispose_content(word *w, const allocator *al) {
+  if (!WKEY__IS_INLINE(&w->key)) {
+    allocator_release(al, w->key.ext, w->key.len + 1);
+  }
+  allocator_release(al, w, sizeof *w);
 }
 
-//  rword__dispose_content : similaire à word__dispose_content mais renvoie 0.
-static int rword__dispose_content(word *w) {
-  word__dispose_content(w);
-  return 0;
+//  word__dispose_drop : similaire à word__dispose_content mais renvoie false,
+//    pour holdall_filter_context.
+static bool word__dispose_drop(const allocator *al, word *w) {
+  word__dispose_content(w, al);
+  return false;
 }
 
 //  Fonctions pour word --------------------------------------------------------
 
 char *word_str(const word *w) {
-  return w->wordstr;
+  return wkey__str(&w->key);
 }
 
 long unsigned int word_count(const word *w) {
@@ -91,20 +344,25 @@ int word_channel(const word *w) {
 
 //  wc__create_counter : tente d'allouer les ressources nécessaire pour un
 //    nouveau compteur, initialisé à 1 occurence du mot, qui sera ajouté dans w.
-//    Il est supposé que w ne contient pas de compteur pour le mot s. Renvoie
-//    NULL en cas de dépassement de capacité, sinon renvoie un pointeur vers
-//    le nouveau compteur.
-static word *wc__create_counter(wordcounter *w, const char *s, int channel) {
-  word *p = word__from(s, channel);
+//    Il est supposé que w ne contient pas de compteur pour le mot de la clé
+//    pointée par k. Renvoie NULL en cas de dépassement de capacité, sinon
+//    renvoie un pointeur vers le nouveau compteur.
+static word *wc__create_counter(wordcounter *w, const wkey *k, int channel) {
+  word *p = word__from(k, channel, w->al);
   if (p == NULL) {
     return NULL;
   }
-  if (holdall_put(w->ha_word, p) != 0
-      || hashtable_add(w->counter, p->wordstr, p) == NULL) { // peut etre
-                                                             // probleme
-    word__dispose_content(p);
+  if (hashtable_add(w->counter, &p->key, p) == NULL) {
+    word__dispose_content(p, w->al);
     return NULL;
   }
+  if (holdall_put(w->ha_word, p) != 0) {
+    hashtable_remove(w->counter, &p->key);
+    word__dispose_content(p, w->al);
+    return NULL;
+  }
+  w->order = NULL;
+  w->visible = SIZE_MAX;
   return p;
 }
 
@@ -113,7 +371,9 @@ static word *wc__create_counter(wordcounter *w, const char *s, int channel) {
 //    cas de dépassement de capacité, sinon 0.
 static int wc__create_empty_counter(wordcounter *w, const char *s,
     int channel) {
-  word *p = wc__create_counter(w, s, channel);
+  wkey k;
+  wkey__from(&k, s);
+  word *p = wc__create_counter(w, &k, channel);
   if (p == NULL) {
     return 1;
   }
@@ -121,11 +381,799 @@ static int wc__create_empty_counter(wordcounter *w, const char *s,
   return 0;
 }
 
-//  wc_sort : Tri le compteur de mot w, ce qui modifiera l'ordre d'appel des
-//    fonctions avec wc_apply par exemple.
-static void wc__sort(wordcounter *w, int (*compare)(const word **,
-    const word **)) {
-  holdall_sort(w->ha_word, (int (*)(const void *, const void *))compare);
+//  WC__RECLAIM_MIN : nombre minimal de mots de canal multiple présents dans un
+//    compteur de mots en mode récupération à partir duquel ils sont retirés
+//    dès qu'ils sont plus nombreux que les autres mots.
+#define WC__RECLAIM_MIN 1024
+
+//  wc__reclaim_keep : sert pour wc__reclaim. Si le canal du compteur p n'est
+//    pas multiple, renvoie true, sauf si fp_check vaut true et que l'empreinte
+//    du mot de p figure parmi celles de w. Si le canal est multiple, tente
+//    d'ajouter l'empreinte du mot de p à celles de w et renvoie true en cas de
+//    dépassement de capacité. Dans les autres cas, retire p de la table de w,
+//    libère les ressources qui lui sont associées et renvoie false.
+static bool wc__reclaim_keep(wordcounter *w, word *p) {
+  if (p->channel != MULTI_CHANNEL) {
+    if (!w->fp_check
+        || !fpset__contains(&w->multi, wkey__fingerprint(&p->key))) {
+      return true;
+    }
+  } else if (fpset__add(&w->multi, wkey__fingerprint(&p->key)) != 0) {
+    return true;
+  }
+  hashtable_remove(w->counter, &p->key);
+  word__dispose_content(p, w->al);
+  return false;
+}
+
+//  wc__reclaim : sans effet si w n'est pas en mode récupération. Retire sinon
+//    de w les compteurs dont le canal est multiple, en ne conservant que
+//    l'empreinte de leur mot, ainsi que ceux dont l'empreinte a été ajoutée par
+//    wc_add_multi_fingerprint.
+static void wc__reclaim(wordcounter *w) {
+  if (!w->reclaim || (w->nmulti == 0 && !w->fp_check)) {
+    return;
+  }
+  holdall_filter_context(w->ha_word, w,
+      (bool (*)(void *, void *))wc__reclaim_keep);
+  w->nmulti = 0;
+  w->fp_check = false;
+}
+
+//  wc__multi_found : signale à w que le canal d'un de ses compteurs vient de
+//    devenir multiple. En mode récupération, déclenche wc__reclaim dès que les
+//    compteurs de canal multiple sont au nombre d'au moins WC__RECLAIM_MIN et
+//    majoritaires.
+static void wc__multi_found(wordcounter *w) {
+  ++w->nmulti;
+  if (w->reclaim && w->nmulti >= WC__RECLAIM_MIN
+      && w->nmulti > holdall_count(w->ha_word) - w->nmulti) {
+    wc__reclaim(w);
+  }
+}
+
+//  wc__update_channel : met à jour, selon les règles de wc_addcount, le canal
+//    du compteur p de w lorsque son mot est rencontré dans le canal channel.
+static void wc__update_channel(wordcounter *w, word *p, int channel) {
+  if (p->channel == channel || p->channel == MULTI_CHANNEL) {
+    return;
+  }
+  p->channel = p->channel == UNDEFINED_CHANNEL ? channel : MULTI_CHANNEL;
+  if (p->channel == MULTI_CHANNEL) {
+    wc__multi_found(w);
+  }
+}
+
+//  wc__addstate : similaire à wc_addstate, pour le mot de clé pointée par k.
+static int wc__addstate(wordcounter *w, const wkey *k, int channel,
+    long unsigned int count) {
+  word *p = hashtable_search(w->counter, k);
+  if (p != NULL) {
+    p->count += count;
+    if (channel != UNDEFINED_CHANNEL) {
+      wc__update_channel(w, p, channel);
+    }
+    return 0;
+  }
+  if (w->filtered || (w->multi.count != 0
+      && fpset__contains(&w->multi, wkey__fingerprint(k)))
+      || (w->shared != NULL
+      && hashtable_search(w->shared->counter, k) == NULL)) {
+    return 0;
+  }
+  p = wc__create_counter(w, k, channel);
+  if (p == NULL) {
+    return 1;
+  }
+  p->count = count;
+  if (channel == MULTI_CHANNEL) {
+    wc__multi_found(w);
+  }
+  return 0;
+}
+
+//  WC__VBLOCK_LEN : nombre de compteurs denses par bloc. Un vocabulaire de n
+//    mots occupe n / WC__VBLOCK_LEN blocs pleins, suivis d'un bloc partiel
+//    s'il reste des mots. Doit être une puissance de 2.
+#define WC__VBLOCK_LEN 4096
+
+//  WC__VBLOCK_COUNT : nombre de blocs du vocabulaire de n mots.
+#define WC__VBLOCK_COUNT(n) (((n) + WC__VBLOCK_LEN - 1) / WC__VBLOCK_LEN)
+
+//  wc__vblock_len : renvoie le nombre de compteurs du bloc de rang k du
+//    vocabulaire de n mots.
+static size_t wc__vblock_len(size_t n, size_t k) {
+  return n - k * WC__VBLOCK_LEN < WC__VBLOCK_LEN
+      ? n - k * WC__VBLOCK_LEN : WC__VBLOCK_LEN;
+}
+
+//  wc__vocab_search : renvoie un pointeur vers le compteur dense du mot de la
+//    clé pointée par k, d'empreinte fp, si ce mot appartient au vocabulaire de
+//    w, supposé exister, NULL sinon. Le compteur du mot d'identifiant id est
+//    rangé à l'indice id % WC__VBLOCK_LEN du bloc de rang id / WC__VBLOCK_LEN.
+static inline word *wc__vocab_search(wordcounter *w, const wkey *k,
+    uint64_t fp) {
+  size_t id = vocab_position(w->vocab, fp);
+  word *p = &w->vblock[id / WC__VBLOCK_LEN][id % WC__VBLOCK_LEN];
+  return wkey__compare(&p->key, k) == 0 ? p : NULL;
+}
+
+//  wc__vocab_update : ajoute count au compteur dense p et met à jour son canal
+//    selon les règles de wc_addcount lorsque son mot est rencontré dans le
+//    canal channel, supposé défini.
+static inline void wc__vocab_update(word *p, int channel,
+    long unsigned int count) {
+  p->count += count;
+  if (p->channel != channel && p->channel != MULTI_CHANNEL) {
+    p->channel = p->channel == UNDEFINED_CHANNEL ? channel : MULTI_CHANNEL;
+  }
+}
+
+//  wc__vblocks_release : libère, à l'aide de l'allocateur al, les blocs non
+//    NULL du tableau vblock des compteurs denses d'un vocabulaire de n mots,
+//    puis le tableau lui-même.
+static void wc__vblocks_release(const allocator *al, word **vblock,
+    size_t n) {
+  for (size_t k = 0; k < WC__VBLOCK_COUNT(n); ++k) {
+    allocator_release(al, vblock[k], wc__vblock_len(n, k) * sizeof(word));
+  }
+  allocator_release(al, vblock, WC__VBLOCK_COUNT(n) * sizeof *vblock);
+}
+
+//  wc__vocab_release : libère les blocs des compteurs denses de w et dissocie
+//    son vocabulaire.
+static void wc__vocab_release(wordcounter *w) {
+  wc__vblocks_release(w->al, w->vblock, vocab_size(w->vocab));
+  w->vocab = NULL;
+  w->vblock = NULL;
+}
+
+//  wc__addcount : similaire à wc_addcount, pour le mot de la clé pointée par k
+//    et de valeur de hachage h (voir wkey__hash), qui n'est pas recalculée
+//    tant que le mot a déjà un compteur. Si la clé repère sa chaine, celle-ci
+//    n'est copiée qu'à la création du compteur.
+static int wc__addcount(wordcounter *w, const wkey *k, uint64_t h,
+    int channel) {
+  word *p;
+  if (w->vocab != NULL
+      && (p = wc__vocab_search(w, k, WKEY__FINGERPRINT(h))) != NULL) {
+    wc__vocab_update(p, channel, 1);
+    return 0;
+  }
+  p = hashtable_search_hashed(w->counter, k, (size_t) h);
+  if (p != NULL) {
+    ++p->count;
+    wc__update_channel(w, p, channel);
+    return 0;
+  }
+  if (w->filtered || (w->multi.count != 0
+      && fpset__contains(&w->multi, WKEY__FINGERPRINT(h)))
+      || (w->shared != NULL
+      && hashtable_search_hashed(w->shared->counter, k, (size_t) h) == NULL)) {
+    return 0;
+  }
+  while (wc__create_counter(w, k, channel) == NULL) {
+    if (w->overflow == NULL || w->overflow(w->overflow_context, w) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//  wc__add_filtered : ajoute au filtre de w, supposé filtré, le mot de la clé
+//    pointée par k et de valeur de hachage h, avec le canal channel, s'il n'y
+//    figure pas déjà. Renvoie 1 en cas de dépassement de capacité, sinon 0.
+static int wc__add_filtered(wordcounter *w, const wkey *k, uint64_t h,
+    int channel) {
+  if (hashtable_search_hashed(w->counter, k, (size_t) h) != NULL) {
+    return 0;
+  }
+  word *p = wc__create_counter(w, k, channel);
+  if (p == NULL) {
+    return 1;
+  }
+  p->count = 0;
+  return 0;
+}
+
+//  struct wc__xkey, wc__xkey : clé de tri du compteur w, de valeur count. Les
+//    len premiers octets de key sont la chaine du mot si la collation est
+//    celle des locales "C" et "POSIX", le résultat de sa transformation par
+//    strxfrm sinon, si bien que deux clés comparées par memcmp sont rangées
+//    comme les chaines comparées par strcoll.
+typedef struct wc__xkey wc__xkey;
+
+struct wc__xkey {
+  const char *key;
+  size_t len;
+  long unsigned int count;
+  word *w;
+};
+
+//  struct wc__order, wc__order : ordre de tri des compteurs. compare est la
+//    fonction de comparaison de référence, fondée sur strcoll, et bytes une
+//    fonction équivalente lorsque la collation est celle des locales "C" et
+//    "POSIX", qui compare les chaines octet par octet. count indique que les
+//    compteurs sont rangés d'abord selon leur valeur, puis selon l'ordre
+//    lexicographique croissant de leurs mots ; ils sont sinon rangés selon ce
+//    seul ordre lexicographique. reverse indique que le premier critère est
+//    décroissant.
+typedef struct wc__order wc__order;
+
+struct wc__order {
+  int (*compare)(const word **, const word **);
+  int (*bytes)(const word **, const word **);
+  bool count;
+  bool reverse;
+};
+
+//  struct wc__xrange, wc__xrange : plage des références d'indices lo à hi - 1
+//    dont les clés de tri ont en commun leurs depth premiers octets.
+typedef struct wc__xrange wc__xrange;
+
+struct wc__xrange {
+  size_t lo;
+  size_t hi;
+  size_t depth;
+};
+
+//  WC__XKEY_CHUNK : nombre de compteurs dont les clés de tri sont calculées
+//    par une même tâche.
+#define WC__XKEY_CHUNK 4096
+
+//  WC__XBLOCK_SIZE : capacité minimale en octets d'un bloc de clés de tri.
+#define WC__XBLOCK_SIZE 65536
+
+//  WC__RADIX_MIN : nombre de références en deçà duquel une plage est triée par
+//    insertion plutôt que par répartition.
+#define WC__RADIX_MIN 32
+
+//  WC__RADIX_DEPTH : profondeur, en octets, au-delà de laquelle une plage est
+//    triée par qsort plutôt que par répartition, ce qui borne la profondeur de
+//    la récursion.
+#define WC__RADIX_DEPTH 64
+
+//  WC__RADIX_BUCKETS : nombre de seaux d'une répartition selon un octet, le
+//    seau 0 recevant les clés trop courtes pour avoir cet octet.
+#define WC__RADIX_BUCKETS (UCHAR_MAX + 2)
+
+//  struct wc__xblock, wc__xblock : bloc de clés de tri, chainé au bloc next.
+//    Les used premiers octets du tableau data de longueur size sont occupés.
+typedef struct wc__xblock wc__xblock;
+
+struct wc__xblock {
+  wc__xblock *next;
+  size_t size;
+  size_t used;
+  char data[];
+};
+
+//  struct wc__ksort : sert pour wc__sort. Mémorise l'allocateur al, l'ordre de
+//    tri order, le nombre de fils d'exécution threads du tri et si les clés
+//    doivent être transformées par strxfrm (transform). Durant le tri, refs
+//    est le tableau des n références à trier, xkeys celui des clés, xrefs
+//    celui des références aux clés, tmp un tableau auxiliaire de même
+//    longueur, block celui des listes de blocs de chaque tâche de calcul des
+//    clés et range celui des plages restant à trier. failed indique qu'une
+//    allocation a échoué. Si limit ne vaut pas 0, seuls les limit premiers
+//    mots exclusifs sont sélectionnés puis triés ; leur nombre est affecté à
+//    selected.
+struct wc__ksort {
+  const allocator *al;
+  const wc__order *order;
+  size_t threads;
+  bool transform;
+  size_t limit;
+  size_t selected;
+  void **refs;
+  size_t n;
+  wc__xkey *xkeys;
+  wc__xkey **xrefs;
+  wc__xkey **tmp;
+  wc__xblock **block;
+  wc__xrange *range;
+  atomic_bool failed;
+};
+
+//  wc__collate_bytes : renvoie true si la collation courante est celle des
+//    locales "C" et "POSIX", auquel cas strcoll équivaut à strcmp, false sinon.
+static bool wc__collate_bytes(void) {
+  const char *name = setlocale(LC_COLLATE, NULL);
+  return name != NULL
+    && (strcmp(name, "C") == 0 || strcmp(name, "POSIX") == 0);
+}
+
+//  wc__xkey_compare : compare les clés de tri pointées par x1 et x2 à l'aide
+//    de memcmp, une clé qui est le préfixe strict de l'autre étant inférieure.
+static int wc__xkey_compare(const wc__xkey *x1, const wc__xkey *x2) {
+  int r = memcmp(x1->key, x2->key, x1->len < x2->len ? x1->len : x2->len);
+  return r != 0 ? r : (x1->len > x2->len) - (x1->len < x2->len);
+}
+
+//  wc__xkey_compare_refs : sert pour wc__radix, via qsort. Compare les clés de
+//    tri **x1ptr et **x2ptr à l'aide de wc__xkey_compare.
+static int wc__xkey_compare_refs(const wc__xkey **x1ptr,
+    const wc__xkey **x2ptr) {
+  return wc__xkey_compare(*x1ptr, *x2ptr);
+}
+
+//  wc__xkey_digit : renvoie le numéro du seau de la clé de tri pointée par x
+//    pour une répartition selon l'octet d'indice d.
+static inline size_t wc__xkey_digit(const wc__xkey *x, size_t d) {
+  return d < x->len ? (size_t) (unsigned char) x->key[d] + 1 : 0;
+}
+
+//  wc__radix_pass : répartit les n références du tableau a selon l'octet
+//    d'indice d de leurs clés de tri, à l'aide du tableau auxiliaire tmp de
+//    même longueur. Range dans count le nombre de références de chacun des
+//    WC__RADIX_BUCKETS seaux. Le tableau a est laissé inchangé si toutes les
+//    références tombent dans le même seau.
+static void wc__radix_pass(wc__xkey **a, wc__xkey **tmp, size_t n, size_t d,
+    size_t count[WC__RADIX_BUCKETS]) {
+  for (size_t b = 0; b < WC__RADIX_BUCKETS; ++b) {
+    count[b] = 0;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    ++count[wc__xkey_digit(a[i], d)];
+  }
+  if (count[wc__xkey_digit(a[0], d)] == n) {
+    return;
+  }
+  size_t pos[WC__RADIX_BUCKETS];
+  size_t sum = 0;
+  for (size_t b = 0; b < WC__RADIX_BUCKETS; ++b) {
+    pos[b] = sum;
+    sum += count[b];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    tmp[pos[wc__xkey_digit(a[i], d)]++] = a[i];
+  }
+  memcpy(a, tmp, n * sizeof *a);
+}
+
+//  wc__radix : trie selon wc__xkey_compare les n références du tableau a dont
+//    les clés de tri ont en commun leurs d premiers octets, à l'aide du
+//    tableau auxiliaire tmp de même longueur. Le tri est un tri par
+//    répartition des octets de poids fort vers ceux de poids faible, sauf
+//    pour les plages courtes, triées par insertion, et les plages profondes,
+//    triées par qsort.
+static void wc__radix(wc__xkey **a, wc__xkey **tmp, size_t n, size_t d) {
+  while (n >= WC__RADIX_MIN) {
+    if (d >= WC__RADIX_DEPTH) {
+      qsort(a, n, sizeof *a,
+          (int (*)(const void *, const void *))wc__xkey_compare_refs);
+      return;
+    }
+    size_t count[WC__RADIX_BUCKETS];
+    wc__radix_pass(a, tmp, n, d, count);
+    if (count[0] == n) {
+      return;
+    }
+    size_t b = wc__xkey_digit(a[0], d);
+    if (count[b] != n) {
+      size_t lo = count[0];
+      for (b = 1; b < WC__RADIX_BUCKETS; ++b) {
+        wc__radix(a + lo, tmp + lo, count[b], d + 1);
+        lo += count[b];
+      }
+      return;
+    }
+    ++d;
+  }
+  for (size_t i = 1; i < n; ++i) {
+    wc__xkey *x = a[i];
+    size_t j = i;
+    while (j > 0 && wc__xkey_compare(a[j - 1], x) > 0) {
+      a[j] = a[j - 1];
+      --j;
+    }
+    a[j] = x;
+  }
+}
+
+//  wc__count_radix : range de façon stable les n références du tableau a
+//    selon la valeur de leurs compteurs, croissante ou décroissante selon
+//    reverse, à l'aide du tableau auxiliaire tmp de même longueur. Le tri est
+//    un tri par répartition des octets de poids faible vers ceux de poids
+//    fort ; les octets communs à tous les compteurs sont ignorés.
+static void wc__count_radix(wc__xkey **a, wc__xkey **tmp, size_t n,
+    bool reverse) {
+  size_t count[sizeof(long unsigned int)][UCHAR_MAX + 1] = {
+    0
+  };
+  for (size_t i = 0; i < n; ++i) {
+    long unsigned int c = reverse ? ~a[i]->count : a[i]->count;
+    for (size_t p = 0; p < sizeof c; ++p) {
+      ++count[p][(c >> (p * CHAR_BIT)) & UCHAR_MAX];
+    }
+  }
+  wc__xkey **src = a;
+  wc__xkey **dst = tmp;
+  for (size_t p = 0; p < sizeof(long unsigned int); ++p) {
+    long unsigned int c0 = reverse ? ~src[0]->count : src[0]->count;
+    if (count[p][(c0 >> (p * CHAR_BIT)) & UCHAR_MAX] == n) {
+      continue;
+    }
+    size_t sum = 0;
+    for (size_t b = 0; b <= UCHAR_MAX; ++b) {
+      size_t k = count[p][b];
+      count[p][b] = sum;
+      sum += k;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      long unsigned int c = reverse ? ~src[i]->count : src[i]->count;
+      dst[count[p][(c >> (p * CHAR_BIT)) & UCHAR_MAX]++] = src[i];
+    }
+    wc__xkey **t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != a) {
+    memcpy(a, src, n * sizeof *a);
+  }
+}
+
+//  wc__xkey_chunk : sert pour wc__ksort_refs, éventuellement via steal_run.
+//    Calcule les clés de tri des compteurs de la tâche k. Les clés
+//    transformées sont rangées dans la liste de blocs ks->block[k]. Renvoie
+//    une valeur non nulle en cas de dépassement de capacité, 0 sinon.
+static int wc__xkey_chunk(struct wc__ksort *ks, size_t worker, size_t k) {
+  (void) worker;
+  size_t last = ks->n - k * WC__XKEY_CHUNK < WC__XKEY_CHUNK
+      ? ks->n : (k + 1) * WC__XKEY_CHUNK;
+  for (size_t i = k * WC__XKEY_CHUNK; i < last; ++i) {
+    word *w = ks->refs[i];
+    const char *s = word_str(w);
+    ks->xrefs[i] = &ks->xkeys[i];
+    if (!ks->transform) {
+      ks->xkeys[i] = (wc__xkey) {
+        .key = s, .len = w->key.len, .count = w->count, .w = w
+      };
+      continue;
+    }
+    if (atomic_load_explicit(&ks->failed, memory_order_relaxed)) {
+      return 1;
+    }
+    wc__xblock *b = ks->block[k];
+    size_t len = b == NULL ? strxfrm(NULL, s, 0)
+        : strxfrm(b->data + b->used, s, b->size - b->used);
+    if (b == NULL || len >= b->size - b->used) {
+      size_t size = len < WC__XBLOCK_SIZE ? WC__XBLOCK_SIZE : len + 1;
+      if (size > SIZE_MAX - sizeof *b) {
+        return 1;
+      }
+      b = allocator_alloc(ks->al, sizeof *b + size);
+      if (b == NULL) {
+        return 1;
+      }
+      b->next = ks->block[k];
+      b->size = size;
+      b->used = 0;
+      ks->block[k] = b;
+      strxfrm(b->data, s, size);
+    }
+    ks->xkeys[i] = (wc__xkey) {
+      .key = b->data + b->used, .len = len, .count = w->count, .w = w
+    };
+    b->used += len + 1;
+  }
+  return 0;
+}
+
+//  wc__xrange_sort : sert pour wc__ksort_refs, éventuellement via steal_run.
+//    Trie la plage ks->range[k] à l'aide de wc__radix. Renvoie 0.
+static int wc__xrange_sort(struct wc__ksort *ks, size_t worker, size_t k) {
+  (void) worker;
+  const wc__xrange *r = &ks->range[k];
+  wc__radix(ks->xrefs + r->lo, ks->tmp + r->lo, r->hi - r->lo, r->depth);
+  return 0;
+}
+
+//  wc__ksort_run : exécute les ntasks tâches fun(ks, 0, k) à l'aide de
+//    steal_run si ks->threads est supérieur à 1, en séquence sinon ou si
+//    aucun fil n'a pu être démarré. Renvoie une valeur non nulle si l'une
+//    d'elles a échoué, 0 sinon.
+static int wc__ksort_run(struct wc__ksort *ks, size_t ntasks,
+    int (*fun)(struct wc__ksort *, size_t, size_t)) {
+  int r = -1;
+  if (ks->threads > 1 && ntasks > 1) {
+    r = steal_run(ks->threads < ntasks ? ks->threads : ntasks, ntasks, ks,
+        (int (*)(void *, size_t, size_t))fun);
+  }
+  for (size_t k = 0; r == -1 && k < ntasks; ++k) {
+    if (fun(ks, 0, k) != 0) {
+      r = 1;
+    }
+  }
+  return r == -1 ? 0 : r;
+}
+
+//  wc__ksort_ranges : sert pour wc__ksort_refs. Le tableau ks->xrefs étant
+//    rangé selon le premier critère de l'ordre de tri, découpe ses plages de
+//    références qui restent à trier par leurs clés, les range dans ks->range
+//    et renvoie leur nombre. Pour un ordre selon les valeurs des compteurs,
+//    il s'agit des plages de compteurs de même valeur ; sinon, ks->xrefs est
+//    d'abord réparti selon le premier octet des clés, chaque seau formant une
+//    plage. Renvoie (size_t) -1 en cas de dépassement de capacité.
+static size_t wc__ksort_ranges(struct wc__ksort *ks) {
+  size_t n = ks->n;
+  size_t nrange = 0;
+  size_t count[WC__RADIX_BUCKETS];
+  if (ks->order->count) {
+    for (size_t i = 0, j; i < n; i = j) {
+      for (j = i + 1; j < n && ks->xrefs[j]->count == ks->xrefs[i]->count;
+          ++j) {
+      }
+      nrange += j - i > 1;
+    }
+  } else {
+    wc__radix_pass(ks->xrefs, ks->tmp, n, 0, count);
+    for (size_t b = 1; b < WC__RADIX_BUCKETS; ++b) {
+      nrange += count[b] > 1;
+    }
+  }
+  if (nrange == 0) {
+    return 0;
+  }
+  ks->range = allocator_alloc(ks->al, nrange * sizeof *ks->range);
+  if (ks->range == NULL) {
+    return (size_t) -1;
+  }
+  size_t k = 0;
+  if (ks->order->count) {
+    for (size_t i = 0, j; i < n; i = j) {
+      for (j = i + 1; j < n && ks->xrefs[j]->count == ks->xrefs[i]->count;
+          ++j) {
+      }
+      if (j - i > 1) {
+        ks->range[k++] = (wc__xrange) {
+          .lo = i, .hi = j, .depth = 0
+        };
+      }
+    }
+  } else {
+    size_t lo = count[0];
+    for (size_t b = 1; b < WC__RADIX_BUCKETS; ++b) {
+      if (count[b] > 1) {
+        ks->range[k++] = (wc__xrange) {
+          .lo = lo, .hi = lo + count[b], .depth = 1
+        };
+      }
+      lo += count[b];
+    }
+  }
+  return nrange;
+}
+
+//  wc__ksort_refs : sert pour wc__sort, via holdall_reorder. Trie les n
+//    références du tableau refs sans comparaison directe des chaines : les
+//    clés de tri sont calculées une fois pour toutes, en parallèle si
+//    ks->threads est supérieur à 1 ; les références sont rangées selon la
+//    valeur de leurs compteurs par répartition de leurs octets, puis chaque
+//    plage de même valeur ou, pour un ordre lexicographique, chaque seau du
+//    premier octet des clés est trié par wc__radix, en parallèle également.
+//    Faute de mémoire, le tri est effectué par psort_alloc à l'aide de la
+//    fonction de comparaison de l'ordre de tri et de ks->al : si ce dernier
+//    manque encore de mémoire, le tri a lieu sur place.
+static void wc__ksort_refs(struct wc__ksort *ks, void **refs, size_t n) {
+  size_t nchunk = (n + WC__XKEY_CHUNK - 1) / WC__XKEY_CHUNK;
+  ks->refs = refs;
+  ks->n = n;
+  ks->xkeys = NULL;
+  ks->xrefs = NULL;
+  ks->tmp = NULL;
+  ks->block = NULL;
+  ks->range = NULL;
+  atomic_init(&ks->failed, false);
+  size_t nrange = 0;
+  if (n < 2) {
+    return;
+  }
+  if (n > SIZE_MAX / sizeof *ks->xkeys) {
+    goto fallback;
+  }
+  ks->xkeys = allocator_alloc(ks->al, n * sizeof *ks->xkeys);
+  ks->xrefs = allocator_alloc(ks->al, n * sizeof *ks->xrefs);
+  ks->tmp = allocator_alloc(ks->al, n * sizeof *ks->tmp);
+  ks->block = allocator_alloc(ks->al, nchunk * sizeof *ks->block);
+  for (size_t k = 0; ks->block != NULL && k < nchunk; ++k) {
+    ks->block[k] = NULL;
+  }
+  if (ks->xkeys == NULL || ks->xrefs == NULL || ks->tmp == NULL
+      || ks->block == NULL) {
+    atomic_store(&ks->failed, true);
+    goto dispose;
+  }
+  if (wc__ksort_run(ks, nchunk, wc__xkey_chunk) != 0) {
+    atomic_store(&ks->failed, true);
+    goto dispose;
+  }
+  if (ks->order->count) {
+    wc__count_radix(ks->xrefs, ks->tmp, n, ks->order->reverse);
+  }
+  nrange = wc__ksort_ranges(ks);
+  if (nrange == (size_t) -1) {
+    nrange = 0;
+    atomic_store(&ks->failed, true);
+    goto dispose;
+  }
+  wc__ksort_run(ks, nrange, wc__xrange_sort);
+  if (!ks->order->count && ks->order->reverse) {
+    for (size_t i = 0; i < n; ++i) {
+      refs[i] = ks->xrefs[n - 1 - i]->w;
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      refs[i] = ks->xrefs[i]->w;
+    }
+  }
+dispose:
+  if (ks->range != NULL) {
+    allocator_release(ks->al, ks->range, nrange * sizeof *ks->range);
+  }
+  if (ks->block != NULL) {
+    for (size_t k = 0; k < nchunk; ++k) {
+      while (ks->block[k] != NULL) {
+        wc__xblock *b = ks->block[k];
+        ks->block[k] = b->next;
+        allocator_release(ks->al, b, sizeof *b + b->size);
+      }
+    }
+    allocator_release(ks->al, ks->block, nchunk * sizeof *ks->block);
+  }
+  if (ks->tmp != NULL) {
+    allocator_release(ks->al, ks->tmp, n * sizeof *ks->tmp);
+  }
+  if (ks->xrefs != NULL) {
+    allocator_release(ks->al, ks->xrefs, n * sizeof *ks->xrefs);
+  }
+  if (ks->xkeys != NULL) {
+    allocator_release(ks->al, ks->xkeys, n * sizeof *ks->xkeys);
+  }
+  if (!atomic_load(&ks->failed)) {
+    return;
+  }
+fallback:
+  psort_alloc(refs, n, ks->threads, (int (*)(const void *, const void *))
+      (ks->transform ? ks->order->compare : ks->order->bytes), ks->al);
+}
+
+//  wc__select_sift : sert pour wc__select_refs. Rétablit, à partir de
+//    l'indice i, la propriété de tas du tas de longueur n dont les éléments
+//    sont des indices du tableau refs : l'indice du plus grand mot au sens de
+//    compare est à la racine.
+static void wc__select_sift(size_t *heap, size_t n, size_t i, void **refs,
+    int (*compare)(const word **, const word **)) {
+  while (2 * i + 1 < n) {
+    size_t c = 2 * i + 1;
+    if (c + 1 < n && compare((const word **) &refs[heap[c + 1]],
+        (const word **) &refs[heap[c]]) > 0) {
+      ++c;
+    }
+    if (compare((const word **) &refs[heap[c]],
+        (const word **) &refs[heap[i]]) <= 0) {
+      return;
+    }
+    size_t t = heap[i];
+    heap[i] = heap[c];
+    heap[c] = t;
+    i = c;
+  }
+}
+
+//  wc__select_compare : sert pour wc__select_refs, via qsort. Compare les
+//    indices pointés par i1ptr et i2ptr.
+static int wc__select_compare(const size_t *i1ptr, const size_t *i2ptr) {
+  return (*i1ptr > *i2ptr) - (*i1ptr < *i2ptr);
+}
+
+//  wc__exclusive_partition : place en tête du fourretout ha, dans l'ordre
+//    dans lequel elles y figurent, les références aux mots exclusifs, c'est-à-
+//    dire de canal supérieur ou égal à START_CHANNEL, et renvoie leur nombre.
+//    Le fourretout est parcouru par segments, sans allocation.
+static size_t wc__exclusive_partition(holdall *ha) {
+  size_t n = holdall_count(ha);
+  size_t m = 0;
+  void **dst = NULL;
+  size_t dlen = 0;
+  for (size_t i = 0; i < n;) {
+    void **src;
+    size_t k = holdall_segment(ha, i, &src);
+    for (size_t j = 0; j < k; ++j) {
+      if (((word *) src[j])->channel >= START_CHANNEL) {
+        if (dlen == 0) {
+          dlen = holdall_segment(ha, m, &dst);
+        }
+        void *t = *dst;
+        *dst = src[j];
+        src[j] = t;
+        ++dst;
+        --dlen;
+        ++m;
+      }
+    }
+    i += k;
+  }
+  return m;
+}
+
+//  wc__select_refs : sert pour wc__sort, via holdall_reorder. Si ks->limit
+//    vaut 0, trie les n mots du tableau refs à l'aide de wc__ksort_refs.
+//    Sinon, sélectionne les ks->limit premiers d'entre eux dans l'ordre de tri
+//    à l'aide d'un tas borné, les place en tête de refs et ne trie qu'eux ;
+//    faute de mémoire pour le tas, tous les mots sont triés. Affecte à
+//    ks->selected le nombre de mots placés en tête et triés qui sont retenus.
+static void wc__select_refs(struct wc__ksort *ks, void **refs, size_t n) {
+  size_t cap = ks->limit < n ? ks->limit : n;
+  size_t *heap = cap == 0 ? NULL : allocator_alloc(ks->al, cap * sizeof *heap);
+  if (heap == NULL) {
+    wc__ksort_refs(ks, refs, n);
+    ks->selected = ks->limit != 0 && ks->limit < n ? ks->limit : n;
+    return;
+  }
+  int (*compare)(const word **, const word **)
+    = ks->transform ? ks->order->compare : ks->order->bytes;
+  size_t m = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (m < cap) {
+      heap[m] = i;
+      ++m;
+      for (size_t j = m - 1; j > 0
+          && compare((const word **) &refs[heap[(j - 1) / 2]],
+          (const word **) &refs[heap[j]]) < 0; j = (j - 1) / 2) {
+        size_t t = heap[j];
+        heap[j] = heap[(j - 1) / 2];
+        heap[(j - 1) / 2] = t;
+      }
+    } else if (compare((const word **) &refs[i],
+        (const word **) &refs[heap[0]]) < 0) {
+      heap[0] = i;
+      wc__select_sift(heap, m, 0, refs, compare);
+    }
+  }
+  // Les indices sélectionnés, croissants, sont au moins égaux à leur rang :
+  //    chaque échange amène en tête un mot sélectionné sans déplacer ceux qui
+  //    restent à amener
+  qsort(heap, m, sizeof *heap,
+      (int (*)(const void *, const void *))wc__select_compare);
+  for (size_t j = 0; j < m; ++j) {
+    void *t = refs[j];
+    refs[j] = refs[heap[j]];
+    refs[heap[j]] = t;
+  }
+  allocator_release(ks->al, heap, cap * sizeof *heap);
+  wc__ksort_refs(ks, refs, m);
+  ks->selected = m;
+}
+
+//  wc_sort : Tri le compteur de mot w selon l'ordre pointé par o, ce qui
+//    modifiera l'ordre d'appel des fonctions avec wc_apply par exemple. Le tri
+//    porte sur les chaines des mots si la collation est celle des locales "C"
+//    et "POSIX", sur des clés calculées une fois pour toutes par strxfrm
+//    sinon. Il est parallèle si w->threads est supérieur à 1. Seuls les mots
+//    exclusifs sont triés, et eux seuls restent visibles ; si w->limit ne vaut
+//    pas 0, seuls les w->limit premiers d'entre eux le sont. Faute de mémoire
+//    pour rassembler les mots exclusifs, ils sont triés sur place par
+//    holdall_sort_slice.
+static void wc__sort(wordcounter *w, const wc__order *o) {
+  wc__reclaim(w);
+  size_t m = wc__exclusive_partition(w->ha_word);
+  bool bytes = wc__collate_bytes();
+  struct wc__ksort ks = {
+    .al = w->al,
+    .order = o,
+    .threads = w->threads,
+    .transform = !bytes,
+    .limit = w->limit,
+  };
+  w->order = bytes ? o->bytes : o->compare;
+  if (holdall_reorder(w->ha_word, 0, m, &ks,
+      (void (*)(void *, void **, size_t))wc__select_refs) != 0) {
+    holdall_sort_slice(w->ha_word, 0, m,
+        (int (*)(const void *, const void *))w->order);
+    ks.selected = w->limit != 0 && w->limit < m ? w->limit : m;
+  }
+  w->visible = ks.selected;
 }
 
 //  Fonctions auxiliaires pour word --------------------------------------------
@@ -134,12 +1182,12 @@ static void wc__sort(wordcounter *w, int (*compare)(const word **,
 //    associés aux compteurs **w1ptr et **w2ptr à l'aide de strcoll (inverse
 //    pour reverse).
 static int word__compare_lexical(const word **w1ptr, const word **w2ptr) {
-  return strcoll((*w1ptr)->wordstr, (*w2ptr)->wordstr);
+  return strcoll(word_str(*w1ptr), word_str(*w2ptr));
 }
 
 static int word__compare_lexical_reverse(const word **w1ptr,
     const word **w2ptr) {
-  return strcoll((*w2ptr)->wordstr, (*w1ptr)->wordstr);
+  return strcoll(word_str(*w2ptr), word_str(*w1ptr));
 }
 
 //  word__compare_count, word__compare_count_reverse : compare la valeur des
@@ -160,6 +1208,34 @@ static int word__compare_count_l_reverse(const word **w1ptr,
   return r != 0 ? r : word__compare_lexical(w1ptr, w2ptr);
 }
 
+//  word__compare_bytes, word__compare_bytes_reverse, word__compare_count_b,
+//    word__compare_count_b_reverse : équivalents des fonctions précédentes
+//    lorsque la collation est celle des locales "C" et "POSIX", les mots étant
+//    comparés à l'aide de strcmp.
+static int word__compare_bytes(const word **w1ptr, const word **w2ptr) {
+  return strcmp(word_str(*w1ptr), word_str(*w2ptr));
+}
+
+static int word__compare_bytes_reverse(const word **w1ptr,
+    const word **w2ptr) {
+  return strcmp(word_str(*w2ptr), word_str(*w1ptr));
+}
+
+static int word__compare_count_b(const word **w1ptr, const word **w2ptr) {
+  int r
+    = ((*w1ptr)->count
+      > (*w2ptr)->count) - ((*w1ptr)->count < (*w2ptr)->count);
+  return r != 0 ? r : word__compare_bytes(w1ptr, w2ptr);
+}
+
+static int word__compare_count_b_reverse(const word **w1ptr,
+    const word **w2ptr) {
+  int r
+    = ((*w1ptr)->count
+      < (*w2ptr)->count) - ((*w1ptr)->count > (*w2ptr)->count);
+  return r != 0 ? r : word__compare_bytes(w1ptr, w2ptr);
+}
+
 //  WC__BUFSIZE_MIN : taille minimale du buffer de lecture dans un fichier s'il
 //    n'a pas de taille maximale prédéfinie
 #define WC__BUFSIZE_MIN 16
@@ -168,41 +1244,70 @@ static int word__compare_count_l_reverse(const word **w1ptr,
 //    un fichier lorsque ce buffer est plein
 #define WC__BUFSIZE_MUL 2
 
-//  wc__file_word_apply : parcours le flux pointé par stream et appel
-//    fun(w, WORD, c_int) pour tout les mots WORD lus dans le flux, tant que
+//  struct wc__source, wc__source : source des caractères lus par
+//    wc__word_apply : le flux pointé par stream s'il ne vaut pas NULL, sinon la
+//    zone mémoire qui commence à l'adresse cur et se termine juste avant end.
+typedef struct wc__source wc__source;
+struct wc__source {
+  FILE *stream;
+  const unsigned char *cur;
+  const unsigned char *end;
+};
+
+//  wc__source_get : renvoie, comme fgetc, le prochain caractère de la source
+//    pointée par src converti en int, ou EOF si la source est épuisée.
+static inline int wc__source_get(wc__source *src) {
+  if (src->stream != NULL) {
+    return fgetc(src->stream);
+  }
+  return src->cur < src->end ? *src->cur++ : EOF;
+}
+
+//  wc__source_error : renvoie true si une erreur de lecture s'est produite sur
+//    la source pointée par src, false sinon.
+static inline bool wc__source_error(wc__source *src) {
+  return src->stream != NULL && ferror(src->stream);
+}
+
+//  wc__word_apply : parcours la source pointée par src et appel
+//    fun(context, WORD, c_int) pour tout les mots WORD lus dans la source, le
+//    buffer de lecture étant alloué par al, tant que
 //    l'appel à fun renvoie une valeur nulle. Si only_alpha_num est à true alors
 //    les caractères de ponctuations sont considérés comme des espaces. Enfin
 //    les mots sont coupés au caractère à l'indice max_w_len si max_w_len
-//    n'est pas égal à 0.
+//    n'est pas égal à 0 ; la fin d'un mot coupé s'étend jusqu'au prochain
+//    caractère d'espacement, ponctuation comprise.
 //  Renvoie 0 en cas de succès, 1 en cas de dépassement de capacité, 2 en cas
-//    d'erreur de lecture sur le flux stream, et 3 si l'appel à fun a renvoyé
+//    d'erreur de lecture sur la source, et 3 si l'appel à fun a renvoyé
 //    une valeur différente de 0.
-static int wc__file_word_apply(FILE *stream, wordcounter *w, size_t max_w_len,
-    bool only_alpha_num, int c_int, int (*fun)(
-    wordcounter *, const char *, int)) {
+static int wc__word_apply(wc__source *src, const allocator *al,
+    size_t max_w_len, bool only_alpha_num, void *context, int c_int,
+    int (*fun)(void *, const char *, int)) {
   size_t cur_buff_size = max_w_len == 0 ? WC__BUFSIZE_MIN : max_w_len;
   if (cur_buff_size > SIZE_MAX - 1) {
     return 1;
   }
-  char *buff = malloc(cur_buff_size + 1);
+  char *buff = allocator_alloc(al, cur_buff_size + 1);
   if (buff == NULL) {
     return 1;
   }
+  int r = 0;
   size_t cur_w_len = 0;
   int c;
-  while ((c = fgetc(stream)) != EOF) {
+  while ((c = wc__source_get(src)) != EOF) {
     if (cur_w_len == cur_buff_size) {
       if (max_w_len == 0) {
         if (cur_buff_size > SIZE_MAX / WC__BUFSIZE_MUL - 1) {
-          free(buff);
-          return 1;
+          r = 1;
+          goto dispose;
         }
-        cur_buff_size *= WC__BUFSIZE_MUL;
-        char *nbuff = realloc(buff, cur_buff_size + 1);
+        char *nbuff = allocator_resize(al, buff, cur_buff_size + 1,
+            cur_buff_size * WC__BUFSIZE_MUL + 1);
         if (nbuff == NULL) {
-          free(buff);
-          return 1;
+          r = 1;
+          goto dispose;
         }
+        cur_buff_size *= WC__BUFSIZE_MUL;
         buff = nbuff;
       } else {
         if (!isspace(c)) {
@@ -213,8 +1318,9 @@ static int wc__file_word_apply(FILE *stream, wordcounter *w, size_t max_w_len,
     if (isspace(c) || (only_alpha_num && ispunct(c))) {
       if (cur_w_len > 0) {
         buff[cur_w_len] = '\0';
-        if (fun(w, buff, c_int) != 0) {
-          return 3;
+        if (fun(context, buff, c_int) != 0) {
+          r = 3;
+          goto dispose;
         }
         cur_w_len = 0;
       }
@@ -223,37 +1329,225 @@ static int wc__file_word_apply(FILE *stream, wordcounter *w, size_t max_w_len,
     buff[cur_w_len] = (char) c;
     ++cur_w_len;
   }
-  int r = ferror(stream) ? 2 : 0;
-  if (!ferror(stream) && cur_w_len > 0) {
+  r = wc__source_error(src) ? 2 : 0;
+  if (r == 0 && cur_w_len > 0) {
     buff[cur_w_len] = '\0';
-    if (fun(w, buff, c_int) != 0) {
-      return 3;
+    if (fun(context, buff, c_int) != 0) {
+      r = 3;
     }
   }
-  free(buff);
+dispose:
+  allocator_release(al, buff, cur_buff_size + 1);
+  return r;
+}
+
+//  WC__NGRAM_SEP : caractère qui sépare deux mots consécutifs dans la chaine
+//    d'une suite de mots.
+#define WC__NGRAM_SEP ' '
+
+//  struct wc__span, wc__span : repère d'un mot lu par wc__ngram_apply. start
+//    est la position de son premier caractère dans la zone de lecture, len sa
+//    longueur, poly la valeur du polynôme de ses caractères (voir wkey__hash)
+//    et pow celle de WKEY__POLY_BASE à la puissance len.
+typedef struct wc__span wc__span;
+
+struct wc__span {
+  size_t start;
+  size_t len;
+  uint64_t poly;
+  uint64_t pow;
+};
+
+//  wc__ngram_room : assure que la zone de lecture *buff, de taille *size + 1,
+//    dispose d'une place pour un caractère à la position *end. La fenêtre des
+//    count mots repérés par l'anneau ring de longueur n, à partir de l'indice
+//    first, suivie du mot courant cur, débute à la position lo : elle est
+//    ramenée en tête de la zone si elle commence au-delà de sa moitié, la
+//    zone est agrandie à l'aide de l'allocateur al sinon. Renvoie 1 en cas de
+//    dépassement de capacité, 0 sinon.
+static int wc__ngram_room(const allocator *al, char **buff, size_t *size,
+    size_t *end, wc__span *ring, size_t n, size_t first, size_t count,
+    wc__span *cur) {
+  if (*end < *size) {
+    return 0;
+  }
+  size_t lo = count > 0 ? ring[first].start : cur->start;
+  if (lo >= *size / 2) {
+    memmove(*buff, *buff + lo, *end - lo);
+    for (size_t i = 0; i < count; ++i) {
+      ring[(first + i) % n].start -= lo;
+    }
+    cur->start -= lo;
+    *end -= lo;
+    return 0;
+  }
+  if (*size > SIZE_MAX / WC__BUFSIZE_MUL - 1) {
+    return 1;
+  }
+  char *nbuff = allocator_resize(al, *buff, *size + 1,
+      *size * WC__BUFSIZE_MUL + 1);
+  if (nbuff == NULL) {
+    return 1;
+  }
+  *size *= WC__BUFSIZE_MUL;
+  *buff = nbuff;
+  return 0;
+}
+
+//  wc__ngram_apply : similaire à wc__word_apply, mais appelle
+//    fun(context, K, H, c_int) pour toutes les suites de n mots consécutifs
+//    lus dans la source, n étant supposé au moins égal à 2, K étant la clé de
+//    la chaine de la suite, formée de ses mots séparés par WC__NGRAM_SEP, et H
+//    sa valeur de hachage wkey__hash. Les n derniers mots lus sont repérés par
+//    un anneau et se succèdent ainsi séparés dans la zone de lecture, si bien
+//    que la chaine d'une suite longue est repérée par K sans être recopiée.
+//    Sa valeur H est alors obtenue en combinant selon le schéma de Horner les
+//    polynômes de ses mots, calculés au fil de la lecture, sans que ses
+//    caractères soient relus.
+static int wc__ngram_apply(wc__source *src, const allocator *al,
+    size_t max_w_len, bool only_alpha_num, size_t n, void *context,
+    int c_int, int (*fun)(void *, const wkey *, uint64_t, int)) {
+  if (n > SIZE_MAX / sizeof(wc__span)) {
+    return 1;
+  }
+  wc__span *ring = allocator_alloc(al, n * sizeof *ring);
+  if (ring == NULL) {
+    return 1;
+  }
+  size_t size = WC__BUFSIZE_MIN;
+  char *buff = allocator_alloc(al, size + 1);
+  if (buff == NULL) {
+    allocator_release(al, ring, n * sizeof *ring);
+    return 1;
+  }
+  int r = 0;
+  size_t first = 0;
+  size_t count = 0;
+  size_t end = 0;
+  wc__span cur = {
+    .start = 0,
+    .len = 0,
+  };
+  int c;
+  do {
+    c = wc__source_get(src);
+    if (c != EOF && max_w_len != 0 && cur.len == max_w_len && !isspace(c)) {
+      continue;
+    }
+    if (c == EOF || isspace(c) || (only_alpha_num && ispunct(c))) {
+      if (cur.len == 0 || (c == EOF && wc__source_error(src))) {
+        continue;
+      }
+      ring[(first + count) % n] = cur;
+      ++count;
+      cur.len = 0;
+      if (count < n) {
+        continue;
+      }
+      // La suite des n mots de l'anneau est complète
+      wkey k;
+      uint64_t h;
+      size_t lo = ring[first].start;
+      k.len = end - lo;
+      buff[end] = '\0';
+      if (WKEY__IS_INLINE(&k)) {
+        k.q[0] = 0;
+        k.q[1] = 0;
+        memcpy(k.inl, buff + lo, k.len);
+        h = wkey__hash(&k);
+      } else {
+        k.ext = buff + lo;
+        h = ring[first].poly;
+        for (size_t i = 1; i < n; ++i) {
+          const wc__span *sp = &ring[(first + i) % n];
+          h = (h * WKEY__POLY_BASE + WC__NGRAM_SEP) * sp->pow + sp->poly;
+        }
+        MIX64(h);
+      }
+      if (fun(context, &k, h, c_int) != 0) {
+        r = 3;
+        goto dispose;
+      }
+      continue;
+    }
+    if (cur.len == 0) {
+      // Début d'un mot : le plus ancien mot de l'anneau en sort si celui-ci
+      //    est plein
+      if (count == n) {
+        first = (first + 1) % n;
+        --count;
+      }
+      if (count > 0) {
+        if (wc__ngram_room(al, &buff, &size, &end, ring, n, first, count,
+            &cur) != 0) {
+          r = 1;
+          goto dispose;
+        }
+        buff[end] = WC__NGRAM_SEP;
+        ++end;
+      }
+      cur.start = end;
+      cur.poly = 0;
+      cur.pow = 1;
+    }
+    if (wc__ngram_room(al, &buff, &size, &end, ring, n, first, count,
+        &cur) != 0) {
+      r = 1;
+      goto dispose;
+    }
+    buff[end] = (char) c;
+    ++end;
+    ++cur.len;
+    cur.poly = cur.poly * WKEY__POLY_BASE + (unsigned char) c;
+    cur.pow *= WKEY__POLY_BASE;
+  } while (c != EOF);
+  r = wc__source_error(src) ? 2 : 0;
+dispose:
+  allocator_release(al, buff, size + 1);
+  allocator_release(al, ring, n * sizeof *ring);
   return r;
 }
 
 // Fonctions pour wordcounter --------------------------------------------------
 
 wordcounter *wc_empty(bool filtered) {
-  wordcounter *w = malloc(sizeof *w);
+  return wc_empty_alloc(filtered, allocator_libc());
+}
+
+wordcounter *wc_empty_alloc(bool filtered, const allocator *al) {
+  wordcounter *w = allocator_alloc(al, sizeof *w);
   if (w == NULL) {
     return NULL;
   }
-  w->counter = hashtable_empty((int (*)(const void *, const void *))strcmp,
-      (size_t (*)(const void *))str_hashfun);
+  w->al = al;
+  w->counter = hashtable_empty_alloc(
+      (int (*)(const void *, const void *))wkey__compare,
+      (size_t (*)(const void *))wkey__hashfun, al);
   if (w->counter == NULL) {
-    free(w);
+    allocator_release(al, w, sizeof *w);
     return NULL;
   }
-  w->ha_word = holdall_empty();
+  w->ha_word = holdall_empty_alloc(al);
   if (w->ha_word == NULL) {
-    free(w->counter);
-    free(w);
+    hashtable_dispose(&w->counter);
+    allocator_release(al, w, sizeof *w);
     return NULL;
   }
   w->filtered = filtered;
+  w->reclaim = false;
+  w->nmulti = 0;
+  fpset__init(&w->multi, al);
+  w->fp_check = false;
+  w->overflow = NULL;
+  w->overflow_context = NULL;
+  w->order = NULL;
+  w->visible = SIZE_MAX;
+  w->threads = 1;
+  w->limit = 0;
+  w->vocab = NULL;
+  w->vblock = NULL;
+  w->ngram = 1;
+  w->shared = NULL;
   return w;
 }
 
@@ -261,32 +1555,243 @@ void wc_dispose(wordcounter **w) {
   if (*w == NULL) {
     return;
   }
-  wc_apply(*w, rword__dispose_content);
+  const allocator *al = (*w)->al;
+  holdall_filter_context((*w)->ha_word, (void *) al,
+      (bool (*)(void *, void *))word__dispose_drop);
   hashtable_dispose(&(*w)->counter);
   holdall_dispose(&(*w)->ha_word);
-  free(*w);
+  fpset__dispose(&(*w)->multi);
+  if ((*w)->vocab != NULL) {
+    wc__vocab_release(*w);
+  }
+  allocator_release(al, *w, sizeof **w);
   *w = NULL;
 }
 
 int wc_addcount(wordcounter *w, const char *s, int channel) {
-  word *p = hashtable_search(w->counter, s);
-  if (p != NULL) {
-    ++p->count;
-    if (p->channel != channel) {
-      p->channel = p->channel == UNDEFINED_CHANNEL ? channel : MULTI_CHANNEL;
-    }
+  wkey k;
+  wkey__from(&k, s);
+  return wc__addcount(w, &k, wkey__hash(&k), channel);
+}
+
+int wc_addstate(wordcounter *w, const char *s, int channel,
+    long unsigned int count) {
+  wkey k;
+  wkey__from(&k, s);
+  word *p;
+  if (w->vocab != NULL && channel != UNDEFINED_CHANNEL
+      && (p = wc__vocab_search(w, &k, wkey__fingerprint(&k))) != NULL) {
+    wc__vocab_update(p, channel, count);
     return 0;
   }
-  if (w->filtered) {
-    return 0;
+  return wc__addstate(w, &k, channel, count);
+}
+
+const word *wc_search(wordcounter *w, const char *s) {
+  wkey k;
+  wkey__from(&k, s);
+  return hashtable_search(w->counter, &k);
+}
+
+//  struct wc__merge : sert pour wc_merge. Les mots de src sont transférés vers
+//    w ; failed indique qu'un transfert a échoué.
+struct wc__merge {
+  wordcounter *w;
+  wordcounter *src;
+  bool failed;
+};
+
+//  wc__merge_move : tente d'ajouter à w, sans le recopier, le compteur pointé
+//    par p qui provient d'un compteur de mots de même allocateur, et dont le
+//    mot est supposé absent de w. Renvoie 1 en cas de dépassement de capacité,
+//    w étant alors inchangé, 0 sinon.
+static int wc__merge_move(wordcounter *w, word *p) {
+  if (hashtable_add(w->counter, &p->key, p) == NULL) {
+    return 1;
+  }
+  if (holdall_put(w->ha_word, p) != 0) {
+    hashtable_remove(w->counter, &p->key);
+    return 1;
+  }
+  w->order = NULL;
+  w->visible = SIZE_MAX;
+  if (p->channel == MULTI_CHANNEL) {
+    wc__multi_found(w);
+  }
+  return 0;
+}
+
+//  wc__merge_word : sert pour wc_merge, via holdall_filter_context. Ajoute à
+//    m->w l'état du mot du compteur pointé par p, en appelant au besoin le
+//    gestionnaire de dépassement de capacité de m->w, puis retire p de m->src
+//    et renvoie false. Lorsque le compteur peut être transféré tel quel, il
+//    n'est pas recopié. En cas d'échec, ou si un échec a déjà eu lieu, laisse p
+//    dans m->src et renvoie true.
+static bool wc__merge_word(struct wc__merge *m, word *p) {
+  if (m->failed) {
+    return true;
+  }
+  wordcounter *w = m->w;
+  wordcounter *src = m->src;
+  bool move = w->al == src->al
+      && hashtable_search(w->counter, &p->key) == NULL
+      && !w->filtered
+      && !(w->multi.count != 0
+      && fpset__contains(&w->multi, wkey__fingerprint(&p->key)));
+  while ((move ? wc__merge_move(w, p)
+      : wc__addstate(w, &p->key, p->channel, p->count)) != 0) {
+    if (w->overflow == NULL || w->overflow(w->overflow_context, w) != 0) {
+      m->failed = true;
+      return true;
+    }
+  }
+  hashtable_remove(src->counter, &p->key);
+  if (p->channel == MULTI_CHANNEL && src->nmulti > 0) {
+    --src->nmulti;
+  }
+  if (!move) {
+    word__dispose_content(p, src->al);
+  }
+  return false;
+}
+
+//  wc__merge_fp : sert pour wc_merge. Ajoute l'empreinte fp à celles de w.
+//    Renvoie 1 en cas de dépassement de capacité, 0 sinon.
+static int wc__merge_fp(wordcounter *w, uint64_t fp) {
+  return wc_add_multi_fingerprint(w, fp);
+}
+
+int wc_merge(wordcounter *w, wordcounter *src) {
+  struct wc__merge m = {
+    .w = w,
+    .src = src,
+    .failed = false,
+  };
+  // Simple indication : en cas d'échec, les insertions échoueront plus tard et
+  //    seront traitées comme telles
+  (void) holdall_reserve(w->ha_word, holdall_count(src->ha_word));
+  holdall_filter_context(src->ha_word, &m,
+      (bool (*)(void *, void *))wc__merge_word);
+  if (m.failed || wc_apply_multi_fingerprints(src, w,
+      (int (*)(void *, uint64_t))wc__merge_fp) != 0) {
+    return 1;
+  }
+  fpset__dispose(&src->multi);
+  src->nmulti = 0;
+  src->fp_check = false;
+  if (w->fp_check) {
+    wc_reclaim(w);
+  }
+  return 0;
+}
+
+void wc_clear(wordcounter *w) {
+  hashtable_clear(w->counter);
+  holdall_filter_context(w->ha_word, (void *) w->al,
+      (bool (*)(void *, void *))word__dispose_drop);
+  fpset__dispose(&w->multi);
+  w->nmulti = 0;
+  w->fp_check = false;
+  w->order = NULL;
+  w->visible = SIZE_MAX;
+}
+
+uint64_t wc_str_hash(const char *s) {
+  wkey k;
+  wkey__from(&k, s);
+  return wkey__fingerprint(&k);
+}
+
+int wc_add_multi_fingerprint(wordcounter *w, uint64_t fp) {
+  if (fpset__add(&w->multi, fp) != 0) {
+    return 1;
   }
-  return wc__create_counter(w, s, channel) == NULL ? 1 : 0;
+  w->fp_check = true;
+  return 0;
+}
+
+int wc_apply_multi_fingerprints(wordcounter *w, void *context,
+    int (*fun)(void *context, uint64_t fp)) {
+  for (size_t k = 0; w->multi.lbsize != 0 && k <= FPSET__MASK(&w->multi);
+      ++k) {
+    if (w->multi.fps[k] != 0) {
+      int r = fun(context, w->multi.fps[k]);
+      if (r != 0) {
+        return r;
+      }
+    }
+  }
+  return 0;
+}
+
+//  wc__count : compte dans w, dans le canal channel, les mots ou les suites de
+//    mots (voir wc_set_ngram) lus dans la source pointée par src.
+static int wc__count(wordcounter *w, wc__source *src, size_t max_w_len,
+    bool only_alpha_num, int channel) {
+  if (w->ngram > 1) {
+    return wc__ngram_apply(src, w->al, max_w_len, only_alpha_num, w->ngram,
+        w, channel,
+        (int (*)(void *, const wkey *, uint64_t, int))wc__addcount);
+  }
+  return wc__word_apply(src, w->al, max_w_len, only_alpha_num, w, channel,
+      (int (*)(void *, const char *, int))wc_addcount);
 }
 
 int wc_filecount(wordcounter *w, FILE *stream, size_t max_w_len,
     bool only_alpha_num, int channel) {
-  return wc__file_word_apply(stream, w, max_w_len, only_alpha_num, channel,
-      wc_addcount);
+  wc__source src = {
+    .stream = stream,
+  };
+  return wc__count(w, &src, max_w_len, only_alpha_num, channel);
+}
+
+int wc_memcount(wordcounter *w, const char *s, size_t n, size_t max_w_len,
+    bool only_alpha_num, int channel) {
+  wc__source src = {
+    .stream = NULL,
+    .cur = (const unsigned char *) s,
+    .end = (const unsigned char *) s + n,
+  };
+  return wc__count(w, &src, max_w_len, only_alpha_num, channel);
+}
+
+//  struct wc__apply, wc__apply_call : sert pour wc_file_apply, via
+//    wc__ngram_apply. La chaine de chaque suite de mots est transmise à fun.
+struct wc__apply {
+  void *context;
+  int (*fun)(void *context, const char *s, int channel);
+};
+
+static int wc__apply_call(struct wc__apply *ap, const wkey *k, uint64_t h,
+    int channel) {
+  (void) h;
+  return ap->fun(ap->context, wkey__str(k), channel);
+}
+
+int wc_file_apply(FILE *stream, const allocator *al, size_t max_w_len,
+    bool only_alpha_num, size_t ngram, void *context, int channel,
+    int (*fun)(void *context, const char *s, int channel)) {
+  wc__source src = {
+    .stream = stream,
+  };
+  if (ngram > 1) {
+    struct wc__apply ap = {
+      .context = context,
+      .fun = fun,
+    };
+    return wc__ngram_apply(&src, al, max_w_len, only_alpha_num, ngram, &ap,
+        channel,
+        (int (*)(void *, const wkey *, uint64_t, int))wc__apply_call);
+  }
+  return wc__word_apply(&src, al, max_w_len, only_alpha_num, context,
+      channel, fun);
+}
+
+size_t wc_memdelim(const char *s, size_t n, size_t pos) {
+  while (pos < n && !isspace((unsigned char) s[pos])) {
+    ++pos;
+  }
+  return pos;
 }
 
 int wc_file_add_filtered(wordcounter *w, FILE *stream, size_t max_w_len,
@@ -294,26 +1799,346 @@ int wc_file_add_filtered(wordcounter *w, FILE *stream, size_t max_w_len,
   if (!w->filtered) {
     return 0;
   }
-  return wc__file_word_apply(stream, w, max_w_len, only_alpha_num,
-      UNDEFINED_CHANNEL, wc__create_empty_counter);
+  wc__source src = {
+    .stream = stream,
+  };
+  if (w->ngram > 1) {
+    return wc__ngram_apply(&src, w->al, max_w_len, only_alpha_num, w->ngram,
+        w, UNDEFINED_CHANNEL,
+        (int (*)(void *, const wkey *, uint64_t, int))wc__add_filtered);
+  }
+  return wc__word_apply(&src, w->al, max_w_len, only_alpha_num, w,
+      UNDEFINED_CHANNEL,
+      (int (*)(void *, const char *, int))wc__create_empty_counter);
+}
+
+int wc_add_filtered(wordcounter *w, const char *s) {
+  if (!w->filtered) {
+    return 0;
+  }
+  wkey k;
+  wkey__from(&k, s);
+  return wc__add_filtered(w, &k, wkey__hash(&k), UNDEFINED_CHANNEL);
+}
+
+void wc_share_filter(wordcounter *w, const wordcounter *src) {
+  if (src->filtered) {
+    w->shared = src;
+  }
+}
+
+void wc_set_reclaim(wordcounter *w, bool reclaim) {
+  w->reclaim = reclaim;
+}
+
+void wc_set_ngram(wordcounter *w, size_t n) {
+  w->ngram = n == 0 ? 1 : n;
+}
+
+void wc_set_threads(wordcounter *w, size_t threads) {
+  w->threads = threads == 0 ? 1 : threads;
+}
+
+void wc_set_limit(wordcounter *w, size_t limit) {
+  w->limit = limit;
+}
+
+size_t wc_restrict_exclusive(wordcounter *w) {
+  wc__reclaim(w);
+  size_t m = wc__exclusive_partition(w->ha_word);
+  w->visible = m;
+  return m;
+}
+
+size_t wc_reclaim(wordcounter *w) {
+  size_t n = holdall_count(w->ha_word);
+  w->reclaim = true;
+  wc__reclaim(w);
+  return n - holdall_count(w->ha_word);
+}
+
+void wc_set_overflow(wordcounter *w, void *context,
+    int (*overflow)(void *context, wordcounter *w)) {
+  w->overflow = overflow;
+  w->overflow_context = context;
+}
+
+int wc_set_vocab(wordcounter *w, const vocab *v) {
+  size_t n = vocab_size(v);
+  if (n == 0) {
+    return 0;
+  }
+  size_t nblocks = WC__VBLOCK_COUNT(n);
+  word **vblock = allocator_alloc(w->al, nblocks * sizeof *vblock);
+  if (vblock == NULL) {
+    return 1;
+  }
+  for (size_t k = 0; k < nblocks; ++k) {
+    vblock[k] = NULL;
+  }
+  for (size_t k = 0; k < nblocks; ++k) {
+    size_t len = wc__vblock_len(n, k);
+    vblock[k] = allocator_alloc(w->al, len * sizeof(word));
+    if (vblock[k] == NULL) {
+      wc__vblocks_release(w->al, vblock, n);
+      return 1;
+    }
+    // La clé d'un mot long repère sa chaine dans la projection du vocabulaire
+    for (size_t i = 0; i < len; ++i) {
+      word *p = &vblock[k][i];
+      wkey__from(&p->key, vocab_word(v, k * WC__VBLOCK_LEN + i));
+      p->count = 0;
+      p->channel = UNDEFINED_CHANNEL;
+    }
+  }
+  if (w->vocab != NULL) {
+    wc__vocab_release(w);
+  }
+  w->vocab = v;
+  w->vblock = vblock;
+  return 0;
+}
+
+int wc_flush_vocab(wordcounter *w) {
+  if (w->vocab == NULL) {
+    return 0;
+  }
+  size_t n = vocab_size(w->vocab);
+  for (size_t k = 0; k < WC__VBLOCK_COUNT(n); ++k) {
+    if (w->vblock[k] == NULL) {
+      continue;
+    }
+    size_t len = wc__vblock_len(n, k);
+    for (size_t i = 0; i < len; ++i) {
+      word *p = &w->vblock[k][i];
+      if (p->channel == UNDEFINED_CHANNEL) {
+        continue;
+      }
+      while (wc__addstate(w, &p->key, p->channel, p->count) != 0) {
+        if (w->overflow == NULL
+            || w->overflow(w->overflow_context, w) != 0) {
+          return 1;
+        }
+      }
+      // Le mot ajouté est marqué comme tel, pour qu'un nouvel appel reprenne
+      //    l'ajout là où il s'est arrêté
+      p->count = 0;
+      p->channel = UNDEFINED_CHANNEL;
+    }
+    // Chaque bloc est libéré dès qu'il a été reporté, ce qui limite
+    //    l'occupation mémoire durant le report
+    allocator_release(w->al, w->vblock[k], len * sizeof(word));
+    w->vblock[k] = NULL;
+  }
+  wc__vocab_release(w);
+  return 0;
 }
 
+//  WC__ORDER_LEXICAL, WC__ORDER_COUNT, WC__ORDER_LEXICAL_REVERSE,
+//    WC__ORDER_COUNT_REVERSE : ordres de tri de wc_sort_lexical,
+//    wc_sort_count, wc_sort_lexical_reverse et wc_sort_count_reverse.
+static const wc__order WC__ORDER_LEXICAL = {
+  .compare = word__compare_lexical,
+  .bytes = word__compare_bytes,
+  .count = false,
+  .reverse = false,
+};
+
+static const wc__order WC__ORDER_COUNT = {
+  .compare = word__compare_count_l,
+  .bytes = word__compare_count_b,
+  .count = true,
+  .reverse = false,
+};
+
+static const wc__order WC__ORDER_LEXICAL_REVERSE = {
+  .compare = word__compare_lexical_reverse,
+  .bytes = word__compare_bytes_reverse,
+  .count = false,
+  .reverse = true,
+};
+
+static const wc__order WC__ORDER_COUNT_REVERSE = {
+  .compare = word__compare_count_l_reverse,
+  .bytes = word__compare_count_b_reverse,
+  .count = true,
+  .reverse = true,
+};
+
 void wc_sort_lexical(wordcounter *w) {
-  wc__sort(w, word__compare_lexical);
+  wc__sort(w, &WC__ORDER_LEXICAL);
 }
 
 void wc_sort_count(wordcounter *w) {
-  wc__sort(w, word__compare_count_l);
+  wc__sort(w, &WC__ORDER_COUNT);
 }
 
 void wc_sort_lexical_reverse(wordcounter *w) {
-  wc__sort(w, word__compare_lexical_reverse);
+  wc__sort(w, &WC__ORDER_LEXICAL_REVERSE);
 }
 
 void wc_sort_count_reverse(wordcounter *w) {
-  wc__sort(w, word__compare_count_l_reverse);
+  wc__sort(w, &WC__ORDER_COUNT_REVERSE);
 }
 
 int wc_apply(wordcounter *w, int (*fun)(word *)) {
-  return holdall_apply((void *) w->ha_word, (int (*)(void *))fun);
+  size_t n = wc_word_count(w);
+  for (size_t i = 0; i < n;) {
+    void **refs;
+    size_t k = holdall_segment(w->ha_word, i, &refs);
+    k = k < n - i ? k : n - i;
+    for (size_t j = 0; j < k; ++j) {
+      int r = fun(refs[j]);
+      if (r != 0) {
+        return r;
+      }
+    }
+    i += k;
+  }
+  return 0;
+}
+
+//  struct wc__cursor : sert pour wc_apply_merge. Position courante dans la
+//    suite des mots de w : le mot courant, de rang pos, est pointé par refs[0],
+//    qui est suivi de manière contiguë de left - 1 autres ; end est le nombre
+//    de mots de la suite.
+struct wc__cursor {
+  wordcounter *w;
+  size_t pos;
+  size_t end;
+  void **refs;
+  size_t left;
+};
+
+//  wc__cursor_seek : place c sur le mot de rang c->pos, supposé strictement
+//    inférieur à c->end.
+static void wc__cursor_seek(struct wc__cursor *c) {
+  size_t k = holdall_segment(c->w->ha_word, c->pos, &c->refs);
+  c->left = k < c->end - c->pos ? k : c->end - c->pos;
+}
+
+//  wc__merge_sift : sert pour wc_apply_merge. Rétablit, à partir de l'indice
+//    i, la propriété de tas du tas de longueur n dont les éléments sont les
+//    indices des curseurs du tableau cur : le curseur de plus petit mot
+//    courant au sens de order est à la racine.
+static void wc__merge_sift(size_t *heap, size_t n, size_t i,
+    const struct wc__cursor *cur,
+    int (*order)(const word **, const word **)) {
+  while (2 * i + 1 < n) {
+    size_t c = 2 * i + 1;
+    if (c + 1 < n && order((const word **) cur[heap[c + 1]].refs,
+        (const word **) cur[heap[c]].refs) < 0) {
+      ++c;
+    }
+    if (order((const word **) cur[heap[c]].refs,
+        (const word **) cur[heap[i]].refs) >= 0) {
+      return;
+    }
+    size_t t = heap[i];
+    heap[i] = heap[c];
+    heap[c] = t;
+    i = c;
+  }
+}
+
+size_t wc_word_count(wordcounter *w) {
+  size_t n = holdall_count(w->ha_word);
+  return w->visible < n ? w->visible : n;
+}
+
+int wc_apply_slice(wordcounter *w, size_t first, size_t last,
+    void *context, int (*fun)(void *context, word *)) {
+  for (size_t i = first; i < last;) {
+    void **refs;
+    size_t k = holdall_segment(w->ha_word, i, &refs);
+    k = k < last - i ? k : last - i;
+    for (size_t j = 0; j < k; ++j) {
+      int r = fun(context, refs[j]);
+      if (r != 0) {
+        return r;
+      }
+    }
+    i += k;
+  }
+  return 0;
+}
+
+int wc_apply_merge(wordcounter **w, size_t n, void *context,
+    int (*fun)(void *context, word *)) {
+  int (*order)(const word **, const word **) = n == 0 ? NULL : w[0]->order;
+  size_t limit = n == 0 ? 0 : w[0]->limit;
+  for (size_t k = 0; k < n; ++k) {
+    if (w[k]->order != order) {
+      order = NULL;
+    }
+    if (w[k]->limit != limit) {
+      limit = 0;
+    }
+  }
+  if (order == NULL || n == 1) {
+    for (size_t k = 0; k < n; ++k) {
+      int r = wc_apply_context(w[k], context, fun);
+      if (r != 0) {
+        return r;
+      }
+    }
+    return 0;
+  }
+  // Les suites de mots des compteurs sont parcourues sur place, chacune à
+  //    l'aide de son curseur
+  const allocator *al = w[0]->al;
+  if (n > SIZE_MAX / sizeof(struct wc__cursor)) {
+    return -1;
+  }
+  struct wc__cursor *cur = allocator_alloc(al, n * sizeof *cur);
+  size_t *heap = allocator_alloc(al, n * sizeof *heap);
+  int r = -1;
+  if (cur == NULL || heap == NULL) {
+    goto dispose;
+  }
+  size_t h = 0;
+  for (size_t k = 0; k < n; ++k) {
+    cur[k] = (struct wc__cursor) {
+      .w = w[k],
+      .pos = 0,
+      .end = wc_word_count(w[k]),
+    };
+    if (cur[k].end != 0) {
+      wc__cursor_seek(&cur[k]);
+      heap[h] = k;
+      ++h;
+    }
+  }
+  for (size_t i = h / 2; i > 0; --i) {
+    wc__merge_sift(heap, h, i - 1, cur, order);
+  }
+  r = 0;
+  for (size_t i = 0; r == 0 && h > 0 && (limit == 0 || i < limit); ++i) {
+    struct wc__cursor *c = &cur[heap[0]];
+    r = fun(context, c->refs[0]);
+    ++c->pos;
+    if (c->pos == c->end) {
+      --h;
+      heap[0] = heap[h];
+    } else if (c->left > 1) {
+      ++c->refs;
+      --c->left;
+    } else {
+      wc__cursor_seek(c);
+    }
+    wc__merge_sift(heap, h, 0, cur, order);
+  }
+dispose:
+  if (heap != NULL) {
+    allocator_release(al, heap, n * sizeof *heap);
+  }
+  if (cur != NULL) {
+    allocator_release(al, cur, n * sizeof *cur);
+  }
+  return r;
+}
+
+int wc_apply_context(wordcounter *w, void *context,
+    int (*fun)(void *context, word *)) {
+  return wc_apply_slice(w, 0, wc_word_count(w), context, fun);
 }
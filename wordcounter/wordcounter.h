@@ -36,6 +36,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "allocator.h"
+#include "vocab.h"
 
 //  Les macro-constantes ci-dessous représentant les valeurs que peuvent
 //    prendre un canal, sachant que la valeur d'un canal peut être supérieur
@@ -75,6 +78,13 @@ extern int word_channel(const word *w);
 //    sinon un pointeur vers le controleur associé au nouveau compteur de mots.
 extern wordcounter *wc_empty(bool filtered);
 
+//  wc_empty_alloc : similaire à wc_empty, mais toutes les allocations
+//    dynamiques effectuées pour la gestion du compteur de mots, de sa table de
+//    hachage et de son fourretout le sont à l'aide de l'allocateur pointé par
+//    al, qui doit rester valide jusqu'à la révocation du contrôleur. wc_empty
+//    équivaut à wc_empty_alloc avec allocator_libc().
+extern wordcounter *wc_empty_alloc(bool filtered, const allocator *al);
+
 //  wc_dispose : sans effet si *w vaut NULL. Libère sinon les ressources
 //    allouées pour la gestion du compteur de mots, puis affecte NULL à *w.
 extern void wc_dispose(wordcounter **w);
@@ -84,25 +94,204 @@ extern void wc_dispose(wordcounter **w);
 //    indéfini, il prend la valeur de channel; s'il est égal à channel ou qu'il
 //    est multiple, rien ne se passe; enfin s'il est différent de channel, il
 //    devient multiple. Si le compteur n'existe pas, il est créé et initialisé
-//    à 1. Renvoie 1 en cas de dépassement de capacité, sinon renvoie 0.
+//    à 1. Si sa création échoue, le gestionnaire de dépassement de capacité de
+//    w est appelé (voir wc_set_overflow). Renvoie 1 en cas de dépassement de
+//    capacité, sinon renvoie 0.
 extern int wc_addcount(wordcounter *w, const char *s, int channel);
 
-//  pour wc_filecount, wc_file_add_filtered: les lus mots sont coupés à l'indice
-//    max_w_len s'il ne vaut pas 0. Si only_alpha_num vaut true, les caractères
-//    de ponctuations sont considérés comme des espaces. Renvoie 0 en cas de
-//    succès, 1 ou 3 en cas de dépassement de capacité et 2 en cas d'erreur de
-//    lecture sur le flux stream.
+//  wc_addstate : ajoute count au compteur associé au mot égal à la chaine
+//    pointée par s, et met à jour son canal comme wc_addcount le ferait si le
+//    mot était rencontré dans le canal channel ; si channel est indéfini, le
+//    canal n'est pas modifié. Si le compteur n'existe pas, il est créé avec le
+//    canal channel et la valeur count, sauf si w est filtré ou si le mot est
+//    connu pour être de canal multiple (voir wc_set_reclaim). Permet de
+//    fusionner dans w l'état d'un mot compté par ailleurs. Le gestionnaire de
+//    dépassement de capacité n'est pas appelé. Renvoie 1 en cas de dépassement
+//    de capacité, sinon renvoie 0.
+extern int wc_addstate(wordcounter *w, const char *s, int channel,
+    long unsigned int count);
+
+//  wc_search : renvoie un pointeur vers le compteur associé au mot égal à la
+//    chaine pointée par s s'il est présent dans w, NULL sinon.
+extern const word *wc_search(wordcounter *w, const char *s);
+
+//  wc_merge : transfère dans w l'état de tous les mots de src, selon les règles
+//    de wc_addstate, dans l'ordre où wc_apply les parcourt : un mot rencontré
+//    dans des canaux différents de w et de src devient de canal multiple. Les
+//    empreintes des mots de canal multiple retirés de src sont ajoutées à
+//    celles de w ; w passe alors en mode récupération. Le gestionnaire de
+//    dépassement de capacité de w est appelé comme par wc_addcount. Les
+//    compteurs transférés sont retirés de src ; si w et src sont associés au
+//    même allocateur, ceux dont le mot est absent de w y sont déplacés sans
+//    être recopiés. Renvoie 1 en cas de dépassement de capacité, src
+//    contenant alors les mots restant à transférer, sans que w ne les ait
+//    comptés : un nouvel appel à wc_merge peut achever le transfert. Renvoie
+//    sinon 0, src étant alors vide.
+extern int wc_merge(wordcounter *w, wordcounter *src);
+
+//  wc_clear : retire de w tous ses compteurs et toutes les empreintes de mots
+//    de canal multiple, en libérant les ressources qui leur sont associées.
+//    Les réglages de w sont conservés ; si w est filtré, plus aucun mot ne
+//    peut donc y être compté. Les compteurs denses du vocabulaire éventuel de
+//    w (voir wc_set_vocab) ne sont pas modifiés.
+extern void wc_clear(wordcounter *w);
+
+//  wc_str_hash : renvoie la valeur de hachage de 64 bits de la chaine pointée
+//    par s, qui n'est jamais nulle. Il s'agit de l'empreinte conservée pour un
+//    mot de canal multiple en mode récupération.
+extern uint64_t wc_str_hash(const char *s);
+
+//  wc_add_multi_fingerprint : ajoute l'empreinte fp à celles des mots de canal
+//    multiple de w. Un éventuel compteur présent dans w dont le mot a pour
+//    empreinte fp n'est retiré qu'au prochain appel à wc_reclaim. Renvoie 1 en
+//    cas de dépassement de capacité, sinon renvoie 0.
+extern int wc_add_multi_fingerprint(wordcounter *w, uint64_t fp);
+
+//  wc_apply_multi_fingerprints : applique fun(context, fp) à toutes les
+//    empreintes fp de mots de canal multiple de w, dans un ordre indéfini. Les
+//    appels sont interrompus avant la fin si un appel à fun renvoie une valeur
+//    différente de 0 ; cette valeur est alors renvoyée. Renvoie sinon 0.
+extern int wc_apply_multi_fingerprints(wordcounter *w, void *context,
+    int (*fun)(void *context, uint64_t fp));
+
+//  pour wc_filecount, wc_memcount, wc_file_add_filtered: les mots lus sont
+//    coupés à l'indice max_w_len s'il ne vaut pas 0. Si only_alpha_num vaut
+//    true, les caractères de ponctuations sont considérés comme des espaces.
+//    Renvoie 0 en cas de succès, 1 ou 3 en cas de dépassement de capacité et 2
+//    en cas d'erreur de lecture sur le flux stream.
 
 //  wc_filecount : applique wc_addcount(w, S, channel) à tous les mots S lus
-//    depuis le flux pointé par stream.
+//    depuis le flux pointé par stream ; si w compte des suites de n mots
+//    (voir wc_set_ngram), S parcourt plutôt les chaines de toutes les suites
+//    de n mots consécutifs du flux.
 extern int wc_filecount(wordcounter *w, FILE *stream, size_t max_w_len,
     bool only_alpha_num, int channel);
 
+//  wc_memcount : comme wc_filecount, pour les mots de la zone mémoire de n
+//    octets qui commence à l'adresse s, lue comme le serait un flux de même
+//    contenu.
+extern int wc_memcount(wordcounter *w, const char *s, size_t n,
+    size_t max_w_len, bool only_alpha_num, int channel);
+
+//  wc_memdelim : renvoie la position du premier caractère d'espacement de la
+//    zone mémoire de n octets qui commence à l'adresse s situé à la position
+//    pos ou après, n s'il n'y en a pas. Compter les mots de la zone avec
+//    wc_memcount en une fois, ou bien séparément de part et d'autre d'une
+//    telle position, donne le même résultat, quelles que soient les valeurs de
+//    max_w_len et de only_alpha_num, à moins que des suites de plusieurs mots
+//    ne soient comptées.
+extern size_t wc_memdelim(const char *s, size_t n, size_t pos);
+
 //  wc_file_add_filtered : sans effet si w n'est pas filtré. Sinon ajoute les
-//    mots lus dans le flux stream au filtre de w.
+//    mots lus dans le flux stream au filtre de w, ou les chaines des suites de
+//    mots lues si w compte des suites de mots.
 extern int wc_file_add_filtered(wordcounter *w, FILE *stream, size_t max_w_len,
     bool only_alpha_num);
 
+//  wc_file_apply : découpe le flux pointé par stream en mots exactement comme
+//    wc_filecount, mais appelle fun(context, S, channel) pour chaque mot S au
+//    lieu de le compter, tant que fun renvoie 0 ; si ngram est supérieur à 1,
+//    S parcourt les chaines des suites de ngram mots consécutifs, comme pour
+//    un compteur de mots réglé par wc_set_ngram. La chaine S n'est valide que
+//    durant l'appel. La zone de lecture est allouée par al.
+extern int wc_file_apply(FILE *stream, const allocator *al, size_t max_w_len,
+    bool only_alpha_num, size_t ngram, void *context, int channel,
+    int (*fun)(void *context, const char *s, int channel));
+
+//  wc_add_filtered : sans effet si w n'est pas filtré. Sinon ajoute le mot
+//    égal à la chaine pointée par s au filtre de w, s'il n'y figure pas déjà.
+//    Renvoie 1 en cas de dépassement de capacité, sinon renvoie 0.
+extern int wc_add_filtered(wordcounter *w, const char *s);
+
+//  wc_share_filter : sans effet si src n'est pas filtré. Sinon, w, supposé non
+//    filtré et vide, ne compte plus que les mots qui figurent dans src : le
+//    compteur d'un tel mot est créé dans w à sa première occurrence, les
+//    autres mots sont ignorés. src est consulté sans être recopié ; il ne doit
+//    pas être modifié tant que w compte des mots, mais peut être partagé par
+//    plusieurs compteurs de mots qui comptent sur des fils d'exécution
+//    différents.
+extern void wc_share_filter(wordcounter *w, const wordcounter *src);
+
+//  wc_set_reclaim : active (reclaim vaut true) ou désactive le mode
+//    récupération de w. Dans ce mode, les compteurs dont le canal devient
+//    multiple sont, par lots, retirés du compteur de mots et les ressources qui
+//    leur sont associées libérées ; seule une empreinte de 64 bits de leur mot
+//    est conservée pour que leur canal reste multiple. Ces compteurs ne sont
+//    alors plus parcourus par wc_apply. Deux mots distincts de même empreinte
+//    sont confondus ; la probabilité de cet événement est négligeable.
+extern void wc_set_reclaim(wordcounter *w, bool reclaim);
+
+//  wc_set_ngram : fixe à n la longueur des suites de mots consécutifs que
+//    comptent wc_filecount et wc_memcount, 1 par défaut ; la valeur 0 équivaut
+//    à 1. Si n est supérieur à 1, une suite est comptée comme le mot formé de
+//    ses mots séparés par une espace ; les suites d'un flux ou d'une zone ne
+//    chevauchent pas les précédents. La chaine d'une suite n'est copiée qu'à
+//    la création de son compteur et sa valeur de hachage est déduite de celles
+//    de ses mots.
+extern void wc_set_ngram(wordcounter *w, size_t n);
+
+//  wc_set_threads : fixe à threads le nombre de fils d'exécution utilisés par
+//    les fonctions wc_sort_* pour trier w, 1 par défaut ; la valeur 0 équivaut
+//    à 1. Le résultat du tri ne dépend pas de ce nombre.
+extern void wc_set_threads(wordcounter *w, size_t threads);
+
+//  wc_set_limit : fixe à limit le nombre de mots exclusifs, c'est-à-dire de
+//    canal supérieur ou égal à START_CHANNEL, retenus par les fonctions
+//    wc_sort_* ; la valeur 0, par défaut, signifie l'absence de limite. Si
+//    limit ne vaut pas 0, les fonctions wc_sort_* sélectionnent les limit
+//    premiers mots exclusifs de w dans l'ordre du tri, en un temps
+//    proportionnel à n log limit pour n mots, et ne trient qu'eux.
+extern void wc_set_limit(wordcounter *w, size_t limit);
+
+//  wc_restrict_exclusive : restreint le parcours de w à ses mots exclusifs,
+//    c'est-à-dire de canal supérieur ou égal à START_CHANNEL : jusqu'au
+//    prochain ajout d'un mot à w, wc_apply et ses variantes ne parcourent plus
+//    que ces mots, dans un ordre quelconque. Les autres mots restent comptés.
+//    Renvoie le nombre de mots exclusifs.
+extern size_t wc_restrict_exclusive(wordcounter *w);
+
+//  wc_reclaim : active le mode récupération de w et retire immédiatement tous
+//    les compteurs dont le canal est multiple ou dont le mot a une empreinte
+//    ajoutée par wc_add_multi_fingerprint. Renvoie le nombre de compteurs
+//    retirés.
+extern size_t wc_reclaim(wordcounter *w);
+
+//  wc_set_overflow : définit le gestionnaire de dépassement de capacité de w.
+//    Si overflow ne vaut pas NULL, lorsque la création d'un compteur par
+//    wc_addcount échoue, overflow(context, w) est appelé ; s'il renvoie zéro,
+//    la création est tentée à nouveau, et ainsi de suite tant qu'elle échoue.
+//    Le gestionnaire doit donc finir par renvoyer une valeur non nulle s'il ne
+//    parvient pas à libérer des ressources. Par défaut, w n'a pas de
+//    gestionnaire.
+extern void wc_set_overflow(wordcounter *w, void *context,
+    int (*overflow)(void *context, wordcounter *w));
+
+//  wc_set_vocab : associe à w le vocabulaire v (voir le module vocab), écrit
+//    avec wc_str_hash pour fonction de hachage. Les mots de v comptés ensuite
+//    par wc_addcount, ou ajoutés par wc_addstate avec un canal défini, ne sont
+//    plus rangés dans la table de w : leurs compteurs, créés d'avance, sont
+//    mis à jour selon les mêmes règles dans des blocs indicés par leurs
+//    identifiants, sans aucune allocation. Les autres mots sont comptés comme
+//    auparavant. Ces compteurs denses ne sont visibles qu'après l'appel à
+//    wc_flush_vocab, qui doit donc précéder tout autre usage de w ; ils ne
+//    sont ni transférés par wc_merge ni retirés par wc_clear. Le vocabulaire
+//    doit rester ouvert jusqu'à cet appel. Sans effet si v est vide. Renvoie
+//    1 en cas de dépassement de capacité, w étant alors inchangé, 0 sinon.
+extern int wc_set_vocab(wordcounter *w, const vocab *v);
+
+//  wc_flush_vocab : sans effet si aucun vocabulaire n'est associé à w. Ajoute
+//    sinon à w, selon les règles de wc_addstate, l'état de chacun des mots du
+//    vocabulaire qui y a été compté, en appelant au besoin le gestionnaire de
+//    dépassement de capacité de w et en libérant au fur et à mesure les blocs
+//    des compteurs denses, puis dissocie le vocabulaire de w. Renvoie 1 en
+//    cas de dépassement de capacité, les mots restant à ajouter étant
+//    conservés : un nouvel appel à wc_flush_vocab peut achever l'ajout.
+//    Renvoie sinon 0.
+extern int wc_flush_vocab(wordcounter *w);
+
+//  Les fonctions wc_sort_* ne trient que les mots exclusifs de w et, comme
+//    wc_restrict_exclusive, restreignent son parcours à ceux qui sont retenus.
+
 //  wc_sort_lexical : tri les mots en fonction de leur ordre lexicographique,
 //    donné par la fonction strcoll.
 extern void wc_sort_lexical(wordcounter *w);
@@ -123,6 +312,36 @@ extern void wc_sort_count_reverse(wordcounter *w);
 //    de 0.
 extern int wc_apply(wordcounter *w, int (*fun)(word *));
 
+//  wc_apply_context : similaire à wc_apply, mais appelle fun(context, W) pour
+//    tous les mots W.
+extern int wc_apply_context(wordcounter *w, void *context,
+    int (*fun)(void *context, word *));
+
+//  wc_word_count : renvoie le nombre de mots parcourus par wc_apply sur w.
+extern size_t wc_word_count(wordcounter *w);
+
+//  wc_apply_slice : similaire à wc_apply_context, mais restreint aux mots dont
+//    le rang, compté à partir de 0 dans l'ordre de parcours de wc_apply, est
+//    compris entre first inclus et last exclu, last étant supposé au plus égal
+//    à wc_word_count(w). Plusieurs appels peuvent avoir lieu simultanément sur
+//    des fils d'exécution différents tant que w n'est pas modifié.
+extern int wc_apply_slice(wordcounter *w, size_t first, size_t last,
+    void *context, int (*fun)(void *context, word *));
+
+//  wc_apply_merge : appelle fun(context, W) pour tous les mots W des n
+//    compteurs de mots du tableau w, supposés avoir des vocabulaires
+//    disjoints. Si les compteurs ont tous été triés par la même fonction
+//    wc_sort_* sans avoir reçu de nouveau mot depuis, leurs suites triées sont
+//    fusionnées et fun est appelée dans l'ordre de ce tri, en s'arrêtant après
+//    limit mots s'ils ont tous été triés avec la même limite limit non nulle
+//    (voir wc_set_limit) ; sinon, les compteurs sont parcourus l'un après
+//    l'autre comme par wc_apply_context. Les appels sont interrompus avant la
+//    fin si un appel à fun renvoie une valeur différente de 0 ; cette valeur
+//    est alors renvoyée. Renvoie sinon une valeur négative en cas de
+//    dépassement de capacité, 0 sinon.
+extern int wc_apply_merge(wordcounter **w, size_t n, void *context,
+    int (*fun)(void *context, word *));
+
 // -----------------------------------------------------------------------------
 
 #endif
@@ -1,15 +1,34 @@
+#define _GNU_SOURCE
+
 #include "hashtable.h"
 #include "holdall.h"
 #include "wordcounter.h"
+#include "spill.h"
+#include "runs.h"
+#include "sketch.h"
+#include "pool.h"
+#include "outbuf.h"
+#include "shuffle.h"
+#include "steal.h"
+#include "snapshot.h"
+#include "server.h"
+#include "vocab.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
 #include <errno.h>
 #include <unistd.h>
 #include <locale.h>
+#include <limits.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <getopt.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 //  Macros ---------------------------------------------------------------------
 
@@ -39,6 +58,11 @@
 #define ARGS__RESTRICT r
 #define ARGS__ONLY_ALPHA_NUM p
 #define ARGS__LIMIT_WLEN i
+#define ARGS__NGRAM g
+#define ARGS__RECLAIM c
+#define ARGS__HUGEPAGES H
+#define ARGS__JOBS j
+#define ARGS__TOP k
 
 #define ARGS__SORT_REVERSE R
 #define ARGS__SORT_TYPE s
@@ -55,6 +79,51 @@
 #define ARGS__SORT_TYPE_NONE "none"
 #define ARGS__SORT_VAL_NONE 0
 
+//  ARGS__LONG_* : noms des options longues, qui n'ont pas d'équivalent court.
+//    Les valeurs ARGS__LONG_VAL_* associées, renvoyées par getopt_long, sont
+//    supérieures à celles de tout caractère.
+#define ARGS__LONG_MEM_LIMIT "mem-limit"
+#define ARGS__LONG_VAL_MEM_LIMIT (UCHAR_MAX + 1)
+
+#define ARGS__LONG_MEM_STATS "mem-stats"
+#define ARGS__LONG_VAL_MEM_STATS (UCHAR_MAX + 2)
+
+#define ARGS__LONG_EXTERNAL "external"
+#define ARGS__LONG_VAL_EXTERNAL (UCHAR_MAX + 3)
+
+#define ARGS__LONG_SHUFFLE "shuffle"
+#define ARGS__LONG_VAL_SHUFFLE (UCHAR_MAX + 4)
+
+#define ARGS__LONG_SAVE "save"
+#define ARGS__LONG_VAL_SAVE (UCHAR_MAX + 5)
+
+#define ARGS__LONG_LOAD "load"
+#define ARGS__LONG_VAL_LOAD (UCHAR_MAX + 6)
+
+#define ARGS__LONG_CACHE "cache"
+#define ARGS__LONG_VAL_CACHE (UCHAR_MAX + 7)
+
+#define ARGS__LONG_FOLLOW "follow"
+#define ARGS__LONG_VAL_FOLLOW (UCHAR_MAX + 8)
+
+#define ARGS__LONG_CHANGES "changes"
+#define ARGS__LONG_VAL_CHANGES (UCHAR_MAX + 9)
+
+#define ARGS__LONG_SERVE "serve"
+#define ARGS__LONG_VAL_SERVE (UCHAR_MAX + 10)
+
+#define ARGS__LONG_VOCAB "vocab"
+#define ARGS__LONG_VAL_VOCAB (UCHAR_MAX + 11)
+
+#define ARGS__LONG_MAKE_VOCAB "make-vocab"
+#define ARGS__LONG_VAL_MAKE_VOCAB (UCHAR_MAX + 12)
+
+#define ARGS__LONG_RUNS "runs"
+#define ARGS__LONG_VAL_RUNS (UCHAR_MAX + 13)
+
+#define ARGS__LONG_APPROX "approx"
+#define ARGS__LONG_VAL_APPROX (UCHAR_MAX + 14)
+
 //  Structures -----------------------------------------------------------------
 
 //  struct wordstream, wordstream : utilisé pour représenté un flux de texte,
@@ -79,9 +148,49 @@ struct wordstream {
 //      doivent être considérés comme des espaces
 //  - max_w_len : longueur maximale des mots lus, si un mot est plus long il
 //      coupé. par défaut 0, qui représente l'absence de limite
+//  - ngram : longueur des suites de mots consécutifs comptées, 1 par défaut
+//  - reclaim : défini si les mots qui apparaissent dans plusieurs fichiers
+//      doivent être retirés du compteur de mots dès que possible
+//  - hugepages : défini si les grandes zones mémoire doivent être allouées
+//      dans des pages énormes
+//  - mem_limit : nombre maximal d'octets alloués pour le comptage des mots,
+//      0 représente l'absence de limite
+//  - mem_stats : défini si un bilan de l'usage mémoire doit être affiché sur
+//      la sortie erreur
+//  - external : défini si les mots doivent être déversés sur disque lorsque
+//      la limite mémoire est atteinte
+//  - runs : défini si chaque fichier doit être compté seul, puis écrit sur
+//      disque en une suite triée, les mots exclusifs étant obtenus par fusion
+//      des suites
+//  - approx : capacité du résumé des mots les plus fréquents de chaque
+//      fichier en mode approché, 0 si ce mode n'est pas actif
+//  - jobs : nombre de fils d'exécution utilisés pour compter les mots des
+//      fichiers, 1 par défaut
+//  - shuffle : défini si les mots doivent être répartis par hachage entre
+//      jobs partitions, chacune comptée par son propre fil d'exécution
 //  - sort_type : tri utilisé pour l'affichage des compteurs, qui est égal à une
 //      des maccro-constantes de nom ARGS__SORT_VAL_*
 //  - sort_reversed : défini si le tri se fait dans l'ordre inverse
+//  - top : nombre maximal de mots affichés, les premiers dans l'ordre du tri,
+//      sélectionnés sans trier les autres ; 0 représente l'absence de limite
+//  - save : chemin de l'instantané du comptage à écrire, NULL s'il n'y en a
+//      pas
+//  - load, nload : chemins des instantanés à fusionner au comptage et leur
+//      nombre
+//  - cache : répertoire du cache des comptages par fichier, NULL s'il n'y en
+//      a pas
+//  - follow : intervalle en secondes entre deux lectures des fichiers en mode
+//      suivi, 0 si ce mode n'est pas actif
+//  - changes : défini si, en mode suivi, seules les lignes modifiées depuis
+//      l'affichage précédent doivent être écrites
+//  - serve : chemin de la socket locale du mode serveur, NULL si ce mode n'est
+//      pas actif
+//  - vocab : chemin du vocabulaire dont les mots sont comptés dans des
+//      tableaux, NULL s'il n'y en a pas
+//  - make_vocab : chemin du vocabulaire des mots comptés à écrire, NULL s'il
+//      n'y en a pas
+//  - base : nombre total de fichiers des instantanés chargés, dont les canaux
+//      précèdent ceux des fichiers lus ; fixé une fois les instantanés ouverts
 //  - help : faut-il afficher l'aide ?
 typedef struct args args;
 struct args {
@@ -91,8 +200,29 @@ struct args {
   wordstream *filter;
   bool only_alpha_num;
   size_t max_w_len;
+  size_t ngram;
+  bool reclaim;
+  bool hugepages;
+  size_t mem_limit;
+  bool mem_stats;
+  bool external;
+  bool runs;
+  size_t approx;
+  size_t jobs;
+  bool shuffle;
   int sort_type;
   bool sort_reversed;
+  size_t top;
+  const char *save;
+  char **load;
+  size_t nload;
+  const char *cache;
+  size_t follow;
+  bool changes;
+  const char *serve;
+  const char *vocab;
+  const char *make_vocab;
+  int base;
   bool help;
 };
 
@@ -148,23 +278,603 @@ static void args_dispose(args **a);
 
 //  Fonctions auxiliaires ------------------------------------------------------
 
-//  rword_put : Sans effet si le canal de w vaut MULTI_CHANNEL. Sinon affiche le
-//    mot w sur la sortie standard, précédé d'un nombre de tabulation cohérent
-//    par rapport à son canal. Affiche ensuite le nombre d'occurences de ce mot
-//    puis saute à la ligne. Renvoie 0 dans tous les cas.
-static int rword_put(const word *w);
+//  rword_put : Sans effet si le canal de w vaut MULTI_CHANNEL. Sinon écrit le
+//    mot w dans le tampon de sortie ob, précédé d'un nombre de tabulation
+//    cohérent par rapport à son canal. Écrit ensuite le nombre d'occurences de
+//    ce mot puis saute à la ligne. Renvoie 0 dans tous les cas.
+static int rword_put(outbuf *ob, const word *w);
 
-//  rword_put_filter : similaire à rword_put, mais n'affiche que les mots dont
+//  rword_put_filter : similaire à rword_put, mais n'écrit que les mots dont
 //    le canal est différent de MULTI_CHANNEL et UNDEFINED_CHANNEL
-static int rword_put_filter(const word *w);
+static int rword_put_filter(outbuf *ob, const word *w);
+
+//  struct output_job, output_job : contexte de output_chunk. Les mots de w sont
+//    écrits à l'aide de put, par tranches de OUTPUT__CHUNK mots ; la tranche
+//    de numéro k est écrite dans le tampon sans descripteur ob[k].
+typedef struct output_job output_job;
+struct output_job {
+  wordcounter *w;
+  int (*put)(outbuf *, const word *);
+  outbuf **ob;
+};
+
+//  OUTPUT__CHUNK : nombre de mots d'une tranche écrite par output_chunk.
+#define OUTPUT__CHUNK 16384
+
+//  output_chunk : écrit dans un nouveau tampon sans descripteur, affecté à
+//    job->ob[k], la tranche de numéro k des mots de job->w. Renvoie 0 en cas
+//    de succès, 1 en cas de dépassement de capacité.
+static int output_chunk(output_job *job, size_t k);
+
+//  output_words : écrit sur la sortie standard, à l'aide de put et dans
+//    l'ordre de wc_apply, tous les mots de w. S'il y a suffisamment de mots et
+//    que jobs est supérieur à 1, les tranches de mots sont écrites chacune dans
+//    un tampon par jobs fils d'exécution, et ces tampons sont écrits sur la
+//    sortie standard dans l'ordre, par lots de jobs tampons à l'aide de
+//    outbuf_writev. Renvoie 0 en cas de succès, 1 en cas de dépassement de
+//    capacité.
+static int output_words(wordcounter *w, size_t jobs,
+    int (*put)(outbuf *, const word *));
+
+//  rwc_put : écrit, à l'aide de rword_put, tous les mots du compteur de mots
+//    w dans le tampon de sortie pointé par context. Renvoie 0 dans tous les
+//    cas.
+static int rwc_put(void *context, wordcounter *w);
+
+//  struct spill_output, spill_output : contexte de rspill_put et de rrun_put.
+//    Les états sont écrits dans le tampon de sortie ob ; left est le nombre
+//    de mots qu'il reste à écrire.
+typedef struct spill_output spill_output;
+struct spill_output {
+  outbuf *ob;
+  size_t left;
+};
+
+//  rspill_put : similaire à rword_put, pour l'état de mot sw lu dans une
+//    partition sur disque, context pointant vers un spill_output. left est
+//    décrémenté à chaque écriture ; une fois nul, les mots ne sont plus
+//    écrits.
+static int rspill_put(void *context, const spill_word *sw);
+
+//  rrun_put : similaire à rspill_put, pour le mot exclusif de chaine s, de
+//    canal channel et de compteur count obtenu par la fusion des suites
+//    triées, so pointant vers un spill_output.
+static int rrun_put(spill_output *so, const char *s, int channel,
+    long unsigned int count);
 
 //  print_help : affiche l'aide sur la sortie standard.
 static void print_help();
 
+//  MEM__RESERVE_DIV : lorsqu'une limite mémoire est fixée, une réserve d'un
+//    MEM__RESERVE_DIV-ième de la limite est gardée pour le mode dégradé.
+#define MEM__RESERVE_DIV 8
+
+//  MEM__SPILL_NPART : nombre de partitions sur disque du mode externe.
+#define MEM__SPILL_NPART 64
+
+//  struct mem_context, mem_context : contexte de mem_overflow. account pointe
+//    vers l'allocateur comptable ; external indique si le mode externe est
+//    actif, sp pointe alors vers les partitions sur disque une fois créées.
+//    rs pointe vers les suites triées si le moteur par suites est actif, NULL
+//    sinon ; les compteurs de mots y sont écrits une fois triés par sort.
+//    spill_error indique si une erreur est survenue sur les fichiers
+//    temporaires.
+typedef struct mem_context mem_context;
+struct mem_context {
+  allocator *account;
+  bool external;
+  spill *sp;
+  runs *rs;
+  void (*sort)(wordcounter *);
+  bool spill_error;
+};
+
+//  mem_overflow : gestionnaire de dépassement de capacité du compteur de mots
+//    w lorsqu'une limite mémoire est fixée, context pointant vers un
+//    mem_context. Libère la réserve, puis retire de w les mots de canal
+//    multiple (mode récupération) ; la réserve est reconstituée si l'usage
+//    redescend sous la limite abaissée. Si cela ne suffit pas et que le mode
+//    externe ou le moteur par suites est actif, déverse le contenu de w sur
+//    disque, ce qui le vide, et reconstitue la réserve. Renvoie zéro si de la
+//    mémoire a été libérée, une valeur non nulle sinon.
+static int mem_overflow(void *context, wordcounter *w);
+
+//  runs_flush : trie w à l'aide de mc->sort puis l'écrit dans une nouvelle
+//    suite de mc->rs, ce qui le vide. Renvoie 1 en cas de dépassement de
+//    capacité, 2 en cas d'erreur d'entrée-sortie, 0 sinon.
+static int runs_flush(mem_context *mc, wordcounter *w);
+
+//  filter_copy_word : sert pour main, via wc_apply_context. Ajoute le mot p au
+//    filtre du compteur de mots filtré flt. Renvoie 1 en cas de dépassement de
+//    capacité, 0 sinon.
+static int filter_copy_word(wordcounter *flt, word *p);
+
+//  struct count_job, count_job : contexte de count_file. a pointe vers les
+//    paramètres de l'exécutable, al vers l'allocateur des compteurs de mots,
+//    filter vers le compteur de mots filtré dont ceux-ci partagent le filtre,
+//    NULL s'il n'y en a pas, et le tableau part reçoit le compteur de mots de
+//    chaque fichier.
+typedef struct count_job count_job;
+struct count_job {
+  args *a;
+  const allocator *al;
+  const wordcounter *filter;
+  wordcounter **part;
+};
+
+//  COUNT__WINDOW_MUL : en mode parallèle, au plus COUNT__WINDOW_MUL fois le
+//    nombre de fils d'exécution fichiers sont comptés ou en attente de fusion.
+#define COUNT__WINDOW_MUL 2
+
+//  count_file : compte, dans un nouveau compteur de mots affecté à
+//    job->part[k], qui partage le filtre de job->filter s'il y en a un, les
+//    mots du fichier a->file[k] dans son canal. Renvoie 0 en cas de succès, 1
+//    en cas de dépassement de capacité, 2 en cas d'erreur de lecture.
+static int count_file(count_job *job, size_t k);
+
+//  count_parallel : compte les mots des fichiers de a dans w à l'aide de
+//    a->jobs fils d'exécution, chaque fichier étant compté séparément dans un
+//    compteur de mots alloué par al, puis fusionné dans w dans l'ordre des
+//    fichiers. Si filter ne vaut pas NULL, ces compteurs partagent le filtre
+//    du compteur de mots filtré pointé par filter, qui est une copie de celui
+//    de w : seuls les mots du filtre y sont comptés. Le nombre de fichiers
+//    fusionnés est affecté à *done. Si
+//    fallback vaut true, le premier fichier dont le comptage séparé dépasse la
+//    capacité, s'il ne s'agit pas de l'entrée standard, met fin au mode
+//    parallèle sans erreur : il reste à compter ce fichier et les suivants
+//    directement dans w, dont le gestionnaire de dépassement de capacité peut
+//    alors libérer de la mémoire. De même, si la fusion d'un fichier dépasse
+//    la capacité, les compteurs des fichiers suivants sont libérés avant de
+//    l'achever, et ces fichiers restent à compter. Renvoie 0 en cas de succès,
+//    1 en cas de dépassement de capacité, 2 en cas d'erreur de lecture.
+static int count_parallel(args *a, wordcounter *w, const allocator *al,
+    const wordcounter *filter, bool fallback, int *done);
+
+//  COUNT__CHUNK_MIN : taille minimale en octets d'un morceau de fichier compté
+//    séparément ; un fichier plus petit que deux morceaux n'est pas découpé.
+#define COUNT__CHUNK_MIN ((size_t) 1 << 20)
+
+//  struct chunk_job, chunk_job : contexte de count_chunk. a pointe vers les
+//    paramètres de l'exécutable, al vers l'allocateur des compteurs de mots,
+//    filter vers le compteur de mots filtré dont ceux-ci partagent le filtre,
+//    NULL s'il n'y en a pas, s vers le contenu du fichier compté dans le canal
+//    channel. Le morceau de numéro k s'étend de la position start[k] incluse
+//    à start[k + 1] exclue, et son compteur de mots est affecté à part[k].
+typedef struct chunk_job chunk_job;
+struct chunk_job {
+  args *a;
+  const allocator *al;
+  const wordcounter *filter;
+  const char *s;
+  size_t *start;
+  int channel;
+  wordcounter **part;
+};
+
+//  count_chunk : compte, dans un nouveau compteur de mots affecté à
+//    job->part[k], qui partage le filtre de job->filter s'il y en a un, les
+//    mots du morceau de numéro k dans le canal job->channel. Renvoie 0 en cas
+//    de succès, 1 en cas de dépassement de capacité.
+static int count_chunk(chunk_job *job, size_t k);
+
+//  count_split : compte dans w et dans le canal channel les mots du fichier
+//    ouvert associé à ws, à l'aide de a->jobs fils d'exécution, si ce fichier
+//    est un fichier ordinaire suffisamment grand pour être projeté en mémoire
+//    puis découpé en morceaux et si les mots sont comptés un à un, une suite
+//    de mots pouvant chevaucher deux morceaux. Les limites des morceaux sont
+//    repoussées jusqu'au caractère d'espacement suivant, puis chaque morceau
+//    est compté séparément dans un compteur de mots alloué par al, qui partage
+//    le filtre du compteur de mots filtré pointé par filter s'il ne vaut pas
+//    NULL (voir count_parallel), et fusionné dans w dans l'ordre du fichier :
+//    le résultat est celui d'un comptage direct. Si fallback vaut true, un dépassement de capacité lors du
+//    comptage séparé ou de la fusion d'un morceau met fin au mode parallèle
+//    sans erreur et la suite du fichier est comptée directement dans w.
+//    Sinon, ou si le fichier n'est pas découpé, compte ses mots directement
+//    dans w à l'aide de wc_filecount. Renvoie 0 en cas de succès, 1 ou 3 en
+//    cas de dépassement de capacité, 2 en cas d'erreur de lecture.
+static int count_split(args *a, wordcounter *w, const allocator *al,
+    const wordcounter *filter, wordstream *ws, int channel, bool fallback);
+
+//  struct shuffle_job, shuffle_job : contexte de shuffle_file et de
+//    sort_part. a pointe vers les paramètres de l'exécutable, al vers
+//    l'allocateur des zones de lecture, sh vers le contrôleur des partitions.
+//    Le tableau sw mémorise le producteur de chaque fil de lecture, NULL s'il
+//    n'a pas encore été créé. Le tableau part contient les partitions, à trier
+//    à l'aide de sort.
+typedef struct shuffle_job shuffle_job;
+struct shuffle_job {
+  args *a;
+  const allocator *al;
+  shuffle *sh;
+  shuffle_writer **sw;
+  wordcounter **part;
+  void (*sort)(wordcounter *);
+};
+
+//  shuffle_file : découpe en mots le fichier a->file[k] et les dépose, à
+//    l'aide du producteur du fil de lecture de numéro worker, dans les files
+//    d'attente des partitions pour y être comptés dans son canal. Les derniers
+//    lots du producteur ne sont pas déposés. Renvoie 0 en cas de succès, 1 en
+//    cas de dépassement de capacité, 2 en cas d'erreur de lecture.
+static int shuffle_file(shuffle_job *job, size_t worker, size_t k);
+
+//  count_shuffle : compte les mots des fichiers de a, ainsi que ceux du filtre
+//    si a->filtered vaut true, dans les npart partitions du tableau part,
+//    chacune comptée par son propre fil d'exécution. Les fichiers sont lus par
+//    a->jobs autres fils, qui se les répartissent par vol de tâches : un fil
+//    retardé par de gros fichiers se voit retirer ceux qu'il n'a pas encore
+//    démarrés. Les zones de lecture sont allouées par al. Renvoie 0 en cas de
+//    succès, 1 en cas de dépassement de capacité, 2 en cas d'erreur de
+//    lecture.
+static int count_shuffle(args *a, const allocator *al, wordcounter **part,
+    size_t npart);
+
+//  sort_part : trie la partition job->part[k] à l'aide de job->sort. Renvoie 0.
+static int sort_part(shuffle_job *job, size_t worker, size_t k);
+
+//  struct load_job, load_job : contexte de load_word et de load_fp. Les mots
+//    et les empreintes sont ajoutés à w ou, si npart n'est pas nul, à celle des
+//    npart partitions du tableau part à laquelle ils appartiennent ; base est
+//    ajouté au canal des mots. mc pointe vers le contexte de mem_overflow,
+//    appelé en cas de dépassement de capacité si une limite mémoire est fixée.
+//    nfps est le nombre d'empreintes ajoutées.
+typedef struct load_job load_job;
+struct load_job {
+  wordcounter *w;
+  wordcounter **part;
+  size_t npart;
+  mem_context *mc;
+  int base;
+  size_t nfps;
+};
+
+//  load_word : ajoute à job->w, ou à sa partition, l'état du mot de chaine s,
+//    de canal channel et de compteur count lu dans un instantané. Renvoie 0 en
+//    cas de succès, 1 en cas de dépassement de capacité.
+static int load_word(load_job *job, const char *s, int channel,
+    long unsigned int count);
+
+//  load_fp : ajoute à job->w, ou à sa partition, l'empreinte de mot de canal
+//    multiple fp lue dans un instantané. Renvoie 0 en cas de succès, 1 en cas
+//    de dépassement de capacité.
+static int load_fp(load_job *job, uint64_t fp);
+
+//  cache_entry : renvoie le chemin, alloué par malloc, du fichier du
+//    répertoire a->cache qui mémorise le comptage du fichier de chemin absolu
+//    path et d'état st. Ce chemin dépend de path, de la taille et de la date
+//    de dernière modification du fichier ainsi que des valeurs de a->max_w_len,
+//    a->only_alpha_num et a->ngram. Renvoie NULL en cas de dépassement de
+//    capacité.
+static char *cache_entry(const args *a, const char *path,
+    const struct stat *st);
+
+//  cache_suffix : renvoie un pointeur vers la partie du nom name d'un fichier
+//    du cache qui suit la date de dernière modification, c'est-à-dire vers son
+//    troisième caractère '-', NULL si name n'en contient pas trois.
+static const char *cache_suffix(const char *name);
+
+//  cache_prune : retire du répertoire a->cache les fichiers, autres que celui
+//    de chemin entry renvoyé par cache_entry, dont le nom ne diffère de celui
+//    de entry que par la taille et la date de dernière modification. Ils
+//    mémorisent le comptage d'une version antérieure du même fichier avec les
+//    mêmes valeurs de a->max_w_len, a->only_alpha_num et a->ngram. Les échecs
+//    sont ignorés.
+static void cache_prune(const args *a, const char *entry);
+
+//  cache_word : sert pour count_cached, via wc_apply_context. Ajoute à job->w
+//    l'état du mot p à l'aide de load_word.
+static int cache_word(load_job *job, word *p);
+
+//  cache_load : fusionne à job->w l'instantané de chemin entry du cache s'il
+//    existe et s'il mémorise le comptage du fichier de chemin absolu path avec
+//    les valeurs de a->max_w_len, a->only_alpha_num et a->ngram. Renvoie -1 si
+//    ce n'est pas le cas, 0 en cas de succès, 1 en cas de dépassement de
+//    capacité, 4 si l'instantané est invalide.
+static int cache_load(args *a, load_job *job, const char *entry,
+    const char *path);
+
+//  count_cached : compte dans job->w, dans le canal channel, les mots du
+//    fichier ordinaire ouvert associé à ws à l'aide du répertoire de cache
+//    a->cache. Si le cache contient un instantané du fichier, de même chemin
+//    absolu, taille et date de dernière modification, compté avec les mêmes
+//    valeurs de a->max_w_len, a->only_alpha_num et a->ngram, cet instantané
+//    est fusionné à job->w sans que le fichier ne soit lu. Sinon, le fichier
+//    est compté seul dans un nouveau compteur de mots alloué par al, non
+//    filtré, dont l'instantané est écrit dans le cache, à la place de ceux des
+//    versions antérieures du fichier (voir cache_prune), puis, le compteur
+//    libéré, fusionné à job->w ; si l'écriture échoue, un message est affiché
+//    sur la sortie erreur et le compteur est directement fusionné à job->w.
+//    Renvoie -1 si le fichier n'est pas un fichier ordinaire ou si son
+//    comptage seul dépasse la capacité : il reste alors à le compter
+//    directement. Renvoie sinon 0 en cas de succès, 1 en cas de dépassement
+//    de capacité, 2 en cas d'erreur de lecture, 4 si l'instantané du cache
+//    est invalide.
+static int count_cached(args *a, load_job *job, const allocator *al,
+    wordstream *ws, int channel);
+
+//  struct follow, follow : contexte du mode suivi des fichiers de a. Le
+//    tableau offset mémorise, pour chaque fichier, la position qui suit le
+//    dernier caractère d'espacement lu ; le tableau buf de longueur capacity
+//    reçoit les octets lus.
+typedef struct follow follow;
+struct follow {
+  args *a;
+  off_t *offset;
+  char *buf;
+  size_t capacity;
+};
+
+//  FOLLOW__CHUNK : capacité initiale en octets du tampon de lecture du mode
+//    suivi, doublée tant qu'elle ne suffit pas à contenir un mot.
+#define FOLLOW__CHUNK ((size_t) 1 << 20)
+
+//  follow_start : ouvre les fichiers de fl->a et alloue les tableaux de fl.
+//    Renvoie 0 en cas de succès, 1 en cas de dépassement de capacité, 2 en cas
+//    d'erreur de lecture, 3 si l'un des fichiers n'est pas un fichier
+//    ordinaire.
+static int follow_start(follow *fl);
+
+//  follow_read : compte dans w, chacun dans son canal, les mots ajoutés aux
+//    fichiers de fl->a depuis l'appel précédent. Seuls les octets qui précèdent
+//    le dernier caractère d'espacement d'un fichier sont comptés, les autres
+//    étant relus à l'appel suivant : un mot coupé par la fin du fichier n'est
+//    compté qu'une fois achevé. Un fichier dont la taille a diminué est relu
+//    depuis son début, après l'affichage d'un avertissement sur la sortie
+//    erreur. Affecte true à *changed si des octets ont été comptés. Renvoie 0
+//    en cas de succès, 1 en cas de dépassement de capacité, 2 en cas d'erreur
+//    de lecture.
+static int follow_read(follow *fl, wordcounter *w, bool *changed);
+
+//  struct follow_output, follow_output : contexte de follow_removed et de
+//    follow_changed. w est le compteur de mots du résultat et ob le tampon de
+//    sortie.
+typedef struct follow_output follow_output;
+struct follow_output {
+  wordcounter *w;
+  outbuf *ob;
+};
+
+//  follow_removed : sert pour follow_changes, via wc_apply_context. Écrit seul
+//    sur sa ligne le mot p s'il est exclusif dans fo->w mais ne l'y sera plus
+//    une fois l'état de p fusionné. Renvoie 0.
+static int follow_removed(follow_output *fo, word *p);
+
+//  follow_changed : sert pour follow_changes, via wc_apply_context. Écrit, à
+//    l'aide de rword_put_filter, l'état dans fo->w du mot de p s'il y figure.
+//    Renvoie 0.
+static int follow_changed(follow_output *fo, word *p);
+
+//  follow_changes : fusionne à job->w, à l'aide de cache_word, les mots de t,
+//    puis vide t. Écrit sur la sortie standard les lignes du résultat que la
+//    fusion modifie : d'abord les mots qui cessent d'être exclusifs, seuls sur
+//    leur ligne, puis l'état des mots de t qui sont exclusifs dans job->w.
+//    Renvoie 0 en cas de succès, 1 en cas de dépassement de capacité.
+static int follow_changes(load_job *job, wordcounter *t);
+
+//  follow_run : toutes les fl->a->follow secondes, compte les mots ajoutés aux
+//    fichiers de fl->a à l'aide de follow_read et, s'il y en a, écrit sur la
+//    sortie standard la ligne d'en-tête puis le résultat, trié par sort_fun si
+//    sort_fun ne vaut pas NULL, ou seulement ses lignes modifiées si
+//    fl->a->changes vaut true, les mots étant alors comptés dans un compteur
+//    de mots alloué par al avant d'être fusionnés à job->w par follow_changes.
+//    Ne s'arrête qu'en cas d'erreur : renvoie 1 en cas de dépassement de
+//    capacité, 2 en cas d'erreur de lecture.
+static int follow_run(follow *fl, load_job *job, const allocator *al,
+    snapshot **snap, size_t nsnap, void (*sort_fun)(wordcounter *));
+
+//  struct serve_job, serve_job : contexte du mode serveur. w est le compteur
+//    de mots interrogé, trié par sort ; les fichiers des nsnap instantanés du
+//    tableau snap et ceux de a y précèdent les nadded fichiers de noms
+//    added[0], ..., added[nadded - 1] ajoutés par des requêtes.
+typedef struct serve_job serve_job;
+struct serve_job {
+  args *a;
+  wordcounter *w;
+  snapshot **snap;
+  size_t nsnap;
+  void (*sort)(wordcounter *);
+  char **added;
+  size_t nadded;
+};
+
+//  SERVE__* : noms des requêtes du mode serveur.
+#define SERVE__GET "get"
+#define SERVE__TOP "top"
+#define SERVE__FILE "file"
+#define SERVE__FILES "files"
+#define SERVE__ADD "add"
+
+//  serve_arg : renvoie un pointeur vers l'argument de la requête s si elle
+//    est formée du nom name suivi d'une espace et d'un argument non vide,
+//    NULL sinon.
+static const char *serve_arg(const char *s, const char *name);
+
+//  serve_rank : renvoie le nombre strictement positif écrit en décimal par la
+//    chaine s, 0 si s n'est pas l'écriture d'un tel nombre.
+static size_t serve_rank(const char *s);
+
+//  serve_file_count, serve_file_name : renvoient respectivement le nombre de
+//    fichiers comptés dans job->w et le nom du fichier de rang k, compté à
+//    partir de 0, k étant supposé strictement inférieur à ce nombre.
+static size_t serve_file_count(serve_job *job);
+static const char *serve_file_name(serve_job *job, size_t k);
+
+//  struct serve_channel, serve_channel : contexte de serve_channel_put. Les
+//    mots de canal channel sont écrits dans ob.
+typedef struct serve_channel serve_channel;
+struct serve_channel {
+  outbuf *ob;
+  int channel;
+};
+
+//  serve_channel_put : sert pour serve_query, via wc_apply_slice. Écrit le mot
+//    p dans sc->ob à l'aide de rword_put s'il est de canal sc->channel.
+//    Renvoie 0.
+static int serve_channel_put(serve_channel *sc, word *p);
+
+//  struct serve_top, serve_top : contexte de serve_top_put. Il reste à écrire
+//    dans ob les left premières lignes du résultat.
+typedef struct serve_top serve_top;
+struct serve_top {
+  outbuf *ob;
+  size_t left;
+};
+
+//  serve_top_put : sert pour serve_query, via wc_apply_slice. Si le canal du
+//    mot p vaut au moins START_CHANNEL, écrit p dans st->ob à l'aide de
+//    rword_put et décrémente st->left. Renvoie 1 si st->left vaut 0, 0 sinon.
+static int serve_top_put(serve_top *st, word *p);
+
+//  serve_add : compte dans job->w les mots du fichier de chemin path, dans le
+//    canal qui suit ceux des fichiers déjà comptés, puis trie job->w à l'aide
+//    de job->sort. Écrit dans ob le rang, compté à partir de 1, du fichier,
+//    suivi d'un message d'erreur si son comptage a échoué : le fichier garde
+//    alors son rang et les mots lus avant l'échec. Écrit seulement un message
+//    d'erreur si le fichier n'a pas pu être ouvert ou retenu. Renvoie 0.
+static int serve_add(serve_job *job, const char *path, outbuf *ob);
+
+//  serve_exclusive : renvoie true si la requête s modifie job->w, false sinon.
+static bool serve_exclusive(serve_job *job, const char *s);
+
+//  serve_query : écrit dans ob la réponse à la requête s portant sur job->w :
+//    - "get WORD" : la ligne du résultat de WORD s'il n'apparait que dans un
+//        fichier, rien sinon ;
+//    - "top VALUE" : les VALUE premières lignes du résultat, ou toutes s'il
+//        en a moins ;
+//    - "file VALUE" : les lignes du résultat des mots qui n'apparaissent que
+//        dans le fichier de rang VALUE, compté à partir de 1 ;
+//    - "files" : les noms des fichiers, un par ligne, dans l'ordre de leurs
+//        rangs ;
+//    - "add FILE" : voir serve_add.
+//    Renvoie 0.
+static int serve_query(serve_job *job, const char *s, outbuf *ob);
+
+//  print_header : écrit sur la sortie standard la ligne d'en-tête du
+//    résultat : le nom du filtre, s'il y en a un, puis les noms des fichiers
+//    des nsnap instantanés du tableau snap et ceux des fichiers de a, chacun
+//    précédé d'une tabulation.
+static void print_header(args *a, snapshot **snap, size_t nsnap);
+
+//  save_snapshot : écrit dans le fichier a->save l'instantané du comptage des
+//    fichiers des nsnap instantanés du tableau snap puis des fichiers de a,
+//    dont les mots figurent dans les n compteurs de mots du tableau w.
+//    Renvoie 0 en cas de succès, 1 en cas de dépassement de capacité, 2 en cas
+//    d'erreur d'écriture.
+static int save_snapshot(args *a, snapshot **snap, size_t nsnap,
+    wordcounter **w, size_t n);
+
+//  struct vocab_gather, vocab_gather : mots recueillis par make_vocab. Le
+//    tableau word, de capacité suffisante, reçoit les chaines des n mots.
+typedef struct vocab_gather vocab_gather;
+struct vocab_gather {
+  const char **word;
+  size_t n;
+};
+
+//  vocab_gather_word : sert pour make_vocab, via wc_apply_context. Range la
+//    chaine du mot p parmi celles de g s'il a été compté au moins une fois.
+//    Renvoie 0.
+static int vocab_gather_word(vocab_gather *g, word *p);
+
+//  make_vocab : écrit dans le fichier de chemin a->make_vocab le vocabulaire
+//    des mots comptés au moins une fois dans les n compteurs de mots du
+//    tableau w, supposés avoir des vocabulaires disjoints. Renvoie 0 en cas de
+//    succès, 1 en cas de dépassement de capacité, 2 en cas d'erreur
+//    d'écriture.
+static int make_vocab(args *a, wordcounter **w, size_t n);
+
+//  struct approx_job, approx_job : contexte de approx_file. a pointe vers les
+//    paramètres de l'exécutable, al vers l'allocateur des croquis et des
+//    zones de lecture, et le tableau sk reçoit le croquis de chaque fichier.
+typedef struct approx_job approx_job;
+struct approx_job {
+  args *a;
+  const allocator *al;
+  sketch **sk;
+};
+
+//  approx_add : sert pour approx_file, via wc_file_apply. Ajoute le mot s au
+//    croquis sk. Renvoie 1 en cas de dépassement de capacité, 0 sinon.
+static int approx_add(sketch *sk, const char *s, int channel);
+
+//  approx_file : résume dans un nouveau croquis, dont le résumé est de
+//    capacité a->approx, affecté à job->sk[k], les mots du fichier a->file[k].
+//    Renvoie 0 en cas de succès, 1 en cas de dépassement de capacité, 2 en cas
+//    d'erreur de lecture.
+static int approx_file(approx_job *job, size_t worker, size_t k);
+
+//  struct approx_gather, approx_gather : contexte de approx_gather_word. Les
+//    mots retenus parmi ceux du croquis sk[k] des n croquis du tableau sk sont
+//    ajoutés au tableau word de longueur nword et de capacité capacity.
+typedef struct approx_gather approx_gather;
+struct approx_gather {
+  sketch **sk;
+  size_t n;
+  size_t k;
+  spill_word *word;
+  size_t nword;
+  size_t capacity;
+};
+
+//  approx_gather_word : sert pour approx_run, via sketch_apply. Retient le mot
+//    s, d'estimation count, du croquis g->sk[g->k] si les filtres des autres
+//    croquis indiquent qu'il n'a été lu dans aucun autre fichier. Renvoie 1 en
+//    cas de dépassement de capacité, 0 sinon.
+static int approx_gather_word(approx_gather *g, const char *s,
+    long unsigned int count);
+
+//  approx_print_header : écrit sur la sortie standard la ligne d'en-tête du
+//    résultat, puis les bornes d'erreur des n croquis du tableau sk, une
+//    colonne par fichier : le nombre estimé de mots distincts, à deux erreurs
+//    types près ; le majorant de l'excès des nombres d'occurrences ; la
+//    probabilité estimée qu'un mot exclusif du fichier soit écarté à tort par
+//    les filtres des autres fichiers.
+static void approx_print_header(args *a, sketch **sk, size_t n);
+
+//  approx_run : résume les mots de chacun des fichiers de a dans son propre
+//    croquis alloué par al, à l'aide de a->jobs fils d'exécution, puis écrit
+//    sur la sortie standard l'en-tête et les bornes d'erreur, suivis des mots
+//    les plus fréquents de chaque fichier qui n'ont probablement été lus dans
+//    aucun autre, avec l'estimation de leur nombre d'occurrences, triés selon
+//    a->sort_type et restreints aux a->top premiers si a->top n'est pas nul.
+//    Sans tri, les mots sont écrits fichier par fichier, dans l'ordre
+//    décroissant des estimations. Renvoie 0 en cas de succès, 1 en cas de
+//    dépassement de capacité, 2 en cas d'erreur de lecture.
+static int approx_run(args *a, const allocator *al);
+
+//  mem_fprint_stats : écrit le bilan de l'allocateur comptable pointé par al
+//    dans le flot texte stream.
+static void mem_fprint_stats(const allocator *al, FILE *stream);
+
 //  Main -----------------------------------------------------------------------
 
 int main(int argc, char *argv[]) {
   int r = EXIT_SUCCESS;
+  wordcounter *wc = NULL;
+  wordcounter *flt = NULL;
+  wordcounter **part = NULL;
+  size_t npart = 0;
+  outbuf *out = NULL;
+  snapshot **snap = NULL;
+  size_t nsnap = 0;
+  int rsn = 0;
+  const char *snap_path = NULL;
+  vocab *voc = NULL;
+  follow fl = {
+    .a = NULL,
+    .offset = NULL,
+    .buf = NULL,
+    .capacity = 0,
+  };
+  allocator *account = NULL;
+  mem_context mc = {
+    .account = NULL,
+    .external = false,
+    .sp = NULL,
+    .rs = NULL,
+    .sort = NULL,
+    .spill_error = false,
+  };
   // Récupèration des arguments
   int arg_err;
   args *a = args_init(argc, argv, &arg_err);
@@ -182,123 +892,1617 @@ int main(int argc, char *argv[]) {
   }
   // Locale
   setlocale(LC_COLLATE, "");
+  // Création de l'allocateur, comptable si une limite ou un bilan est demandé
+  const allocator *al = a->hugepages ? allocator_hugepage() : allocator_libc();
+  if (a->mem_limit != 0 || a->mem_stats) {
+    account = allocator_accounting_empty(al, a->mem_limit);
+    if (account == NULL) {
+      goto error_capacity;
+    }
+    al = account;
+    if (a->mem_limit != 0) {
+      allocator_accounting_set_soft_limit(account,
+          a->mem_limit - a->mem_limit / MEM__RESERVE_DIV);
+    }
+  }
+  // Mode approché : chaque fichier est résumé dans un croquis de taille fixe,
+  //    sans compteur de mots
+  if (a->approx != 0) {
+    int ra = approx_run(a, al);
+    if (ra != 0) {
+      if (ra == 2) {
+        goto error_read;
+      }
+      goto error_capacity;
+    }
+    goto dispose;
+  }
   // Création du compteur de mots
-  wordcounter *wc = wc_empty(a->filtered);
+  wc = wc_empty_alloc(a->filtered, al);
   if (wc == NULL) {
     goto error_capacity;
   }
-  // Application du filtre si demandé
-  if (a->filtered) {
-    wordstream *ws = a->filter;
+  wc_set_reclaim(wc, a->reclaim);
+  wc_set_ngram(wc, a->ngram);
+  wc_set_threads(wc, a->jobs);
+  wc_set_limit(wc, a->runs ? 0 : a->top);
+  if (a->mem_limit != 0) {
+    mc.account = account;
+    mc.external = a->external;
+    wc_set_overflow(wc, &mc, mem_overflow);
+  }
+  // Moteur par suites triées : chaque fichier est compté seul dans wc, qui
+  //    est ensuite trié puis écrit sur disque, ou plus tôt si la limite
+  //    mémoire est atteinte ; seul le vocabulaire d'un fichier réside en
+  //    mémoire
+  if (a->runs) {
+    mc.rs = runs_empty(a->sort_reversed);
+    if (mc.rs == NULL) {
+      goto error_capacity;
+    }
+    mc.sort = a->sort_reversed ? wc_sort_lexical_reverse : wc_sort_lexical;
+  }
+  // Application du filtre si demandé ; avec --shuffle, le filtre est réparti
+  //    entre les partitions
+  if (a->filtered && !a->shuffle) {
+    wordstream *ws = a->filter;
+    if (ws == NULL) {
+      goto error_capacity;
+    }
+    if (wordstream_popen(ws) != 0) {
+      goto error_read;
+    }
+    int rf = wc_file_add_filtered(wc, ws->stream, a->max_w_len,
+        a->only_alpha_num);
+    if (rf != 0) {
+      if (rf == 2) {
+        goto error_read;
+      }
+      goto error_capacity;
+    }
+    if (wordstream_pclose(ws) != 0) {
+      goto error_read;
+    }
+    // Copie du filtre, que partagent sans la modifier les compteurs de mots
+    //    des fils d'exécution : ils ne comptent ainsi que les mots du filtre,
+    //    alors que wc reçoit leurs fusions
+    if (a->jobs > 1) {
+      flt = wc_empty_alloc(true, al);
+      if (flt == NULL || wc_apply_context(wc, flt,
+          (int (*)(void *, word *))filter_copy_word) != 0) {
+        goto error_capacity;
+      }
+    }
+  }
+  // Ouverture du vocabulaire, dont les mots sont comptés dans des tableaux
+  //    jusqu'à la fin de l'analyse des fichiers ; faute de place, notamment
+  //    sous la limite mémoire, il est ignoré. Avec --shuffle, il est associé
+  //    à chaque partition
+  if (a->vocab != NULL) {
+    int rv;
+    voc = vocab_open(a->vocab, &rv);
+    if (voc == NULL) {
+      if (rv == 1) {
+        goto error_capacity;
+      }
+      r = EXIT_FAILURE;
+      fprintf(stderr, rv == 3 ? "*** Invalid vocabulary file: %s\n"
+          : "*** Error while using vocabulary file: %s\n", a->vocab);
+      goto dispose;
+    }
+    if (!a->shuffle && wc_set_vocab(wc, voc) != 0) {
+      fprintf(stderr, "--- Warning: vocabulary %s does not fit in memory and "
+          "is ignored\n", a->vocab);
+    }
+  }
+  // Ouverture des instantanés, dont les fichiers précèdent ceux lus
+  if (a->nload != 0) {
+    snap = calloc(a->nload, sizeof *snap);
+    if (snap == NULL) {
+      goto error_capacity;
+    }
+  }
+  for (; nsnap < a->nload; ++nsnap) {
+    snap_path = a->load[nsnap];
+    snap[nsnap] = snapshot_open(snap_path, &rsn);
+    if (snap[nsnap] == NULL) {
+      goto error_snapshot;
+    }
+    if (snapshot_max_w_len(snap[nsnap]) != a->max_w_len
+        || snapshot_only_alpha_num(snap[nsnap]) != a->only_alpha_num
+        || snapshot_ngram(snap[nsnap]) != a->ngram) {
+      r = EXIT_FAILURE;
+      fprintf(stderr, "*** Snapshot %s was counted with other -%c, -%c or "
+          "-%c values\n", snap_path, CHR(ARGS__LIMIT_WLEN),
+          CHR(ARGS__ONLY_ALPHA_NUM), CHR(ARGS__NGRAM));
+      goto dispose;
+    }
+    size_t nfiles = snapshot_file_count(snap[nsnap]);
+    if (nfiles > (size_t) (INT_MAX - START_CHANNEL - a->filecount - a->base)) {
+      goto error_capacity;
+    }
+    a->base += (int) nfiles;
+  }
+  // Analyse des différents fichiers ; avec un cache, les fichiers sont
+  //    traités l'un après l'autre
+  load_job lj = {
+    .w = wc,
+    .part = NULL,
+    .npart = 0,
+    .mc = &mc,
+    .base = 0,
+    .nfps = 0,
+  };
+  int first = 0;
+  if (a->shuffle) {
+    part = calloc(a->jobs, sizeof *part);
+    if (part == NULL) {
+      goto error_capacity;
+    }
+    for (npart = 0; npart < a->jobs; ++npart) {
+      part[npart] = wc_empty_alloc(a->filtered, al);
+      if (part[npart] == NULL) {
+        goto error_capacity;
+      }
+      wc_set_reclaim(part[npart], a->reclaim);
+      wc_set_limit(part[npart], a->top);
+      if (voc != NULL && wc_set_vocab(part[npart], voc) != 0) {
+        goto error_capacity;
+      }
+    }
+    int rp = count_shuffle(a, al, part, npart);
+    if (rp != 0) {
+      if (rp == 2) {
+        goto error_read;
+      }
+      goto error_capacity;
+    }
+    first = a->filecount;
+  } else if (a->follow != 0) {
+    fl.a = a;
+    int rp = follow_start(&fl);
+    bool changed = false;
+    if (rp == 0) {
+      rp = follow_read(&fl, wc, &changed);
+    }
+    if (rp != 0) {
+      if (rp == 3) {
+        r = EXIT_FAILURE;
+        fprintf(stderr, "*** Option --%s requires regular files\n",
+            ARGS__LONG_FOLLOW);
+        goto dispose;
+      }
+      if (rp == 2) {
+        goto error_read;
+      }
+      goto error_capacity;
+    }
+    first = a->filecount;
+  } else if (a->jobs > 1 && a->filecount > 1 && a->cache == NULL
+      && !a->runs) {
+    int rp = count_parallel(a, wc, al, flt, a->mem_limit != 0, &first);
+    if (rp != 0) {
+      if (rp == 2) {
+        goto error_read;
+      }
+      goto error_capacity;
+    }
+  }
+  for (int i = first; i < a->filecount; ++i) {
+    int channel = START_CHANNEL + a->base + i;
+    wordstream *ws = a->file[i];
+    if (ws == NULL) {
+      goto error_capacity;
+    }
+    if (wordstream_popen(ws) != 0) {
+      goto error_read;
+    }
+    int rc = a->cache == NULL ? -1 : count_cached(a, &lj, al, ws, channel);
+    if (rc < 0) {
+      rc = a->jobs > 1
+          ? count_split(a, wc, al, flt, ws, channel, a->mem_limit != 0)
+          : wc_filecount(wc, ws->stream, a->max_w_len, a->only_alpha_num,
+              channel);
+    }
+    if (rc == 4) {
+      r = EXIT_FAILURE;
+      fprintf(stderr, "*** Invalid cache file for %s\n", ws->filename);
+      goto dispose;
+    }
+    if (rc != 0) {
+      if (rc == 2) {
+        goto error_read;
+      }
+      goto error_capacity;
+    }
+    int r = wordstream_pclose(ws);
+    if (r != 0) {
+      goto error_read;
+    }
+    if (mc.rs != NULL) {
+      int rr = runs_flush(&mc, wc);
+      if (rr != 0) {
+        if (rr == 1) {
+          goto error_capacity;
+        }
+        goto error_spill;
+      }
+    }
+  }
+  // Report des compteurs denses du vocabulaire
+  if (wc_flush_vocab(wc) != 0) {
+    goto error_capacity;
+  }
+  for (size_t k = 0; k < npart; ++k) {
+    if (wc_flush_vocab(part[k]) != 0) {
+      goto error_capacity;
+    }
+  }
+  // Fusion des instantanés ; les mots de canal multiple dont seule
+  //    l'empreinte a été chargée sont ensuite retirés
+  lj.part = part;
+  lj.npart = npart;
+  lj.base = 0;
+  for (size_t k = 0; k < nsnap; ++k) {
+    snap_path = a->load[k];
+    rsn = snapshot_apply(snap[k], &lj,
+        (int (*)(void *, const char *, int, long unsigned int))load_word);
+    if (rsn == 0) {
+      rsn = snapshot_apply_fingerprints(snap[k], &lj,
+          (int (*)(void *, uint64_t))load_fp);
+    }
+    if (rsn != 0) {
+      goto error_snapshot;
+    }
+    lj.base += (int) snapshot_file_count(snap[k]);
+  }
+  if (lj.nfps != 0) {
+    if (part != NULL) {
+      for (size_t k = 0; k < npart; ++k) {
+        wc_reclaim(part[k]);
+      }
+    } else {
+      wc_reclaim(wc);
+    }
+  }
+  // Écriture de l'instantané si demandé
+  if (a->save != NULL) {
+    snap_path = a->save;
+    rsn = part != NULL
+        ? save_snapshot(a, snap, nsnap, part, npart)
+        : save_snapshot(a, snap, nsnap, &wc, 1);
+    if (rsn != 0) {
+      goto error_snapshot;
+    }
+  }
+  // Écriture du vocabulaire si demandé
+  if (a->make_vocab != NULL) {
+    int rv = part != NULL
+        ? make_vocab(a, part, npart) : make_vocab(a, &wc, 1);
+    if (rv == 1) {
+      goto error_capacity;
+    }
+    if (rv != 0) {
+      r = EXIT_FAILURE;
+      fprintf(stderr, "*** Error while using vocabulary file: %s\n",
+          a->make_vocab);
+      goto dispose;
+    }
+  }
+  // Choix du tri
+  void (*sort_fun)(wordcounter *) = NULL;
+  int (*spill_compar)(const spill_word *, const spill_word *) = NULL;
+  if (a->sort_type == ARGS__SORT_VAL_LEXICAL) {
+    sort_fun = a->sort_reversed ? wc_sort_lexical_reverse : wc_sort_lexical;
+    spill_compar = a->sort_reversed
+        ? spill_compare_lexical_reverse : spill_compare_lexical;
+  } else if (a->sort_type == ARGS__SORT_VAL_NUMERIC) {
+    sort_fun = a->sort_reversed ? wc_sort_count_reverse : wc_sort_count;
+    spill_compar = a->sort_reversed
+        ? spill_compare_count_reverse : spill_compare_count;
+  }
+  // Mode serveur, qui ne s'achève qu'en cas d'échec de la création de la
+  //    socket ; le compteur est trié en entier, par défaut selon l'ordre
+  //    décroissant des nombres d'occurrences
+  if (a->serve != NULL) {
+    serve_job job = {
+      .a = a,
+      .w = wc,
+      .snap = snap,
+      .nsnap = nsnap,
+      .sort = sort_fun != NULL ? sort_fun : wc_sort_count_reverse,
+      .added = NULL,
+      .nadded = 0,
+    };
+    wc_set_limit(wc, 0);
+    job.sort(wc);
+    server_run(a->serve, &job, (bool (*)(void *, const char *))serve_exclusive,
+        (int (*)(void *, const char *, outbuf *))serve_query);
+    r = EXIT_FAILURE;
+    fprintf(stderr, "*** Could not create socket: %s\n", a->serve);
+    free(job.added);
+    goto dispose;
+  }
+  // Tri si demandé, restreint aux mots exclusifs, seuls affichés ; si des
+  //    mots ont été déversés sur disque, le reste du compteur l'est aussi et
+  //    chaque partition est triée séparément
+  int rs = 0;
+  if (part != NULL) {
+    if (sort_fun != NULL) {
+      shuffle_job job = {
+        .part = part,
+        .sort = sort_fun,
+      };
+      if (steal_run(a->jobs, npart, &job,
+          (int (*)(void *, size_t, size_t))sort_part) != 0) {
+        goto error_capacity;
+      }
+    } else {
+      for (size_t k = 0; k < npart; ++k) {
+        wc_restrict_exclusive(part[k]);
+      }
+    }
+  } else if (mc.sp != NULL) {
+    wc_set_overflow(wc, NULL, NULL);
+    allocator_accounting_set_soft_limit(account, 0);
+    if (spill_write(mc.sp, wc) != 0) {
+      goto error_spill;
+    }
+    if (sort_fun != NULL) {
+      rs = spill_sort(mc.sp, wc, sort_fun);
+    }
+  } else if (sort_fun != NULL) {
+    sort_fun(wc);
+  } else {
+    wc_restrict_exclusive(wc);
+  }
+  if (rs != 0) {
+    goto error_spill_rs;
+  }
+  // Affichage des entetes
+  print_header(a, snap, nsnap);
+  // Affichage des compteurs, sans passer par le tampon de stdout
+  fflush(stdout);
+  int (*wd)(outbuf *, const word *)
+    = a->filtered ? rword_put_filter : rword_put;
+  if (part == NULL && mc.sp == NULL && mc.rs == NULL) {
+    if (output_words(wc, a->jobs, wd) != 0) {
+      goto error_capacity;
+    }
+  } else {
+    out = outbuf_empty(STDOUT_FILENO);
+    if (out == NULL) {
+      goto error_capacity;
+    }
+    if (part != NULL) {
+      if (wc_apply_merge(part, npart, out,
+          (int (*)(void *, word *))wd) < 0) {
+        goto error_capacity;
+      }
+    } else if (mc.rs != NULL) {
+      spill_output so = {
+        .ob = out,
+        .left = a->top == 0 ? SIZE_MAX : a->top,
+      };
+      rs = runs_merge(mc.rs, &so,
+          (int (*)(void *, const char *, int, long unsigned int))rrun_put);
+    } else if (sort_fun == NULL) {
+      rs = spill_collect(mc.sp, wc, out, rwc_put);
+    } else {
+      spill_output so = {
+        .ob = out,
+        .left = a->top == 0 ? SIZE_MAX : a->top,
+      };
+      rs = spill_merge(mc.sp, spill_compar, &so, rspill_put);
+    }
+  }
+  if (rs != 0) {
+    goto error_spill_rs;
+  }
+  // Mode suivi, qui ne s'achève qu'en cas d'erreur
+  if (a->follow != 0) {
+    lj.base = 0;
+    int rf = follow_run(&fl, &lj, al, snap, nsnap, sort_fun);
+    if (rf == 2) {
+      goto error_read;
+    }
+    goto error_capacity;
+  }
+  goto dispose;
+  // Gestion des erreurs et sortie du programme
+  error_capacity
+  : r = EXIT_FAILURE;
+  if (mc.spill_error) {
+    goto error_spill;
+  }
+  if (account != NULL) {
+    struct allocator_stats st;
+    allocator_accounting_stats(account, &st);
+    if (st.nrefused != 0) {
+      fprintf(stderr, "*** Memory limit of %zu bytes reached\n", st.limit);
+      goto dispose;
+    }
+  }
+  fprintf(stderr, "*** Error capacity\n");
+  goto dispose;
+error_read:
+  r = EXIT_FAILURE;
+  fprintf(stderr, "*** Error while reading a file\n");
+  goto dispose;
+error_snapshot:
+  if (rsn == 1) {
+    goto error_capacity;
+  }
+  r = EXIT_FAILURE;
+  fprintf(stderr, rsn == 3 ? "*** Invalid snapshot file: %s\n"
+      : "*** Error while using snapshot file: %s\n", snap_path);
+  goto dispose;
+error_spill_rs:
+  if (rs == 1) {
+    goto error_capacity;
+  }
+error_spill:
+  r = EXIT_FAILURE;
+  fprintf(stderr, "*** Error while using a temporary file\n");
+  goto dispose;
+dispose:
+  if (out != NULL) {
+    outbuf_flush(out);
+    outbuf_dispose(&out);
+  }
+  if (account != NULL && a->mem_stats) {
+    mem_fprint_stats(account, stderr);
+  }
+  spill_dispose(&mc.sp);
+  runs_dispose(&mc.rs);
+  free(fl.offset);
+  free(fl.buf);
+  for (size_t k = 0; k < nsnap; ++k) {
+    snapshot_dispose(&snap[k]);
+  }
+  free(snap);
+  for (size_t k = 0; k < npart; ++k) {
+    wc_dispose(&part[k]);
+  }
+  free(part);
+  wc_dispose(&flt);
+  wc_dispose(&wc);
+  vocab_dispose(&voc);
+  allocator_accounting_dispose(&account);
+  args_dispose(&a);
+  return r;
+}
+
+//  Définitions des fonctions --------------------------------------------------
+
+//  DISPLAY_WORD : écrit dans le tampon de sortie ob le mot w, son compteur
+//    d'occurences et un saut de lignes, le tout précédé de tabulations en
+//    fonction du canal de w.
+#define DISPLAY_WORD(ob, w)                                                    \
+  DISPLAY_STATE(ob, word_str(w), word_channel(w), word_count(w))
+
+//  DISPLAY_STATE : comme DISPLAY_WORD, pour le mot de chaine str, de canal
+//    channel et de compteur count.
+#define DISPLAY_STATE(ob, str, channel, count)                                 \
+  outbuf_puts(ob, str);                                                        \
+  outbuf_tabs(ob, (size_t) ((channel) - START_CHANNEL) + 1);                   \
+  outbuf_ulong(ob, count, '\n');
+
+int rword_put(outbuf *ob, const word *w) {
+  if (word_channel(w) == MULTI_CHANNEL) {
+    return 0;
+  }
+  DISPLAY_WORD(ob, w);
+  return 0;
+}
+
+int rword_put_filter(outbuf *ob, const word *w) {
+  if (word_channel(w) == MULTI_CHANNEL
+      || word_channel(w) == UNDEFINED_CHANNEL) {
+    return 0;
+  }
+  DISPLAY_WORD(ob, w);
+  return 0;
+}
+
+int output_chunk(output_job *job, size_t k) {
+  size_t n = wc_word_count(job->w);
+  size_t last = n - k * OUTPUT__CHUNK < OUTPUT__CHUNK
+      ? n : (k + 1) * OUTPUT__CHUNK;
+  job->ob[k] = outbuf_empty(-1);
+  if (job->ob[k] == NULL) {
+    return 1;
+  }
+  wc_apply_slice(job->w, k * OUTPUT__CHUNK, last, job->ob[k],
+      (int (*)(void *, word *))job->put);
+  return 0;
+}
+
+int output_words(wordcounter *w, size_t jobs,
+    int (*put)(outbuf *, const word *)) {
+  size_t n = (wc_word_count(w) + OUTPUT__CHUNK - 1) / OUTPUT__CHUNK;
+  output_job job = {
+    .w = w,
+    .put = put,
+    .ob = NULL,
+  };
+  pool *p = NULL;
+  if (jobs > 1 && n > 1) {
+    job.ob = calloc(n, sizeof *job.ob);
+    if (job.ob != NULL) {
+      p = pool_start(jobs, n, COUNT__WINDOW_MUL * jobs, &job,
+          (int (*)(void *, size_t))output_chunk);
+    }
+  }
+  int r = 0;
+  if (p == NULL) {
+    outbuf *ob = outbuf_empty(STDOUT_FILENO);
+    if (ob == NULL) {
+      r = 1;
+    } else {
+      wc_apply_slice(w, 0, wc_word_count(w), ob,
+          (int (*)(void *, word *))put);
+      outbuf_flush(ob);
+      outbuf_dispose(&ob);
+    }
+  } else {
+    // Les tampons des tranches first à k - 1 attendent d'être écrits
+    size_t first = 0;
+    for (size_t k = 0; r == 0 && k < n; ++k) {
+      r = pool_wait(p, k);
+      if (r == 0 && (k + 1 - first == jobs || k + 1 == n)) {
+        outbuf_writev(STDOUT_FILENO, job.ob + first, k + 1 - first);
+        for (; first <= k; ++first) {
+          outbuf_dispose(&job.ob[first]);
+        }
+      }
+    }
+  }
+  pool_dispose(&p);
+  if (job.ob != NULL) {
+    for (size_t k = 0; k < n; ++k) {
+      outbuf_dispose(&job.ob[k]);
+    }
+  }
+  free(job.ob);
+  return r;
+}
+
+int rwc_put(void *context, wordcounter *w) {
+  wc_apply_context(w, context, (int (*)(void *, word *))rword_put);
+  return 0;
+}
+
+int rspill_put(void *context, const spill_word *sw) {
+  spill_output *so = context;
+  if (sw->channel == MULTI_CHANNEL || so->left == 0) {
+    return 0;
+  }
+  --so->left;
+  DISPLAY_STATE(so->ob, sw->str, sw->channel, sw->count);
+  return 0;
+}
+
+int rrun_put(spill_output *so, const char *s, int channel,
+    long unsigned int count) {
+  if (so->left == 0) {
+    return 0;
+  }
+  --so->left;
+  DISPLAY_STATE(so->ob, s, channel, count);
+  return 0;
+}
+
+//  ----------------------------------------------------------------------------
+
+#define P_TITLE(textstream, name)                                              \
+  fprintf(textstream, "--- Info: %s\n", name)
+#define P_VALUE(textstream, name, format, value)                               \
+  fprintf(textstream, "%12s\t" format "\n", name, value)
+
+int filter_copy_word(wordcounter *flt, word *p) {
+  return wc_add_filtered(flt, word_str(p));
+}
+
+int count_file(count_job *job, size_t k) {
+  args *a = job->a;
+  wordstream *ws = a->file[k];
+  if (ws == NULL) {
+    return 1;
+  }
+  if (wordstream_popen(ws) != 0) {
+    return 2;
+  }
+  job->part[k] = wc_empty_alloc(false, job->al);
+  int rc = 1;
+  if (job->part[k] != NULL) {
+    if (job->filter != NULL) {
+      wc_share_filter(job->part[k], job->filter);
+    }
+    wc_set_ngram(job->part[k], a->ngram);
+    rc = wc_filecount(job->part[k], ws->stream, a->max_w_len,
+        a->only_alpha_num, START_CHANNEL + a->base + (int) k);
+    if (rc == 3) {
+      rc = 1;
+    }
+  }
+  if (wordstream_pclose(ws) != 0 && rc == 0) {
+    rc = 2;
+  }
+  return rc;
+}
+
+int count_parallel(args *a, wordcounter *w, const allocator *al,
+    const wordcounter *filter, bool fallback, int *done) {
+  size_t n = (size_t) a->filecount;
+  *done = 0;
+  wordcounter **part = calloc(n, sizeof *part);
+  if (part == NULL) {
+    return 1;
+  }
+  count_job job = {
+    .a = a,
+    .al = al,
+    .filter = filter,
+    .part = part,
+  };
+  int r = 1;
+  pool *p = pool_start(a->jobs, n, COUNT__WINDOW_MUL * a->jobs, &job,
+      (int (*)(void *, size_t))count_file);
+  if (p != NULL) {
+    r = 0;
+    for (size_t k = 0; r == 0 && k < n; ++k) {
+      r = pool_wait(p, k);
+      if (r == 1 && fallback && a->file[k] != NULL
+          && !a->file[k]->is_stdin) {
+        r = 0;
+        break;
+      }
+      if (r == 0 && wc_merge(w, part[k]) != 0) {
+        r = 1;
+        if (fallback) {
+          // Libère les compteurs des fichiers suivants avant d'achever la
+          //    fusion, ces fichiers étant ensuite comptés directement dans w
+          pool_dispose(&p);
+          for (size_t j = k + 1; j < n; ++j) {
+            wc_dispose(&part[j]);
+          }
+          r = wc_merge(w, part[k]) != 0;
+          n = k + 1;
+        }
+      }
+      wc_dispose(&part[k]);
+      ++*done;
+    }
+  }
+  pool_dispose(&p);
+  for (size_t k = 0; k < n; ++k) {
+    wc_dispose(&part[k]);
+  }
+  free(part);
+  return r;
+}
+
+int count_chunk(chunk_job *job, size_t k) {
+  args *a = job->a;
+  job->part[k] = wc_empty_alloc(false, job->al);
+  if (job->part[k] == NULL) {
+    return 1;
+  }
+  if (job->filter != NULL) {
+    wc_share_filter(job->part[k], job->filter);
+  }
+  return wc_memcount(job->part[k], job->s + job->start[k],
+      job->start[k + 1] - job->start[k], a->max_w_len, a->only_alpha_num,
+      job->channel) != 0;
+}
+
+int count_split(args *a, wordcounter *w, const allocator *al,
+    const wordcounter *filter, wordstream *ws, int channel, bool fallback) {
+  struct stat st;
+  if (a->ngram > 1 || ws->is_stdin || fstat(fileno(ws->stream), &st) != 0
+      || !S_ISREG(st.st_mode) || st.st_size < 0
+      || (uintmax_t) st.st_size / 2 < COUNT__CHUNK_MIN
+      || (uintmax_t) st.st_size > SIZE_MAX) {
+    return wc_filecount(w, ws->stream, a->max_w_len, a->only_alpha_num,
+        channel);
+  }
+  size_t size = (size_t) st.st_size;
+  size_t n = size / COUNT__CHUNK_MIN;
+  if (n > a->jobs) {
+    n = a->jobs;
+  }
+  char *s = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(ws->stream), 0);
+  if (s == MAP_FAILED) {
+    return wc_filecount(w, ws->stream, a->max_w_len, a->only_alpha_num,
+        channel);
+  }
+  madvise(s, size, MADV_SEQUENTIAL);
+  size_t *start = malloc((n + 1) * sizeof *start);
+  wordcounter **part = calloc(n, sizeof *part);
+  int r = 1;
+  if (start == NULL || part == NULL) {
+    goto dispose;
+  }
+  start[0] = 0;
+  for (size_t k = 1; k < n; ++k) {
+    size_t pos = size / n * k;
+    start[k] = wc_memdelim(s, size, pos < start[k - 1] ? start[k - 1] : pos);
+  }
+  start[n] = size;
+  chunk_job job = {
+    .a = a,
+    .al = al,
+    .filter = filter,
+    .s = s,
+    .start = start,
+    .channel = channel,
+    .part = part,
+  };
+  pool *p = pool_start(a->jobs, n, a->jobs, &job,
+      (int (*)(void *, size_t))count_chunk);
+  if (p == NULL) {
+    goto dispose;
+  }
+  // Fusion dans l'ordre du fichier ; en cas de repli, la suite du fichier à
+  //    partir de la position rest est comptée directement dans w
+  r = 0;
+  size_t rest = size;
+  for (size_t k = 0; r == 0 && k < n; ++k) {
+    r = pool_wait(p, k);
+    if (r == 1 && fallback) {
+      r = 0;
+      rest = start[k];
+      break;
+    }
+    if (r == 0 && wc_merge(w, part[k]) != 0) {
+      r = 1;
+      if (fallback) {
+        // Libère les compteurs des morceaux suivants avant d'achever la
+        //    fusion
+        pool_dispose(&p);
+        for (size_t j = k + 1; j < n; ++j) {
+          wc_dispose(&part[j]);
+        }
+        r = wc_merge(w, part[k]) != 0;
+        rest = start[k + 1];
+        break;
+      }
+    }
+    wc_dispose(&part[k]);
+  }
+  pool_dispose(&p);
+  if (r == 0 && rest < size) {
+    r = wc_memcount(w, s + rest, size - rest, a->max_w_len,
+        a->only_alpha_num, channel);
+  }
+dispose:
+  if (part != NULL) {
+    for (size_t k = 0; k < n; ++k) {
+      wc_dispose(&part[k]);
+    }
+  }
+  free(part);
+  free(start);
+  munmap(s, size);
+  return r;
+}
+
+int shuffle_file(shuffle_job *job, size_t worker, size_t k) {
+  args *a = job->a;
+  wordstream *ws = a->file[k];
+  if (ws == NULL) {
+    return 1;
+  }
+  if (job->sw[worker] == NULL) {
+    job->sw[worker] = shuffle_writer_empty(job->sh);
+    if (job->sw[worker] == NULL) {
+      return 1;
+    }
+  }
+  if (wordstream_popen(ws) != 0) {
+    return 2;
+  }
+  int rc = wc_file_apply(ws->stream, job->al, a->max_w_len,
+      a->only_alpha_num, a->ngram, job->sw[worker],
+      START_CHANNEL + a->base + (int) k,
+      (int (*)(void *, const char *, int))shuffle_put);
+  if (rc == 3) {
+    rc = 1;
+  }
+  if (wordstream_pclose(ws) != 0 && rc == 0) {
+    rc = 2;
+  }
+  return rc;
+}
+
+int count_shuffle(args *a, const allocator *al, wordcounter **part,
+    size_t npart) {
+  shuffle_job job = {
+    .a = a,
+    .al = al,
+    .sh = NULL,
+    .sw = calloc(a->jobs, sizeof *job.sw),
+    .part = part,
+  };
+  if (job.sw == NULL) {
+    return 1;
+  }
+  job.sh = shuffle_start(part, npart);
+  if (job.sh == NULL) {
+    free(job.sw);
+    return 1;
+  }
+  int r = 0;
+  // Le filtre est déposé en entier avant les mots des fichiers : les files
+  //    d'attente étant traitées dans l'ordre, il est complet dans chaque
+  //    partition avant que le comptage n'y commence
+  if (a->filtered) {
+    wordstream *ws = a->filter;
+    shuffle_writer *sw = shuffle_writer_empty(job.sh);
+    r = 1;
+    if (ws != NULL && sw != NULL) {
+      r = wordstream_popen(ws) != 0 ? 2 : 0;
+      if (r == 0) {
+        r = wc_file_apply(ws->stream, al, a->max_w_len, a->only_alpha_num,
+            a->ngram, sw, UNDEFINED_CHANNEL,
+            (int (*)(void *, const char *, int))shuffle_put);
+        if (r == 3 || (r == 0 && shuffle_flush(sw) != 0)) {
+          r = 1;
+        }
+        if (wordstream_pclose(ws) != 0 && r == 0) {
+          r = 2;
+        }
+      }
+    }
+    shuffle_writer_dispose(&sw);
+  }
+  if (r == 0) {
+    r = steal_run(a->jobs, (size_t) a->filecount, &job,
+        (int (*)(void *, size_t, size_t))shuffle_file);
+    if (r < 0) {
+      r = 1;
+    }
+  }
+  for (size_t i = 0; i < a->jobs; ++i) {
+    if (job.sw[i] != NULL && shuffle_flush(job.sw[i]) != 0 && r == 0) {
+      r = 1;
+    }
+    shuffle_writer_dispose(&job.sw[i]);
+  }
+  free(job.sw);
+  if (shuffle_finish(&job.sh) != 0 && r == 0) {
+    r = 1;
+  }
+  return r;
+}
+
+int sort_part(shuffle_job *job, size_t worker, size_t k) {
+  (void) worker;
+  job->sort(job->part[k]);
+  return 0;
+}
+
+int mem_overflow(void *context, wordcounter *w) {
+  mem_context *mc = context;
+  allocator *account = mc->account;
+  struct allocator_stats st;
+  allocator_accounting_stats(account, &st);
+  bool had_reserve = st.soft < st.limit;
+  size_t soft = st.limit - st.limit / MEM__RESERVE_DIV;
+  allocator_accounting_set_soft_limit(account, 0);
+  size_t n = wc_reclaim(w);
+  allocator_accounting_stats(account, &st);
+  if (n != 0 && st.current < soft) {
+    allocator_accounting_set_soft_limit(account, soft);
+  }
+  if (n != 0 || had_reserve) {
+    return 0;
+  }
+  if (!mc->external && mc->rs == NULL) {
+    return -1;
+  }
+  if (mc->external && mc->sp == NULL) {
+    mc->sp = spill_empty(MEM__SPILL_NPART);
+    if (mc->sp == NULL) {
+      mc->spill_error = true;
+      return -1;
+    }
+  }
+  size_t before = st.current;
+  int rw = mc->rs != NULL ? runs_flush(mc, w) : spill_write(mc->sp, w);
+  if (rw != 0) {
+    mc->spill_error = rw == 2;
+    return -1;
+  }
+  allocator_accounting_stats(account, &st);
+  if (st.current < soft) {
+    allocator_accounting_set_soft_limit(account, soft);
+  }
+  return st.current < before ? 0 : -1;
+}
+
+int runs_flush(mem_context *mc, wordcounter *w) {
+  mc->sort(w);
+  return runs_write(mc->rs, w);
+}
+
+int load_word(load_job *job, const char *s, int channel,
+    long unsigned int count) {
+  wordcounter *w = job->npart == 0
+      ? job->w : job->part[shuffle_part(wc_str_hash(s), job->npart)];
+  while (wc_addstate(w, s, job->base + channel, count) != 0) {
+    if (job->mc->account == NULL || mem_overflow(job->mc, w) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int load_fp(load_job *job, uint64_t fp) {
+  wordcounter *w = job->npart == 0
+      ? job->w : job->part[shuffle_part(fp, job->npart)];
+  while (wc_add_multi_fingerprint(w, fp) != 0) {
+    if (job->mc->account == NULL || mem_overflow(job->mc, w) != 0) {
+      return 1;
+    }
+  }
+  ++job->nfps;
+  return 0;
+}
+
+char *cache_entry(const args *a, const char *path, const struct stat *st) {
+  const char *fmt = "%s/%016" PRIx64 "-%jx-%jx.%09ld-%zu%s-%zu.snap";
+  const char *alpha = a->only_alpha_num ? "p" : "";
+  uint64_t h = wc_str_hash(path);
+  int n = snprintf(NULL, 0, fmt, a->cache, h, (uintmax_t) st->st_size,
+      (uintmax_t) st->st_mtim.tv_sec, (long int) st->st_mtim.tv_nsec,
+      a->max_w_len, alpha, a->ngram);
+  char *entry = n < 0 ? NULL : malloc((size_t) n + 1);
+  if (entry == NULL) {
+    return NULL;
+  }
+  sprintf(entry, fmt, a->cache, h, (uintmax_t) st->st_size,
+      (uintmax_t) st->st_mtim.tv_sec, (long int) st->st_mtim.tv_nsec,
+      a->max_w_len, alpha, a->ngram);
+  return entry;
+}
+
+const char *cache_suffix(const char *name) {
+  const char *s = strchr(name, '-');
+  for (int k = 0; k < 2 && s != NULL; ++k) {
+    s = strchr(s + 1, '-');
+  }
+  return s;
+}
+
+void cache_prune(const args *a, const char *entry) {
+  const char *base = entry + strlen(a->cache) + 1;
+  const char *suffix = cache_suffix(base);
+  DIR *d = opendir(a->cache);
+  if (d == NULL) {
+    return;
+  }
+  size_t plen = (size_t) (strchr(base, '-') - base + 1);
+  struct dirent *de;
+  while ((de = readdir(d)) != NULL) {
+    const char *s;
+    if (strncmp(de->d_name, base, plen) != 0
+        || strcmp(de->d_name, base) == 0
+        || (s = cache_suffix(de->d_name)) == NULL || strcmp(s, suffix) != 0) {
+      continue;
+    }
+    char *old = malloc(strlen(a->cache) + strlen(de->d_name) + 2);
+    if (old != NULL) {
+      sprintf(old, "%s/%s", a->cache, de->d_name);
+      unlink(old);
+      free(old);
+    }
+  }
+  closedir(d);
+}
+
+int cache_word(load_job *job, word *p) {
+  return load_word(job, word_str(p), word_channel(p), word_count(p));
+}
+
+int cache_load(args *a, load_job *job, const char *entry,
+    const char *path) {
+  int err;
+  snapshot *sn = snapshot_open(entry, &err);
+  if (sn == NULL) {
+    return -1;
+  }
+  int r = -1;
+  if (snapshot_file_count(sn) == 1
+      && strcmp(snapshot_file_name(sn, 0), path) == 0
+      && snapshot_max_w_len(sn) == a->max_w_len
+      && snapshot_only_alpha_num(sn) == a->only_alpha_num
+      && snapshot_ngram(sn) == a->ngram) {
+    r = snapshot_apply(sn, job,
+        (int (*)(void *, const char *, int, long unsigned int))load_word);
+    if (r == 3) {
+      r = 4;
+    }
+  }
+  snapshot_dispose(&sn);
+  return r;
+}
+
+int count_cached(args *a, load_job *job, const allocator *al,
+    wordstream *ws, int channel) {
+  struct stat st;
+  if (ws->is_stdin || fstat(fileno(ws->stream), &st) != 0
+      || !S_ISREG(st.st_mode)) {
+    return -1;
+  }
+  char *path = realpath(ws->filename, NULL);
+  char *entry = path == NULL ? NULL : cache_entry(a, path, &st);
+  int r = -1;
+  if (entry == NULL) {
+    goto dispose;
+  }
+  job->base = channel - START_CHANNEL;
+  r = cache_load(a, job, entry, path);
+  if (r >= 0) {
+    goto dispose;
+  }
+  wordcounter *t = wc_empty_alloc(false, al);
+  if (t == NULL) {
+    goto dispose;
+  }
+  wc_set_ngram(t, a->ngram);
+  int rc = a->jobs > 1
+      ? count_split(a, t, al, NULL, ws, START_CHANNEL, false)
+      : wc_filecount(t, ws->stream, a->max_w_len, a->only_alpha_num,
+          START_CHANNEL);
+  if (rc == 2) {
+    r = 2;
+  } else if (rc != 0) {
+    rewind(ws->stream);
+  } else if (snapshot_write(entry, &t, 1, (const char * const *) &path, 1,
+      a->max_w_len, a->only_alpha_num, a->ngram) == 0) {
+    wc_dispose(&t);
+    cache_prune(a, entry);
+    r = cache_load(a, job, entry, path);
+    if (r < 0) {
+      rewind(ws->stream);
+    }
+  } else {
+    fprintf(stderr, "--- Warning: cannot write cache file %s\n", entry);
+    r = wc_apply_context(t, job, (int (*)(void *, word *))cache_word);
+  }
+  wc_dispose(&t);
+dispose:
+  free(entry);
+  free(path);
+  return r;
+}
+
+int follow_start(follow *fl) {
+  args *a = fl->a;
+  fl->offset = calloc((size_t) a->filecount, sizeof *fl->offset);
+  fl->buf = malloc(FOLLOW__CHUNK);
+  if ((fl->offset == NULL && a->filecount != 0) || fl->buf == NULL) {
+    return 1;
+  }
+  fl->capacity = FOLLOW__CHUNK;
+  for (int i = 0; i < a->filecount; ++i) {
+    wordstream *ws = a->file[i];
     if (ws == NULL) {
-      goto error_capacity;
+      return 1;
     }
     if (wordstream_popen(ws) != 0) {
-      goto error_read;
+      return 2;
     }
-    int rf = wc_file_add_filtered(wc, ws->stream, a->max_w_len,
-        a->only_alpha_num);
-    if (rf != 0) {
-      if (rf == 2) {
-        goto error_read;
-      }
-      goto error_capacity;
+    struct stat st;
+    if (fstat(fileno(ws->stream), &st) != 0) {
+      return 2;
     }
-    if (wordstream_pclose(ws) != 0) {
-      goto error_read;
+    if (!S_ISREG(st.st_mode)) {
+      return 3;
     }
   }
-  // Analyse des différents fichiers
+  return 0;
+}
+
+int follow_read(follow *fl, wordcounter *w, bool *changed) {
+  args *a = fl->a;
   for (int i = 0; i < a->filecount; ++i) {
-    int channel = START_CHANNEL + i;
     wordstream *ws = a->file[i];
-    if (ws == NULL) {
-      goto error_capacity;
+    int fd = fileno(ws->stream);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      return 2;
     }
-    if (wordstream_popen(ws) != 0) {
-      goto error_read;
+    if (st.st_size < fl->offset[i]) {
+      fprintf(stderr, "--- Warning: %s was truncated, read again from its "
+          "start\n", ws->filename);
+      fl->offset[i] = 0;
     }
-    int rc = wc_filecount(wc, ws->stream, a->max_w_len, a->only_alpha_num,
-        channel);
-    if (rc != 0) {
-      if (rc == 2) {
-        goto error_read;
+    while (fl->offset[i] < st.st_size) {
+      size_t n = (size_t) (st.st_size - fl->offset[i]);
+      n = n < fl->capacity ? n : fl->capacity;
+      ssize_t k = pread(fd, fl->buf, n, fl->offset[i]);
+      if (k < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return 2;
       }
-      goto error_capacity;
+      if (k == 0) {
+        break;
+      }
+      // Le dernier mot lu n'est compté que s'il est suivi d'un espacement
+      size_t end = (size_t) k;
+      while (end > 0 && !isspace((unsigned char) fl->buf[end - 1])) {
+        --end;
+      }
+      if (end == 0) {
+        if ((size_t) k < fl->capacity) {
+          break;
+        }
+        if (fl->capacity > SIZE_MAX / 2) {
+          return 1;
+        }
+        char *buf = realloc(fl->buf, 2 * fl->capacity);
+        if (buf == NULL) {
+          return 1;
+        }
+        fl->buf = buf;
+        fl->capacity *= 2;
+        continue;
+      }
+      int r = wc_memcount(w, fl->buf, end, a->max_w_len, a->only_alpha_num,
+          START_CHANNEL + a->base + i);
+      if (r != 0) {
+        return r;
+      }
+      fl->offset[i] += (off_t) end;
+      *changed = true;
     }
-    int r = wordstream_pclose(ws);
-    if (r != 0) {
-      goto error_read;
+  }
+  return 0;
+}
+
+int follow_removed(follow_output *fo, word *p) {
+  const word *q = wc_search(fo->w, word_str(p));
+  if (q != NULL && word_channel(q) >= START_CHANNEL
+      && word_channel(q) != word_channel(p)) {
+    outbuf_puts(fo->ob, word_str(p));
+    outbuf_write(fo->ob, "\n", 1);
+  }
+  return 0;
+}
+
+int follow_changed(follow_output *fo, word *p) {
+  const word *q = wc_search(fo->w, word_str(p));
+  if (q != NULL) {
+    rword_put_filter(fo->ob, q);
+  }
+  return 0;
+}
+
+int follow_changes(load_job *job, wordcounter *t) {
+  outbuf *ob = outbuf_empty(STDOUT_FILENO);
+  if (ob == NULL) {
+    return 1;
+  }
+  follow_output fo = {
+    .w = job->w,
+    .ob = ob,
+  };
+  wc_apply_context(t, &fo, (int (*)(void *, word *))follow_removed);
+  int r = wc_apply_context(t, job, (int (*)(void *, word *))cache_word);
+  if (r == 0) {
+    wc_apply_context(t, &fo, (int (*)(void *, word *))follow_changed);
+  }
+  outbuf_flush(ob);
+  outbuf_dispose(&ob);
+  wc_clear(t);
+  return r;
+}
+
+int follow_run(follow *fl, load_job *job, const allocator *al,
+    snapshot **snap, size_t nsnap, void (*sort_fun)(wordcounter *)) {
+  args *a = fl->a;
+  wordcounter *t = NULL;
+  if (a->changes) {
+    t = wc_empty_alloc(false, al);
+    if (t == NULL) {
+      return 1;
     }
   }
-  // Tri si demandé
-  if (a->sort_type != ARGS__SORT_VAL_NONE) {
-    void (*sort_fun)(wordcounter *) = NULL;
-    if (a->sort_type == ARGS__SORT_VAL_LEXICAL) {
-      sort_fun = a->sort_reversed ? wc_sort_lexical_reverse : wc_sort_lexical;
-    } else if (a->sort_type == ARGS__SORT_VAL_NUMERIC) {
-      sort_fun = a->sort_reversed ? wc_sort_count_reverse : wc_sort_count;
+  int r = 0;
+  while (r == 0) {
+    sleep((unsigned int) a->follow);
+    bool changed = false;
+    r = follow_read(fl, t != NULL ? t : job->w, &changed);
+    if (r != 0 || !changed) {
+      continue;
     }
-    if (sort_fun != NULL) {
-      sort_fun(wc);
+    print_header(a, snap, nsnap);
+    fflush(stdout);
+    if (t != NULL) {
+      r = follow_changes(job, t);
+    } else {
+      if (sort_fun != NULL) {
+        sort_fun(job->w);
+      } else {
+        wc_restrict_exclusive(job->w);
+      }
+      r = output_words(job->w, a->jobs,
+          a->filtered ? rword_put_filter : rword_put);
     }
   }
-  // Affichage des entetes
+  wc_dispose(&t);
+  return r;
+}
+
+const char *serve_arg(const char *s, const char *name) {
+  size_t n = strlen(name);
+  if (strncmp(s, name, n) != 0 || s[n] != ' ' || s[n + 1] == '\0') {
+    return NULL;
+  }
+  return s + n + 1;
+}
+
+size_t serve_rank(const char *s) {
+  if (*s < '0' || *s > '9') {
+    return 0;
+  }
+  errno = 0;
+  char *end = NULL;
+  unsigned long long m = strtoull(s, &end, 10);
+  if (errno != 0 || *end != '\0' || m > SIZE_MAX) {
+    return 0;
+  }
+  return (size_t) m;
+}
+
+size_t serve_file_count(serve_job *job) {
+  return (size_t) (job->a->base + job->a->filecount) + job->nadded;
+}
+
+const char *serve_file_name(serve_job *job, size_t k) {
+  for (size_t i = 0; i < job->nsnap; ++i) {
+    size_t n = snapshot_file_count(job->snap[i]);
+    if (k < n) {
+      return snapshot_file_name(job->snap[i], k);
+    }
+    k -= n;
+  }
+  if (k < (size_t) job->a->filecount) {
+    wordstream *ws = job->a->file[k];
+    return ws->is_stdin ? "\"\"" : ws->filename;
+  }
+  return job->added[k - (size_t) job->a->filecount];
+}
+
+int serve_channel_put(serve_channel *sc, word *p) {
+  if (word_channel(p) == sc->channel) {
+    rword_put(sc->ob, p);
+  }
+  return 0;
+}
+
+int serve_top_put(serve_top *st, word *p) {
+  if (word_channel(p) < START_CHANNEL) {
+    return 0;
+  }
+  rword_put(st->ob, p);
+  --st->left;
+  return st->left == 0;
+}
+
+int serve_add(serve_job *job, const char *path, outbuf *ob) {
+  args *a = job->a;
+  size_t n = serve_file_count(job);
+  char **added = n >= (size_t) (INT_MAX - START_CHANNEL) ? NULL
+      : realloc(job->added, (job->nadded + 1) * sizeof *added);
+  if (added != NULL) {
+    job->added = added;
+  }
+  char *name = malloc(strlen(path) + 1);
+  if (added == NULL || name == NULL) {
+    free(name);
+    outbuf_puts(ob, "*** Error capacity\n");
+    return 0;
+  }
+  strcpy(name, path);
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    free(name);
+    outbuf_puts(ob, "*** Could not open file\n");
+    return 0;
+  }
+  // Le fichier est retenu même si son comptage échoue, certains de ses mots
+  //    pouvant déjà avoir été comptés dans son canal : son rang est écrit
+  //    avant le message d'erreur
+  int r = wc_filecount(job->w, f, a->max_w_len, a->only_alpha_num,
+      START_CHANNEL + (int) n);
+  if (fclose(f) != 0 && r == 0) {
+    r = 2;
+  }
+  job->added[job->nadded] = name;
+  ++job->nadded;
+  job->sort(job->w);
+  outbuf_ulong(ob, n + 1, '\n');
+  if (r != 0) {
+    outbuf_puts(ob, r == 2 ? "*** Error while reading a file\n"
+        : "*** Error capacity\n");
+  }
+  return 0;
+}
+
+bool serve_exclusive(serve_job *job, const char *s) {
+  (void) job;
+  return serve_arg(s, SERVE__ADD) != NULL;
+}
+
+int serve_query(serve_job *job, const char *s, outbuf *ob) {
+  const char *arg;
+  size_t k;
+  if ((arg = serve_arg(s, SERVE__GET)) != NULL) {
+    const word *p = wc_search(job->w, arg);
+    if (p != NULL && word_channel(p) >= START_CHANNEL) {
+      DISPLAY_WORD(ob, p);
+    }
+  } else if ((arg = serve_arg(s, SERVE__TOP)) != NULL
+      && (k = serve_rank(arg)) != 0) {
+    serve_top st = {
+      .ob = ob,
+      .left = k,
+    };
+    wc_apply_slice(job->w, 0, wc_word_count(job->w), &st,
+        (int (*)(void *, word *))serve_top_put);
+  } else if ((arg = serve_arg(s, SERVE__FILE)) != NULL
+      && (k = serve_rank(arg)) != 0 && k <= serve_file_count(job)) {
+    serve_channel sc = {
+      .ob = ob,
+      .channel = START_CHANNEL + (int) (k - 1),
+    };
+    wc_apply_slice(job->w, 0, wc_word_count(job->w), &sc,
+        (int (*)(void *, word *))serve_channel_put);
+  } else if (strcmp(s, SERVE__FILES) == 0) {
+    for (size_t i = 0; i < serve_file_count(job); ++i) {
+      outbuf_puts(ob, serve_file_name(job, i));
+      outbuf_write(ob, "\n", 1);
+    }
+  } else if ((arg = serve_arg(s, SERVE__ADD)) != NULL) {
+    return serve_add(job, arg, ob);
+  } else {
+    outbuf_puts(ob, "*** Invalid query\n");
+  }
+  return 0;
+}
+
+void print_header(args *a, snapshot **snap, size_t nsnap) {
   if (a->filtered) {
     wordstream_pfn(a->filter, stdout);
   }
+  for (size_t k = 0; k < nsnap; ++k) {
+    for (size_t j = 0; j < snapshot_file_count(snap[k]); ++j) {
+      fputc('\t', stdout);
+      fputs(snapshot_file_name(snap[k], j), stdout);
+    }
+  }
   for (int i = 0; i < a->filecount; ++i) {
     fputc('\t', stdout);
     wordstream_pfn(a->file[i], stdout);
   }
   fputc('\n', stdout);
-  // Affichage des compteurs
-  int (*wd)(const word *) = a->filtered ? rword_put_filter : rword_put;
-  wc_apply(wc, (int (*)(word *))wd);
-  goto dispose;
-  // Gestion des erreurs et sortie du programme
-  error_capacity
-  : r = EXIT_FAILURE;
-  fprintf(stderr, "*** Error capacity\n");
-  goto dispose;
-error_read:
-  r = EXIT_FAILURE;
-  fprintf(stderr, "*** Error while reading a file\n");
-  goto dispose;
-dispose:
-  wc_dispose(&wc);
-  args_dispose(&a);
+}
+
+int save_snapshot(args *a, snapshot **snap, size_t nsnap, wordcounter **w,
+    size_t n) {
+  size_t nfiles = (size_t) (a->base + a->filecount);
+  const char **name = malloc(nfiles * sizeof *name);
+  if (name == NULL && nfiles != 0) {
+    return 1;
+  }
+  size_t m = 0;
+  for (size_t k = 0; k < nsnap; ++k) {
+    for (size_t j = 0; j < snapshot_file_count(snap[k]); ++j) {
+      name[m] = snapshot_file_name(snap[k], j);
+      ++m;
+    }
+  }
+  for (int i = 0; i < a->filecount; ++i) {
+    name[m] = a->file[i]->is_stdin ? "\"\"" : a->file[i]->filename;
+    ++m;
+  }
+  int r = snapshot_write(a->save, w, n, name, nfiles, a->max_w_len,
+      a->only_alpha_num, a->ngram);
+  free(name);
   return r;
 }
 
-//  Définitions des fonctions --------------------------------------------------
+int vocab_gather_word(vocab_gather *g, word *p) {
+  if (word_count(p) != 0) {
+    g->word[g->n] = word_str(p);
+    ++g->n;
+  }
+  return 0;
+}
 
-//  DISPLAY_WORD : affiche le mot w, son compteur d'occurences et un saut de
-//    lignes, le tout précédé de tabulations en fonction du canal de w.
-#define DISPLAY_WORD(w)                                                        \
-  printf("%s\t", word_str(w));                                                 \
-  for (int k = word_channel(w); k > START_CHANNEL; --k) {                      \
-    fputc('\t', stdout);                                                       \
-  }                                                                            \
-  printf("%zu\n", word_count(w));
+int make_vocab(args *a, wordcounter **w, size_t n) {
+  size_t total = 0;
+  for (size_t k = 0; k < n; ++k) {
+    total += wc_word_count(w[k]);
+  }
+  vocab_gather g = {
+    .word = malloc(total * sizeof *g.word),
+    .n = 0,
+  };
+  if (g.word == NULL && total != 0) {
+    return 1;
+  }
+  for (size_t k = 0; k < n; ++k) {
+    wc_apply_context(w[k], &g, (int (*)(void *, word *))vocab_gather_word);
+  }
+  int r = vocab_write(a->make_vocab, g.word, g.n, wc_str_hash);
+  free(g.word);
+  return r;
+}
 
-int rword_put(const word *w) {
-  if (word_channel(w) == MULTI_CHANNEL) {
-    return 0;
+int approx_add(sketch *sk, const char *s, int channel) {
+  (void) channel;
+  return sketch_add(sk, s);
+}
+
+int approx_file(approx_job *job, size_t worker, size_t k) {
+  (void) worker;
+  args *a = job->a;
+  wordstream *ws = a->file[k];
+  if (ws == NULL) {
+    return 1;
   }
-  DISPLAY_WORD(w);
-  return 0;
+  if (wordstream_popen(ws) != 0) {
+    return 2;
+  }
+  job->sk[k] = sketch_empty(a->approx, job->al);
+  int rc = 1;
+  if (job->sk[k] != NULL) {
+    rc = wc_file_apply(ws->stream, job->al, a->max_w_len, a->only_alpha_num,
+        a->ngram, job->sk[k], START_CHANNEL + (int) k,
+        (int (*)(void *, const char *, int))approx_add);
+    if (rc == 3) {
+      rc = 1;
+    }
+  }
+  if (wordstream_pclose(ws) != 0 && rc == 0) {
+    rc = 2;
+  }
+  return rc;
 }
 
-int rword_put_filter(const word *w) {
-  if (word_channel(w) == MULTI_CHANNEL
-      || word_channel(w) == UNDEFINED_CHANNEL) {
-    return 0;
+int approx_gather_word(approx_gather *g, const char *s,
+    long unsigned int count) {
+  for (size_t j = 0; j < g->n; ++j) {
+    if (j != g->k && sketch_contains(g->sk[j], s)) {
+      return 0;
+    }
   }
-  DISPLAY_WORD(w);
+  if (g->nword == g->capacity) {
+    size_t c = g->capacity * 2 + 1;
+    spill_word *t = realloc(g->word, c * sizeof *t);
+    if (t == NULL) {
+      return 1;
+    }
+    g->word = t;
+    g->capacity = c;
+  }
+  g->word[g->nword] = (spill_word) {
+    .str = s,
+    .channel = START_CHANNEL + (int) g->k,
+    .count = count,
+  };
+  ++g->nword;
   return 0;
 }
 
+void approx_print_header(args *a, sketch **sk, size_t n) {
+  print_header(a, NULL, 0);
+  fputs("~distinct", stdout);
+  for (size_t k = 0; k < n; ++k) {
+    printf("\t%.0f+-%.1f%%", sketch_distinct(sk[k]),
+        200.0 * SKETCH_DISTINCT_ERROR);
+  }
+  fputs("\n~overcount", stdout);
+  for (size_t k = 0; k < n; ++k) {
+    printf("\t%lu", sketch_count_error(sk[k]));
+  }
+  fputs("\n~missed", stdout);
+  for (size_t k = 0; k < n; ++k) {
+    double kept = 1.0;
+    for (size_t j = 0; j < n; ++j) {
+      if (j != k) {
+        kept *= 1.0 - sketch_false_positive(sk[j]);
+      }
+    }
+    printf("\t%.2g%%", 100.0 * (1.0 - kept));
+  }
+  fputc('\n', stdout);
+}
+
+int approx_run(args *a, const allocator *al) {
+  size_t n = (size_t) a->filecount;
+  sketch **sk = calloc(n, sizeof *sk);
+  if (sk == NULL) {
+    return 1;
+  }
+  approx_job job = {
+    .a = a,
+    .al = al,
+    .sk = sk,
+  };
+  approx_gather g = {
+    .sk = sk,
+    .n = n,
+    .word = NULL,
+    .nword = 0,
+    .capacity = 0,
+  };
+  outbuf *ob = NULL;
+  int r = steal_run(a->jobs, n, &job,
+      (int (*)(void *, size_t, size_t))approx_file);
+  if (r < 0) {
+    r = 1;
+  }
+  for (g.k = 0; r == 0 && g.k < n; ++g.k) {
+    r = sketch_apply(sk[g.k], &g,
+        (int (*)(void *, const char *, long unsigned int))approx_gather_word);
+  }
+  if (r != 0) {
+    goto dispose;
+  }
+  int (*compar)(const spill_word *, const spill_word *) = NULL;
+  if (a->sort_type == ARGS__SORT_VAL_LEXICAL) {
+    compar = a->sort_reversed
+        ? spill_compare_lexical_reverse : spill_compare_lexical;
+  } else if (a->sort_type == ARGS__SORT_VAL_NUMERIC) {
+    compar = a->sort_reversed
+        ? spill_compare_count_reverse : spill_compare_count;
+  }
+  if (compar != NULL && g.nword > 1) {
+    qsort(g.word, g.nword, sizeof *g.word,
+        (int (*)(const void *, const void *))compar);
+  }
+  approx_print_header(a, sk, n);
+  fflush(stdout);
+  ob = outbuf_empty(STDOUT_FILENO);
+  if (ob == NULL) {
+    r = 1;
+    goto dispose;
+  }
+  spill_output so = {
+    .ob = ob,
+    .left = a->top == 0 ? SIZE_MAX : a->top,
+  };
+  for (size_t i = 0; i < g.nword; ++i) {
+    rspill_put(&so, &g.word[i]);
+  }
+  outbuf_flush(ob);
+dispose:
+  outbuf_dispose(&ob);
+  free(g.word);
+  for (size_t k = 0; k < n; ++k) {
+    sketch_dispose(&sk[k]);
+  }
+  free(sk);
+  return r;
+}
+
+void mem_fprint_stats(const allocator *al, FILE *stream) {
+  struct allocator_stats st;
+  allocator_accounting_stats(al, &st);
+  P_TITLE(stream, "Memory usage");
+  P_VALUE(stream, "current", "%zu", st.current);
+  P_VALUE(stream, "peak", "%zu", st.peak);
+  P_VALUE(stream, "limit", "%zu", st.limit);
+}
+
 //  ----------------------------------------------------------------------------
 
 //  help__print_category : sert pour l'affichage de l'aide ; affiche une
@@ -313,6 +2517,11 @@ static void help__print_opt(char opt, const char *describe) {
   printf("  -%c\t\t%s\n\n", opt, describe);
 }
 
+//  help__print_lopt : similaire à help__print_opt, pour une option longue.
+static void help__print_lopt(const char *opt, const char *describe) {
+  printf("  --%s\n\t\t%s\n\n", opt, describe);
+}
+
 void print_help() {
   //  Usage
   printf("Usage: xwc [OPTION]... [FILE]...\n\n");
@@ -353,12 +2562,162 @@ void print_help() {
       "Make the punctuation characters play the same role as white-space "     \
       "characters in the meaning of words."
       );
+  help__print_opt(
+      CHR(ARGS__NGRAM),
+      "Count the sequences of VALUE consecutive words of each FILE instead "   \
+      "of its words. A sequence is displayed as its words separated by a "     \
+      "space, and is exclusive to a FILE under the same rules as a word. "     \
+      "Sequences do not span two FILES. With -" XSTR(ARGS__RESTRICT) ", the "  \
+      "counting is limited to the sequences of the given FILE. Default is 1."
+      );
   help__print_opt(
       CHR(ARGS__RESTRICT),
       "Limit the counting to the set of words that appear in FILE. FILE is "   \
       "displayed in the first column the standard input; in this case, \"\" "  \
       "is displayed in first column of the header line."
       );
+  help__print_lopt(
+      ARGS__LONG_LOAD "=SNAPSHOT",
+      "Merge the counts saved in SNAPSHOT by --" ARGS__LONG_SAVE " with "      \
+      "those of the FILES, as if the files it was made from were read "        \
+      "again: their names are displayed, in the header line, before the "      \
+      "FILES. May be repeated, the SNAPSHOTS being merged in the given "       \
+      "order. SNAPSHOT must have been made with the same -"                    \
+      XSTR(ARGS__LIMIT_WLEN) ", -" XSTR(ARGS__ONLY_ALPHA_NUM) " and -"         \
+      XSTR(ARGS__NGRAM) " values. "                                            \
+      "When a SNAPSHOT is given, the standard input is not read by default."   \
+      );
+  help__print_lopt(
+      ARGS__LONG_SAVE "=SNAPSHOT",
+      "Save the counts of the words of the SNAPSHOTS loaded by --"             \
+      ARGS__LONG_LOAD " and of the FILES to SNAPSHOT, a compact binary file "  \
+      "that --" ARGS__LONG_LOAD " maps in memory and merges without "          \
+      "reading the FILES again. Only the words that appear in a single file "  \
+      "are saved with their counts, the others as 64-bit fingerprints. "       \
+      "Excludes --" ARGS__LONG_EXTERNAL "."                                    \
+      );
+  help__print_lopt(
+      ARGS__LONG_CACHE "=DIR",
+      "Keep in the existing directory DIR a snapshot of the counts of each "   \
+      "regular FILE, named after its absolute path, size and modification "    \
+      "time. A FILE whose snapshot, made with the same -"                      \
+      XSTR(ARGS__LIMIT_WLEN) ", -" XSTR(ARGS__ONLY_ALPHA_NUM) " and -"         \
+      XSTR(ARGS__NGRAM) " values, "                                            \
+      "is found in DIR is not read again: a rerun only reads the FILES that "  \
+      "changed. Writing the snapshot of a FILE removes those of its earlier "  \
+      "versions made with the same values. The FILES are processed one at a "  \
+      "time. Excludes --" ARGS__LONG_SHUFFLE "."                               \
+      );
+  help__print_lopt(
+      ARGS__LONG_FOLLOW "=SECONDS",
+      "Once the results are displayed, keep the counts in memory and read "    \
+      "again, every SECONDS seconds, only the bytes appended to the FILES, "   \
+      "which must be regular files; whenever new words are read, display "     \
+      "the header line and the updated results. A word at the end of a "       \
+      "FILE is only counted once followed by a white-space character. A "      \
+      "FILE whose size decreases is read again from its start. The program "   \
+      "does not stop on its own. Excludes -" XSTR(ARGS__NGRAM) ", --"          \
+      ARGS__LONG_SHUFFLE ", --" ARGS__LONG_EXTERNAL ", --" ARGS__LONG_SAVE     \
+      " and --" ARGS__LONG_CACHE "."                                           \
+      );
+  help__print_lopt(
+      ARGS__LONG_VOCAB "=FILE",
+      "Count the words of the vocabulary FILE, written by --"                  \
+      ARGS__LONG_MAKE_VOCAB ", in plain arrays indexed by word identifiers "   \
+      "given by a minimal perfect hash, instead of the hash table; the other " \
+      "words are counted as usual. Speeds up counting when most words "        \
+      "belong to FILE. The counters of the words of FILE are allocated at "    \
+      "once: if they do not fit in memory, FILE is ignored."                   \
+      );
+  help__print_lopt(
+      ARGS__LONG_MAKE_VOCAB "=FILE",
+      "Write to FILE the vocabulary of the counted words, for later use by "   \
+      "--" ARGS__LONG_VOCAB ". Excludes --" ARGS__LONG_EXTERNAL "."            \
+      );
+  help__print_category("Memory Control");
+  help__print_opt(
+      CHR(ARGS__RECLAIM),
+      "Release the storage of the words that appear in several FILES as soon " \
+      "as possible, keeping only a 64-bit fingerprint of each of them. "       \
+      "Lowers the memory footprint when FILES share most of their words."
+      );
+  help__print_opt(
+      CHR(ARGS__HUGEPAGES),
+      "Place the memory regions of at least 2 MiB, such as the hash array "    \
+      "and the word list, in anonymous mappings backed by transparent huge "   \
+      "pages when the system allows it."
+      );
+  help__print_lopt(
+      ARGS__LONG_MEM_LIMIT "=SIZE",
+      "Do not allocate more than SIZE bytes for counting. SIZE may end with "  \
+      "K, M or G (powers of 1024, case insensitive). One eighth of SIZE is "   \
+      "kept in reserve: when the rest is exhausted, the reserve is released "  \
+      "and the words that appear in several FILES are dropped, as with -"      \
+      XSTR(ARGS__RECLAIM) ". If that is not enough, the program exits with "   \
+      "a failure message, unless --" ARGS__LONG_EXTERNAL " is given. 0 "       \
+      "means without limitation. Default is 0."
+      );
+  help__print_lopt(
+      ARGS__LONG_EXTERNAL,
+      "When the memory limit set by --" ARGS__LONG_MEM_LIMIT " is reached, "   \
+      "write the counted words to temporary files, partitioned by hash, and "  \
+      "go on counting. The partitions are then counted, and sorted if "        \
+      "requested, one by one, and merged to produce the result. Requires --"   \
+      ARGS__LONG_MEM_LIMIT ", excludes -"                                      \
+      XSTR(ARGS__RESTRICT) "."
+      );
+  help__print_lopt(
+      ARGS__LONG_RUNS,
+      "Count each FILE alone, then write its sorted words to a temporary "     \
+      "file, or earlier if the memory limit set by --" ARGS__LONG_MEM_LIMIT    \
+      " is reached. The exclusive words are found by merging these files, "    \
+      "so that only the words of one FILE are held in memory. The result is "  \
+      "sorted lexicographically; numeric sort is not available. Excludes -"    \
+      XSTR(ARGS__RESTRICT) ", --" ARGS__LONG_SHUFFLE ", --"                    \
+      ARGS__LONG_EXTERNAL ", --" ARGS__LONG_LOAD ", --" ARGS__LONG_SAVE        \
+      ", --" ARGS__LONG_CACHE ", --" ARGS__LONG_FOLLOW ", --"                  \
+      ARGS__LONG_SERVE ", --" ARGS__LONG_VOCAB " and --"                       \
+      ARGS__LONG_MAKE_VOCAB "."
+      );
+  help__print_lopt(
+      ARGS__LONG_APPROX "=VALUE",
+      "Estimate the result in a fixed amount of memory per FILE, whatever "    \
+      "its size. The VALUE most frequent words of each FILE are tracked by "   \
+      "a Space-Saving summary, its distinct words by a HyperLogLog "           \
+      "estimator and its vocabulary by a Bloom filter of 1 MiB. Only the "     \
+      "tracked words that no other filter contains are written, with an "      \
+      "overestimated count. Three lines after the header give, for each "      \
+      "FILE, the estimated number of distinct words within two standard "      \
+      "errors (~distinct), the maximum overestimation of counts "              \
+      "(~overcount) and the probability that an exclusive word is missed "     \
+      "because of the other filters (~missed). Excludes --" ARGS__LONG_RUNS    \
+      " and the options it excludes."
+      );
+  help__print_lopt(
+      ARGS__LONG_MEM_STATS,
+      "Print the current, peak and limit memory usage of counting, in "        \
+      "bytes, on the standard error at exit."
+      );
+  help__print_category("Parallel Processing");
+  help__print_opt(
+      CHR(ARGS__JOBS),
+      "Count the words of up to VALUE FILES at the same time, each in its "    \
+      "own table, on VALUE threads; the tables are then merged in the order "  \
+      "of the FILES. A large regular FILE read alone is split at white "       \
+      "spaces into up to VALUE parts, counted the same way. The sort, if "     \
+      "any, and the formatting of the output also run on VALUE threads. 0 "    \
+      "means the number of online processors. Default is 1. The memory used "  \
+      "grows with VALUE."
+      );
+  help__print_lopt(
+      ARGS__LONG_SHUFFLE,
+      "Instead of one table per FILE, split the words by hash between VALUE "  \
+      "tables given by -" XSTR(ARGS__JOBS) ", each owned by its own counting " \
+      "thread, while VALUE other threads read the FILES, an idle one "         \
+      "stealing FILES not yet started from a busy one: no table is copied "    \
+      "or merged. Words are then displayed in no particular order unless a "   \
+      "sort is requested. Excludes --" ARGS__LONG_MEM_LIMIT "."
+      );
   help__print_category("Output Control");
   help__print_opt(
       CHR(ARGS__SORT_LEXICAL),
@@ -385,6 +2744,39 @@ void print_help() {
       "Sort in descending order on the single or first key instead of "        \
       "ascending order. This option has no effect if the -S option is enable."
       );
+  help__print_opt(
+      CHR(ARGS__TOP),
+      "Display only the first VALUE words of the sorted results, selected "    \
+      "without sorting the other words. Implies -" XSTR(ARGS__SORT_NUMERIC)    \
+      " unless another sort is requested: with -" XSTR(ARGS__SORT_REVERSE)     \
+      ", the VALUE most frequent words are displayed. 0 means without "        \
+      "limitation. Default is 0."
+      );
+  help__print_lopt(
+      ARGS__LONG_CHANGES,
+      "With --" ARGS__LONG_FOLLOW ", after the first results, only display "   \
+      "the lines changed by the new words, in no particular order: the "       \
+      "words that no longer appear in a single FILE, alone on their line, "    \
+      "then the new lines of the others."                                      \
+      );
+  help__print_category("Server Mode");
+  help__print_lopt(
+      ARGS__LONG_SERVE "=SOCKET",
+      "Instead of displaying the results, keep them in memory, sorted, by "    \
+      "default, in descending order of the number of occurrences, and answer " \
+      "queries on the local socket SOCKET. A query is a line; its answer is "  \
+      "followed by an empty line. 'get WORD' gives the line of WORD in the "   \
+      "results, if any; 'top VALUE' the first VALUE lines of the results; "    \
+      "'file VALUE' the lines of the words that only appear in the file of "   \
+      "rank VALUE, starting from 1; 'files' the names of the files, one per "  \
+      "line, by rank; 'add FILE' counts the words of FILE, which gets the "    \
+      "next rank, and gives this rank, followed by an error message if the "   \
+      "counting failed: FILE then keeps the words read before the failure. "   \
+      "Queries are answered at the same time, except 'add'. The program does " \
+      "not stop on its own. Excludes --"                                       \
+      ARGS__LONG_SHUFFLE ", --" ARGS__LONG_EXTERNAL " and --"                  \
+      ARGS__LONG_FOLLOW "."                                                    \
+      );
 }
 
 //  ----------------------------------------------------------------------------
@@ -488,12 +2880,36 @@ void wordstream_pfn(wordstream *w, FILE *stream) {
   XSTR(ARGS__RESTRICT) ":"                                                     \
   XSTR(ARGS__ONLY_ALPHA_NUM)                                                   \
   XSTR(ARGS__LIMIT_WLEN) ":"                                                   \
+  XSTR(ARGS__NGRAM) ":"                                                        \
+  XSTR(ARGS__RECLAIM)                                                          \
+  XSTR(ARGS__HUGEPAGES)                                                        \
+  XSTR(ARGS__JOBS) ":"                                                         \
+  XSTR(ARGS__TOP) ":"                                                          \
   XSTR(ARGS__SORT_REVERSE)                                                     \
   XSTR(ARGS__SORT_LEXICAL)                                                     \
   XSTR(ARGS__SORT_NUMERIC)                                                     \
   XSTR(ARGS__SORT_NONE)                                                        \
   XSTR(ARGS__SORT_TYPE) ":"
 
+//  args__long_options : options longues, à passer à getopt_long.
+static const struct option args__long_options[] = {
+  {ARGS__LONG_MEM_LIMIT, required_argument, NULL, ARGS__LONG_VAL_MEM_LIMIT},
+  {ARGS__LONG_MEM_STATS, no_argument, NULL, ARGS__LONG_VAL_MEM_STATS},
+  {ARGS__LONG_EXTERNAL, no_argument, NULL, ARGS__LONG_VAL_EXTERNAL},
+  {ARGS__LONG_SHUFFLE, no_argument, NULL, ARGS__LONG_VAL_SHUFFLE},
+  {ARGS__LONG_SAVE, required_argument, NULL, ARGS__LONG_VAL_SAVE},
+  {ARGS__LONG_LOAD, required_argument, NULL, ARGS__LONG_VAL_LOAD},
+  {ARGS__LONG_CACHE, required_argument, NULL, ARGS__LONG_VAL_CACHE},
+  {ARGS__LONG_FOLLOW, required_argument, NULL, ARGS__LONG_VAL_FOLLOW},
+  {ARGS__LONG_CHANGES, no_argument, NULL, ARGS__LONG_VAL_CHANGES},
+  {ARGS__LONG_SERVE, required_argument, NULL, ARGS__LONG_VAL_SERVE},
+  {ARGS__LONG_VOCAB, required_argument, NULL, ARGS__LONG_VAL_VOCAB},
+  {ARGS__LONG_MAKE_VOCAB, required_argument, NULL, ARGS__LONG_VAL_MAKE_VOCAB},
+  {ARGS__LONG_RUNS, no_argument, NULL, ARGS__LONG_VAL_RUNS},
+  {ARGS__LONG_APPROX, required_argument, NULL, ARGS__LONG_VAL_APPROX},
+  {NULL, 0, NULL, 0},
+};
+
 //  ARGS__SORT_COND : on suppose qu'il existe un entier opt qui est l'option en
 //    cours de traitement. L'expression vaut true si cette option (et sa valeur
 //    si besoin) correspond au tri SORT_TYPE.
@@ -539,6 +2955,42 @@ static int args__get_size_t(size_t *k, const char *s) {
   return 0;
 }
 
+//  args__get_mem_size : similaire à args__get_size_t, mais le nombre peut être
+//    suivi de l'un des suffixes K, M et G, qui le multiplient respectivement
+//    par 2^10, 2^20 et 2^30.
+static int args__get_mem_size(size_t *k, const char *s) {
+  if (*s == '-') {
+    return 1;
+  }
+  errno = 0;
+  char *end = NULL;
+  unsigned long long m = strtoull(s, &end, 10);
+  if (errno != 0 || end == s || m > SIZE_MAX) {
+    return -1;
+  }
+  int shift = 0;
+  switch (*end) {
+    case 'G':
+    case 'g':
+      shift += 10;
+      [[fallthrough]];
+    case 'M':
+    case 'm':
+      shift += 10;
+      [[fallthrough]];
+    case 'K':
+    case 'k':
+      shift += 10;
+      ++end;
+      break;
+  }
+  if (*end != '\0' || m > SIZE_MAX >> shift) {
+    return -1;
+  }
+  *k = (size_t) m << shift;
+  return 0;
+}
+
 args *args_init(int argc, char *argv[], int *error) {
   if (error == NULL) {
     return NULL;
@@ -556,15 +3008,44 @@ args *args_init(int argc, char *argv[], int *error) {
   a->filter = NULL;
   a->only_alpha_num = false;
   a->max_w_len = 0;
+  a->ngram = 1;
+  a->reclaim = false;
+  a->hugepages = false;
+  a->mem_limit = 0;
+  a->mem_stats = false;
+  a->external = false;
+  a->runs = false;
+  a->approx = 0;
+  a->shuffle = false;
+  a->jobs = 1;
   a->sort_type = ARGS__SORT_VAL_NONE;
   a->sort_reversed = false;
+  a->top = 0;
+  a->save = NULL;
+  a->load = NULL;
+  a->nload = 0;
+  a->cache = NULL;
+  a->follow = 0;
+  a->changes = false;
+  a->serve = NULL;
+  a->vocab = NULL;
+  a->make_vocab = NULL;
+  a->base = 0;
   a->help = false;
   // Récupération des valeurs des arguments
   int opt;
   opterr = 0;
   optopt = 0;
-  while ((opt = getopt(argc, argv, ARGS__OPT_STRING)) != -1) {
-    if (opt == CHR(ARGS__HELP) && (CHR(ARGS__HELP) != '?' || optopt == 0)) {
+  int prev_optind = optind;
+  while ((opt = getopt_long(argc, argv, ARGS__OPT_STRING, args__long_options,
+      NULL)) != -1) {
+    // Une option longue inconnue est signalée comme ARGS__HELP par getopt_long
+    // lorsque celle-ci vaut '?'
+    bool unknown_long = opt == '?' && optopt == 0 && optind != prev_optind
+        && strncmp(argv[optind - 1], "--", 2) == 0;
+    prev_optind = optind;
+    if (opt == CHR(ARGS__HELP) && (CHR(ARGS__HELP) != '?' || optopt == 0)
+        && !unknown_long) {
       a->help = true;
       return a;
     } else if (opt == CHR(ARGS__RESTRICT)) {
@@ -578,6 +3059,76 @@ args *args_init(int argc, char *argv[], int *error) {
         fprintf(stderr, "*** Invalid argument: -%c %s\n", (char) opt, optarg);
         goto ai__error_arg;
       }
+    } else if (opt == CHR(ARGS__NGRAM)) {
+      if (args__get_size_t(&a->ngram, optarg) != 0 || a->ngram == 0) {
+        fprintf(stderr, "*** Invalid argument: -%c %s\n", (char) opt, optarg);
+        goto ai__error_arg;
+      }
+    } else if (opt == CHR(ARGS__RECLAIM)) {
+      a->reclaim = true;
+    } else if (opt == CHR(ARGS__HUGEPAGES)) {
+      a->hugepages = true;
+    } else if (opt == CHR(ARGS__JOBS)) {
+      if (args__get_size_t(&a->jobs, optarg) != 0) {
+        fprintf(stderr, "*** Invalid argument: -%c %s\n", (char) opt, optarg);
+        goto ai__error_arg;
+      }
+      if (a->jobs == 0) {
+        long int n = sysconf(_SC_NPROCESSORS_ONLN);
+        a->jobs = n > 0 ? (size_t) n : 1;
+      }
+    } else if (opt == CHR(ARGS__TOP)) {
+      if (args__get_size_t(&a->top, optarg) != 0) {
+        fprintf(stderr, "*** Invalid argument: -%c %s\n", (char) opt, optarg);
+        goto ai__error_arg;
+      }
+    } else if (opt == ARGS__LONG_VAL_MEM_LIMIT) {
+      if (args__get_mem_size(&a->mem_limit, optarg) != 0) {
+        fprintf(stderr, "*** Invalid argument: --%s %s\n",
+            ARGS__LONG_MEM_LIMIT, optarg);
+        goto ai__error_arg;
+      }
+    } else if (opt == ARGS__LONG_VAL_MEM_STATS) {
+      a->mem_stats = true;
+    } else if (opt == ARGS__LONG_VAL_EXTERNAL) {
+      a->external = true;
+    } else if (opt == ARGS__LONG_VAL_RUNS) {
+      a->runs = true;
+    } else if (opt == ARGS__LONG_VAL_APPROX) {
+      if (args__get_size_t(&a->approx, optarg) != 0 || a->approx == 0) {
+        fprintf(stderr, "*** Invalid argument: --%s %s\n",
+            ARGS__LONG_APPROX, optarg);
+        goto ai__error_arg;
+      }
+    } else if (opt == ARGS__LONG_VAL_SHUFFLE) {
+      a->shuffle = true;
+    } else if (opt == ARGS__LONG_VAL_SAVE) {
+      a->save = optarg;
+    } else if (opt == ARGS__LONG_VAL_LOAD) {
+      char **t = realloc(a->load, (a->nload + 1) * sizeof *t);
+      if (t == NULL) {
+        goto ai__error_capacity;
+      }
+      a->load = t;
+      a->load[a->nload] = optarg;
+      ++a->nload;
+    } else if (opt == ARGS__LONG_VAL_CACHE) {
+      a->cache = optarg;
+    } else if (opt == ARGS__LONG_VAL_FOLLOW) {
+      if (args__get_size_t(&a->follow, optarg) != 0 || a->follow == 0
+          || a->follow > UINT_MAX) {
+        fprintf(stderr, "*** Invalid argument: --%s %s\n",
+            ARGS__LONG_FOLLOW, optarg);
+        goto ai__error_arg;
+      }
+    } else if (opt == ARGS__LONG_VAL_CHANGES) {
+      a->changes = true;
+    } else if (opt == ARGS__LONG_VAL_SERVE) {
+      a->serve = optarg;
+    } else if (opt == ARGS__LONG_VAL_VOCAB) {
+      a->vocab = optarg;
+    } else if (opt == ARGS__LONG_VAL_MAKE_VOCAB) {
+      a->make_vocab = optarg;
     } else if (opt == CHR(ARGS__SORT_REVERSE)) {
       a->sort_reversed = true;
     } else if (ARGS__SORT_COND(LEXICAL)) {
@@ -600,14 +3151,91 @@ args *args_init(int argc, char *argv[], int *error) {
     }
     optopt = 0;
   }
-  // Gestion des fichiers
+  if (a->external && (a->mem_limit == 0 || a->filtered)) {
+    fprintf(stderr, "*** Option --%s requires --%s and excludes -%c\n",
+        ARGS__LONG_EXTERNAL, ARGS__LONG_MEM_LIMIT, CHR(ARGS__RESTRICT));
+    goto ai__error_arg;
+  }
+  if (a->approx != 0 && a->runs) {
+    fprintf(stderr, "*** Option --%s excludes --%s\n", ARGS__LONG_APPROX,
+        ARGS__LONG_RUNS);
+    goto ai__error_arg;
+  }
+  if ((a->runs || a->approx != 0) && (a->filtered || a->shuffle
+      || a->external || a->nload != 0 || a->save != NULL || a->cache != NULL
+      || a->follow != 0 || a->serve != NULL || a->vocab != NULL
+      || a->make_vocab != NULL)) {
+    fprintf(stderr, "*** Option --%s excludes -%c, --%s, --%s, --%s, --%s, "
+        "--%s, --%s, --%s, --%s and --%s\n",
+        a->runs ? ARGS__LONG_RUNS : ARGS__LONG_APPROX,
+        CHR(ARGS__RESTRICT), ARGS__LONG_SHUFFLE, ARGS__LONG_EXTERNAL,
+        ARGS__LONG_LOAD, ARGS__LONG_SAVE, ARGS__LONG_CACHE, ARGS__LONG_FOLLOW,
+        ARGS__LONG_SERVE, ARGS__LONG_VOCAB, ARGS__LONG_MAKE_VOCAB);
+    goto ai__error_arg;
+  }
+  if (a->runs && a->sort_type == ARGS__SORT_VAL_NUMERIC) {
+    fprintf(stderr, "*** Option --%s excludes -%c %s\n", ARGS__LONG_RUNS,
+        CHR(ARGS__SORT_TYPE), ARGS__SORT_TYPE_NUMERIC);
+    goto ai__error_arg;
+  }
+  if (a->runs) {
+    a->sort_type = ARGS__SORT_VAL_LEXICAL;
+  }
+  if (a->top != 0 && a->sort_type == ARGS__SORT_VAL_NONE) {
+    a->sort_type = ARGS__SORT_VAL_NUMERIC;
+  }
+  if (a->shuffle && a->mem_limit != 0) {
+    fprintf(stderr, "*** Option --%s excludes --%s\n",
+        ARGS__LONG_SHUFFLE, ARGS__LONG_MEM_LIMIT);
+    goto ai__error_arg;
+  }
+  if (a->cache != NULL && a->shuffle) {
+    fprintf(stderr, "*** Option --%s excludes --%s\n",
+        ARGS__LONG_CACHE, ARGS__LONG_SHUFFLE);
+    goto ai__error_arg;
+  }
+  if (a->follow != 0 && (a->shuffle || a->external || a->save != NULL
+      || a->cache != NULL)) {
+    fprintf(stderr, "*** Option --%s excludes --%s, --%s, --%s and --%s\n",
+        ARGS__LONG_FOLLOW, ARGS__LONG_SHUFFLE, ARGS__LONG_EXTERNAL,
+        ARGS__LONG_SAVE, ARGS__LONG_CACHE);
+    goto ai__error_arg;
+  }
+  if (a->serve != NULL && (a->shuffle || a->external || a->follow != 0)) {
+    fprintf(stderr, "*** Option --%s excludes --%s, --%s and --%s\n",
+        ARGS__LONG_SERVE, ARGS__LONG_SHUFFLE, ARGS__LONG_EXTERNAL,
+        ARGS__LONG_FOLLOW);
+    goto ai__error_arg;
+  }
+  if (a->follow != 0 && a->ngram > 1) {
+    fprintf(stderr, "*** Option --%s excludes -%c\n", ARGS__LONG_FOLLOW,
+        CHR(ARGS__NGRAM));
+    goto ai__error_arg;
+  }
+  if (a->changes && a->follow == 0) {
+    fprintf(stderr, "*** Option --%s requires --%s\n", ARGS__LONG_CHANGES,
+        ARGS__LONG_FOLLOW);
+    goto ai__error_arg;
+  }
+  if (a->save != NULL && a->external) {
+    fprintf(stderr, "*** Option --%s excludes --%s\n",
+        ARGS__LONG_SAVE, ARGS__LONG_EXTERNAL);
+    goto ai__error_arg;
+  }
+  if (a->make_vocab != NULL && a->external) {
+    fprintf(stderr, "*** Option --%s excludes --%s\n",
+        ARGS__LONG_MAKE_VOCAB, ARGS__LONG_EXTERNAL);
+    goto ai__error_arg;
+  }
+  // Gestion des fichiers ; l'entrée standard n'est lue par défaut que si aucun
+  //    instantané n'est chargé
   a->filecount = argc - optind;
-  bool no_file = a->filecount == 0;
+  bool no_file = a->filecount == 0 && a->nload == 0;
   if (no_file) {
     a->filecount = 1;
   }
   a->file = malloc((size_t) (a->filecount) * sizeof *a->file);
-  if (a->file == NULL) {
+  if (a->file == NULL && a->filecount != 0) {
     goto ai__error_capacity;
   }
   if (no_file) {
@@ -636,6 +3264,7 @@ ai__error_capacity:
     free(a->file);
   }
   wordstream_pdispose(&a->filter);
+  free(a->load);
   free(a);
   return NULL;
 }
@@ -649,6 +3278,7 @@ void args_dispose(args **a) {
   }
   free((*a)->file);
   wordstream_pdispose(&(*a)->filter);
+  free((*a)->load);
   free(*a);
   *a = NULL;
 }